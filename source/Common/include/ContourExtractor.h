@@ -0,0 +1,109 @@
+/**
+ * \class    ContourExtractor
+ * \ingroup  Common
+ *
+ * \brief    Contour lines of 2D histograms and isosurfaces of 3D meshes
+ *
+ * This class extracts contour lines (marching squares) from TH2
+ * histograms, e.g. 2D slices or projections of meshes, and isosurfaces
+ * (marching tetrahedra) from TH3 meshes. The values are taken at the bin
+ * centers and interpolated linearly along the edges of the grid of bin
+ * centers, as done by the contour drawing of ROOT.
+ *
+ * The grid is split in slabs (rows of cells in 2D, layers of cells in 3D)
+ * which are processed by the threads of a \ref ThreadPool. The result is
+ * compact: contour lines are joined into polylines, and isosurfaces are
+ * indexed triangle meshes whose vertices are shared between triangles.
+ * Polylines can be drawn on top of a histogram (e.g. as \a TGraph) or
+ * written to a text file, isosurfaces to a Wavefront OBJ file.
+ *
+ * Each cube of the 3D grid is split in 6 tetrahedra around its main
+ * diagonal, which needs no case tables and gives a closed surface without
+ * the ambiguous cases of marching cubes, with about twice as many
+ * triangles. The triangles are oriented with their normals pointing to
+ * lower values.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ContourExtractor.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH2.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __ContourExtractor__
+#define __ContourExtractor__
+
+/// Contour line (polyline) of a 2D histogram
+struct ContourLine {
+	double level;            ///< contour level
+	std::vector<double> x;   ///< x coordinates of points
+	std::vector<double> y;   ///< y coordinates of points
+	bool closed;             ///< last point is joined to the first one
+};
+
+/// Isosurface (indexed triangle mesh) of a 3D mesh
+struct IsoSurface {
+	double level;                ///< isosurface level
+	std::vector<double> vertex;  ///< coordinates x, y, z of vertices
+	std::vector<int> triangle;   ///< 3 vertex indices per triangle
+};
+
+class ContourExtractor {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	ContourExtractor(int nthreads = 0) : m_pool(nthreads), message("ContourExtractor") {};
+
+	/// \brief Class destructor
+	~ContourExtractor() {};
+
+	/// \brief Make contour levels equally spaced between minimum and maximum of a histogram
+	/// \param hist histogram
+	/// \param n number of levels
+	/// \param logscale spaced logarithmically (between smallest positive value and maximum)
+	/// \return vector of levels
+	static std::vector<double> makeLevels(TH1* hist, int n, bool logscale = false);
+
+	/// \brief Extract contour lines of a 2D histogram
+	/// \param hist 2D histogram (TH2F or TH2D)
+	/// \param levels contour levels
+	/// \return polylines of all levels
+	std::vector<ContourLine> contours(TH2* hist, std::vector<double> levels);
+
+	/// \brief Extract isosurface of a 3D mesh
+	/// \param hist 3D histogram (TH3F or TH3D)
+	/// \param level isosurface level
+	/// \return triangle mesh
+	IsoSurface isosurface(TH3* hist, double level);
+
+	/// \brief Write contour lines to text file ("x y" per line, empty line between polylines)
+	/// \param lines contour lines
+	/// \param filename name of file
+	/// \return false if the file can not be written
+	bool writeContours(const std::vector<ContourLine>& lines, TString filename);
+
+	/// \brief Write isosurface to Wavefront OBJ file
+	/// \param surface triangle mesh
+	/// \param filename name of file
+	/// \return false if the file can not be written
+	bool writeSurface(const IsoSurface& surface, TString filename);
+
+private:
+	/// \brief Get bin array of a histogram
+	/// \return false for unsupported histogram type
+	bool getArray(TH1* hist, const float*& arrayF, const double*& arrayD);
+
+	ThreadPool m_pool;   ///< threads processing slabs
+	ErrHandler message;  ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * \class    DenseHisto
+ * \ingroup  Common
+ *
+ * \brief    N-dimension dense histogram for internal processing
+ *
+ * This header-only class template is a plain N-dimension histogram with
+ * storage type \a T (float, double or uint32_t): the bins are kept in one
+ * contiguous array without under/overflow bins (the first axis runs
+ * fastest, as in ROOT), optionally with a second array of squared errors.
+ * Bin access is not virtual and the bulk operations (add, scale, sum,...)
+ * are simple loops over the arrays which the compiler can vectorize.
+ *
+ * It is meant for readers and reducers which process many bins; ROOT
+ * histograms are only created (\ref toROOT()) or read (\ref fromROOT())
+ * at the I/O boundary, with \a TH1F/TH2F/TH3F for float, \a TH1D/TH2D/TH3D
+ * for double and \a TH1I/TH2I/TH3I for uint32_t storage.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     DenseHisto.h
+ *
+ */
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <stdint.h>
+#include <TString.h>
+#include <TAxis.h>
+#include <TH1F.h>
+#include <TH1D.h>
+#include <TH1I.h>
+#include <TH2F.h>
+#include <TH2D.h>
+#include <TH2I.h>
+#include <TH3F.h>
+#include <TH3D.h>
+#include <TH3I.h>
+
+#ifndef __DenseHisto__
+#define __DenseHisto__
+
+/**
+ * \class    DenseAxis
+ * \ingroup  Common
+ *
+ * \brief    Axis of \ref DenseHisto given by its bin edges
+ *
+ * Bins are numbered from 0; \ref findBin() uses a direct computation for
+ * uniform axes and a binary search otherwise.
+ */
+class DenseAxis {
+
+public:
+	/// \brief Default constructor (no bin)
+	DenseAxis() : m_uniform(true) {};
+
+	/// \brief Constructor of uniform axis
+	/// \param n number of bins
+	/// \param min low edge of first bin
+	/// \param max up edge of last bin
+	DenseAxis(int n, double min, double max) : m_uniform(true) {
+		for (int i = 0; i <= n; ++i)
+			m_edge.push_back( min + i*(max-min)/n );
+	};
+
+	/// \brief Constructor of variable bin axis
+	/// \param edge bin edges (number of bins + 1)
+	DenseAxis(const std::vector<double>& edge) : m_edge(edge), m_uniform(false) {};
+
+	/// \brief Constructor from ROOT axis
+	/// \param axis pointer of \a TAxis object
+	DenseAxis(const TAxis* axis) : m_uniform(!axis->IsVariableBinSize()) {
+		for (int i = 1; i <= axis->GetNbins(); ++i)
+			m_edge.push_back( axis->GetBinLowEdge(i) );
+		m_edge.push_back( axis->GetBinUpEdge(axis->GetNbins()) );
+	};
+
+	/// \brief Get number of bins
+	int getNbins() const { return (int)m_edge.size()-1; };
+
+	/// \brief Get bin edges
+	const std::vector<double>& getEdges() const { return m_edge; };
+
+	/// \brief Check if bins are uniform
+	bool isUniform() const { return m_uniform; };
+
+	/// \brief Get low edge of bin \a i
+	double getLowEdge(int i) const { return m_edge[i]; };
+
+	/// \brief Get up edge of bin \a i
+	double getUpEdge(int i) const { return m_edge[i+1]; };
+
+	/// \brief Get center of bin \a i
+	double getCenter(int i) const { return 0.5*(m_edge[i]+m_edge[i+1]); };
+
+	/// \brief Find bin of a value
+	/// \param x value
+	/// \return bin number (-1 if outside of axis)
+	int findBin(double x) const {
+		int n = getNbins();
+		if (n <= 0 || !(x >= m_edge[0] && x < m_edge[n]))
+			return -1;
+		if (m_uniform)
+			return std::min( (int)((x-m_edge[0]) / (m_edge[n]-m_edge[0]) * n), n-1 );
+		return (int)(std::upper_bound(m_edge.begin(), m_edge.end(), x) - m_edge.begin()) - 1;
+	};
+
+private:
+	std::vector<double> m_edge;  ///< bin edges
+	bool m_uniform;              ///< bins have the same width
+};
+
+/// ROOT histogram and array types of a DenseHisto with dimension N and storage type T
+template<int N, class T> struct DenseRootType;
+template<> struct DenseRootType<1,float>    { typedef TH1F Type; typedef TArrayF Array; };
+template<> struct DenseRootType<2,float>    { typedef TH2F Type; typedef TArrayF Array; };
+template<> struct DenseRootType<3,float>    { typedef TH3F Type; typedef TArrayF Array; };
+template<> struct DenseRootType<1,double>   { typedef TH1D Type; typedef TArrayD Array; };
+template<> struct DenseRootType<2,double>   { typedef TH2D Type; typedef TArrayD Array; };
+template<> struct DenseRootType<3,double>   { typedef TH3D Type; typedef TArrayD Array; };
+template<> struct DenseRootType<1,uint32_t> { typedef TH1I Type; typedef TArrayI Array; };
+template<> struct DenseRootType<2,uint32_t> { typedef TH2I Type; typedef TArrayI Array; };
+template<> struct DenseRootType<3,uint32_t> { typedef TH3I Type; typedef TArrayI Array; };
+
+template<int N, class T> class DenseHisto {
+
+public:
+	typedef std::array<DenseAxis, N> Axes;   ///< axes of histogram
+	typedef std::array<int, N> Index;        ///< bin numbers (from 0) on all axes
+
+	/// \brief Default constructor (no bin)
+	DenseHisto() {};
+
+	/// \brief Class constructor
+	/// \param axes axes of histogram
+	/// \param errors keep squared errors
+	DenseHisto(const Axes& axes, bool errors = false) : m_axes(axes) {
+		int size = 1;
+		for (int d = 0; d < N; ++d) {
+			m_stride[d] = size;
+			size *= m_axes[d].getNbins();
+		}
+		m_value.assign(size, T(0));
+		if (errors)
+			m_error.assign(size, 0.);
+	};
+
+	/// \brief Class destructor
+	~DenseHisto() {};
+
+	/// \brief Get axis \a d
+	const DenseAxis& getAxis(int d) const { return m_axes[d]; };
+
+	/// \brief Get number of bins of axis \a d
+	int getNbins(int d) const { return m_axes[d].getNbins(); };
+
+	/// \brief Get total number of bins
+	int getSize() const { return (int)m_value.size(); };
+
+	/// \brief Check if squared errors are kept
+	bool hasErrors() const { return m_error.size() > 0; };
+
+	/// \brief Keep squared errors (initialized to the bin values, as \a TH1::Sumw2())
+	void sumw2() {
+		if (hasErrors()) return;
+		m_error.resize(m_value.size());
+		for (size_t i = 0; i < m_value.size(); ++i)
+			m_error[i] = (double)m_value[i];
+	};
+
+	/// \brief Get pointer of bin array
+	T* getArray() { return m_value.empty() ? 0 : &m_value[0]; };
+	const T* getArray() const { return m_value.empty() ? 0 : &m_value[0]; };
+
+	/// \brief Get pointer of squared error array (0 without errors)
+	double* getErrors() { return m_error.empty() ? 0 : &m_error[0]; };
+	const double* getErrors() const { return m_error.empty() ? 0 : &m_error[0]; };
+
+	/// \brief Get linear index of a bin
+	/// \param bin bin numbers (from 0) on all axes
+	int getIndex(const Index& bin) const {
+		int index = 0;
+		for (int d = 0; d < N; ++d)
+			index += bin[d]*m_stride[d];
+		return index;
+	};
+
+	/// \brief Find linear index of bin containing a point
+	/// \param x coordinates of point
+	/// \return linear index (-1 if outside of histogram)
+	int findIndex(const std::array<double, N>& x) const {
+		int index = 0;
+		for (int d = 0; d < N; ++d) {
+			int bin = m_axes[d].findBin(x[d]);
+			if (bin < 0) return -1;
+			index += bin*m_stride[d];
+		}
+		return index;
+	};
+
+	/// \brief Access bin with linear index \a i
+	T& operator[](int i) { return m_value[i]; };
+	const T& operator[](int i) const { return m_value[i]; };
+
+	/// \brief Access bin with bin numbers \a bin
+	T& at(const Index& bin) { return m_value[getIndex(bin)]; };
+	const T& at(const Index& bin) const { return m_value[getIndex(bin)]; };
+
+	/// \brief Fill a point
+	/// \param x coordinates of point
+	/// \param w weight
+	void fill(const std::array<double, N>& x, double w = 1.) {
+		int i = findIndex(x);
+		if (i < 0) return;
+		m_value[i] += (T)w;
+		if (hasErrors()) m_error[i] += w*w;
+	};
+
+	/// \brief Set all bins (and errors) to zero
+	void reset() {
+		std::fill(m_value.begin(), m_value.end(), T(0));
+		std::fill(m_error.begin(), m_error.end(), 0.);
+	};
+
+	/// \brief Multiply all bins by \a c (errors by c^2)
+	void scale(double c) {
+		int n = getSize();
+		T* v = getArray();
+		for (int i = 0; i < n; ++i)
+			v[i] = (T)(v[i]*c);
+		double* e = getErrors();
+		if (e)
+			for (int i = 0; i < n; ++i)
+				e[i] *= c*c;
+	};
+
+	/// \brief Add histogram \a other with weight \a w (same binning)
+	void add(const DenseHisto& other, double w = 1.) {
+		int n = std::min(getSize(), other.getSize());
+		T* v = getArray();
+		const T* o = other.getArray();
+		for (int i = 0; i < n; ++i)
+			v[i] = (T)(v[i] + w*o[i]);
+		double* e = getErrors();
+		if (!e) return;
+		const double* oe = other.getErrors();
+		double w2 = w*w;
+		if (oe)
+			for (int i = 0; i < n; ++i)
+				e[i] += w2*oe[i];
+		else
+			for (int i = 0; i < n; ++i)
+				e[i] += w2*(double)o[i];
+	};
+
+	/// \brief Sum of all bins (in double precision)
+	double sum() const {
+		double s = 0.;
+		int n = getSize();
+		const T* v = getArray();
+		for (int i = 0; i < n; ++i)
+			s += v[i];
+		return s;
+	};
+
+	/// \brief Create histogram from ROOT histogram (without under/overflow bins)
+	/// \param hist ROOT histogram of the matching type (e.g. TH3F for DenseHisto<3,float>)
+	/// \return new histogram (no bin if \a hist has the wrong type)
+	static DenseHisto fromROOT(TH1* hist) {
+		typename DenseRootType<N,T>::Array* array = dynamic_cast<typename DenseRootType<N,T>::Array*>(hist);
+		if (!array || hist->GetDimension() != N)
+			return DenseHisto();
+		TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+		Axes axes;
+		for (int d = 0; d < N; ++d)
+			axes[d] = DenseAxis(axis[d]);
+		bool errors = (hist->GetSumw2N() > 0);
+		DenseHisto out(axes, errors);
+		const T* value = (const T*)array->GetArray();
+		const double* error = (errors ? hist->GetSumw2()->GetArray() : 0);
+		std::vector<int> rows = out.getRootRows();
+		int n0 = out.getNbins(0);
+		for (size_t r = 0; r < rows.size(); ++r) {
+			std::copy(value+rows[r], value+rows[r]+n0, &out.m_value[r*n0]);
+			if (errors) std::copy(error+rows[r], error+rows[r]+n0, &out.m_error[r*n0]);
+		}
+		return out;
+	};
+
+	/// \brief Create ROOT histogram (only for 1, 2 and 3 dimensions)
+	/// \param name name of histogram
+	/// \param title title of histogram
+	/// \return new \a TH1F, \a TH2F,... (with error array if errors are kept)
+	TH1* toROOT(TString name, TString title = "") const {
+		typedef typename DenseRootType<N,T>::Type Hist;
+		const double* e[3] = { 0, 0, 0 };
+		int n[3] = { 1, 1, 1 };
+		for (int d = 0; d < N; ++d) {
+			e[d] = &m_axes[d].getEdges()[0];
+			n[d] = getNbins(d);
+		}
+		Hist* hist = newRoot((Hist*)0, name, title, n, e);
+		TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+		for (int d = 0; d < N; ++d)
+			if (m_axes[d].isUniform())
+				axis[d]->Set(n[d], e[d][0], e[d][n[d]]);
+		if (hasErrors())
+			hist->Sumw2();
+		T* value = (T*)hist->GetArray();
+		double* error = (hasErrors() ? hist->GetSumw2()->GetArray() : 0);
+		std::vector<int> rows = getRootRows();
+		int n0 = getNbins(0);
+		for (size_t r = 0; r < rows.size(); ++r) {
+			std::copy(&m_value[r*n0], &m_value[r*n0]+n0, value+rows[r]);
+			if (error) std::copy(&m_error[r*n0], &m_error[r*n0]+n0, error+rows[r]);
+		}
+		hist->SetEntries( sum() );
+		return hist;
+	};
+
+private:
+	/// \brief Create ROOT histogram with variable bins (overloaded on histogram type)
+	static TH1F* newRoot(TH1F*, TString name, TString title, int* n, const double** e) { return new TH1F(name, title, n[0], e[0]); };
+	static TH1D* newRoot(TH1D*, TString name, TString title, int* n, const double** e) { return new TH1D(name, title, n[0], e[0]); };
+	static TH1I* newRoot(TH1I*, TString name, TString title, int* n, const double** e) { return new TH1I(name, title, n[0], e[0]); };
+	static TH2F* newRoot(TH2F*, TString name, TString title, int* n, const double** e) { return new TH2F(name, title, n[0], e[0], n[1], e[1]); };
+	static TH2D* newRoot(TH2D*, TString name, TString title, int* n, const double** e) { return new TH2D(name, title, n[0], e[0], n[1], e[1]); };
+	static TH2I* newRoot(TH2I*, TString name, TString title, int* n, const double** e) { return new TH2I(name, title, n[0], e[0], n[1], e[1]); };
+	static TH3F* newRoot(TH3F*, TString name, TString title, int* n, const double** e) { return new TH3F(name, title, n[0], e[0], n[1], e[1], n[2], e[2]); };
+	static TH3D* newRoot(TH3D*, TString name, TString title, int* n, const double** e) { return new TH3D(name, title, n[0], e[0], n[1], e[1], n[2], e[2]); };
+	static TH3I* newRoot(TH3I*, TString name, TString title, int* n, const double** e) { return new TH3I(name, title, n[0], e[0], n[1], e[1], n[2], e[2]); };
+
+	/// \brief Index in ROOT bin array (with under/overflow bins) of the first bin
+	/// of each row (bins along the first axis)
+	std::vector<int> getRootRows() const {
+		std::vector<int> rows;
+		if (getSize() == 0) return rows;
+		int stride[N], size = 1;
+		for (int d = 0; d < N; ++d) {
+			stride[d] = size;
+			size *= getNbins(d)+2;
+		}
+		Index bin;
+		bin.fill(0);
+		for (int row = 0; row < getSize(); row += getNbins(0)) {
+			int root = 1;
+			for (int d = 1; d < N; ++d)
+				root += (bin[d]+1)*stride[d];
+			rows.push_back(root);
+			for (int d = 1; d < N; ++d) {
+				if (++bin[d] < getNbins(d)) break;
+				bin[d] = 0;
+			}
+		}
+		return rows;
+	};
+
+	Axes m_axes;                 ///< axes
+	int m_stride[N];             ///< strides of axes in bin array
+	std::vector<T> m_value;      ///< bin contents
+	std::vector<double> m_error; ///< squared errors (empty without errors)
+};
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * \class    DoseMetrics
+ * \ingroup  Common
+ *
+ * \brief    Depth-dose and lateral profile metrics of proton dose distributions
+ *
+ * This class computes the usual metrics of a proton (or ion) beam from a
+ * dose histogram, without making any plot:
+ * - depth and dose of the Bragg peak (depth refined by a parabola through
+ *   the maximum bin and its neighbours),
+ * - distal ranges R90 and R80 (depths behind the peak where the dose falls
+ *   to 90% and 80% of the peak dose),
+ * - entrance dose (dose of the first depth bin),
+ * - lateral penumbra widths (80% - 20% of the profile maximum, mean of both
+ *   sides) on the two lateral axes at the depth of the peak.
+ *
+ * For a 3D histogram the depth-dose curve is the integral over the lateral
+ * bins, and the lateral profiles go through the dose-weighted center of the
+ * beam in the slice of the peak. For a 1D histogram (depth-dose curve) only
+ * the depth metrics are computed. The crossings of dose levels are
+ * interpolated linearly between bin centers.
+ *
+ * The class keeps no state besides its settings, so one object per thread
+ * can be used to process many files in parallel.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     DoseMetrics.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH1.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+
+#ifndef __DoseMetrics__
+#define __DoseMetrics__
+
+/// Metrics of one dose distribution (-1 for metrics which are not found)
+struct DoseProfileMetrics {
+	double peakDepth;      ///< depth of Bragg peak
+	double peakDose;       ///< depth dose at Bragg peak
+	double entranceDose;   ///< depth dose of first depth bin
+	double r90;            ///< distal depth of 90% of peak dose
+	double r80;            ///< distal depth of 80% of peak dose
+	double penumbra[2];    ///< lateral 80%-20% widths on the lateral axes (in order x, y, z)
+};
+
+class DoseMetrics {
+
+public:
+	/// \brief Class constructor
+	/// \param depthAxis beam (depth) axis of 3D histograms ("x", "y" or "z")
+	DoseMetrics(TString depthAxis = "z");
+
+	/// \brief Class destructor
+	~DoseMetrics() {};
+
+	/// \brief Compute metrics of a dose histogram
+	/// \param hist 3D dose histogram or 1D depth-dose histogram
+	/// \param metrics computed metrics (output)
+	/// \return false if the histogram has no positive dose
+	bool compute(TH1* hist, DoseProfileMetrics& metrics);
+
+	/// \brief Get index of depth axis
+	int getDepthAxis() const { return m_depth; };
+
+private:
+	/// \brief Find where a profile falls below a level
+	/// \param profile dose profile
+	/// \param center bin centers
+	/// \param start index to start from
+	/// \param step direction of search (+1 or -1)
+	/// \param level dose level
+	/// \param pos interpolated position of the crossing (output)
+	/// \return false if the profile does not fall below the level
+	static bool findCrossing(const std::vector<double>& profile, const std::vector<double>& center, int start, int step, double level, double& pos);
+
+	/// \brief Compute depth metrics from a depth-dose curve
+	/// \return index of peak bin
+	int depthMetrics(const std::vector<double>& dose, const std::vector<double>& center, DoseProfileMetrics& metrics);
+
+	/// \brief Compute 80%-20% penumbra width of a lateral profile (mean of both sides)
+	/// \return width (-1 if no side is found)
+	static double penumbra(const std::vector<double>& profile, const std::vector<double>& center);
+
+	int m_depth;           ///< index of depth axis
+	ErrHandler message;    ///< label of class to print out with message
+};
+
+#endif
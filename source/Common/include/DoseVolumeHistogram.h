@@ -0,0 +1,136 @@
+/**
+ * \class    DoseVolumeHistogram
+ * \ingroup  Common
+ *
+ * \brief    Dose-volume histograms (DVH) of structures in a 3D dose grid
+ *
+ * This class computes the differential and cumulative dose-volume
+ * histograms of structures in a TH3 dose grid (PTSim dose histogram or
+ * MCNP mesh tally). A structure is a set of voxels given by a box or a
+ * cylinder region (a voxel belongs to it if its center is inside) or by
+ * a value of an integer label volume with the same binning as the dose
+ * (e.g. a TH3 of organ numbers read from a ROOT file).
+ *
+ * All structures are filled in one pass over the voxels: the rows of the
+ * grid are split in one chunk per thread of a \ref ThreadPool, each chunk
+ * fills its own private histograms, and the private histograms are added
+ * in chunk order so the result does not depend on the scheduling. The
+ * voxels are weighted by their volumes, so grids with variable bin widths
+ * are handled.
+ *
+ * The differential DVH gives the volume in each dose bin, the cumulative
+ * DVH the percentage of the structure volume receiving at least the low
+ * edge of each dose bin. The summary of each structure has its volume,
+ * minimum, mean and maximum dose and the dose-volume points D98, D95,
+ * D50 and D2 (minimum dose received by 98%, ... of the volume).
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     DoseVolumeHistogram.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH1D.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __DoseVolumeHistogram__
+#define __DoseVolumeHistogram__
+
+/// Dose summary of one structure
+struct DVHSummary {
+	TString name;     ///< name of structure
+	int nvoxels;      ///< number of voxels
+	double volume;    ///< total volume
+	double minDose;   ///< minimum dose
+	double meanDose;  ///< volume-weighted mean dose
+	double maxDose;   ///< maximum dose
+	double d98;       ///< minimum dose of 98% of the volume
+	double d95;       ///< minimum dose of 95% of the volume
+	double d50;       ///< median dose
+	double d2;        ///< minimum dose of 2% of the volume (near maximum)
+};
+
+class DoseVolumeHistogram {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	DoseVolumeHistogram(int nthreads = 0) : m_label(0), m_nbins(200), m_maxDose(0.), m_pool(nthreads), message("DoseVolumeHistogram") {};
+
+	/// \brief Class destructor
+	~DoseVolumeHistogram() {};
+
+	/// \brief Add a box structure
+	/// \param name name of structure
+	/// \param range box limits xmin, xmax, ymin, ymax, zmin, zmax
+	/// \return false for a wrong number of limits
+	bool addBox(TString name, std::vector<double> range);
+
+	/// \brief Add a cylinder structure
+	/// \param name name of structure
+	/// \param axis axis of cylinder ("x", "y" or "z")
+	/// \param param center of cylinder on the two other axes (in order x, y, z), radius, lower and upper limits along \a axis
+	/// \return false for a wrong axis or number of parameters
+	bool addCylinder(TString name, TString axis, std::vector<double> param);
+
+	/// \brief Add structures from a label volume
+	/// \param label 3D histogram of integer labels (same binning as the dose, not owned)
+	/// \param values label values of structures
+	/// \param names names of structures (default "label<value>")
+	/// \return false if a label volume was already given
+	bool addLabels(TH3* label, std::vector<int> values, std::vector<TString> names = std::vector<TString>());
+
+	/// \brief Set dose binning of histograms
+	/// \param nbins number of dose bins
+	/// \param maxDose upper edge of last dose bin (0 means maximum of the dose grid)
+	void setBinning(int nbins, double maxDose = 0.) { m_nbins = nbins; m_maxDose = maxDose; };
+
+	/// \brief Get number of structures
+	int getNstructures() const { return (int)m_structure.size(); };
+
+	/// \brief Compute DVHs of all structures
+	/// \param dose 3D dose histogram (TH3F or TH3D)
+	/// \param differential differential DVHs (new histograms, one per structure)
+	/// \param cumulative cumulative DVHs (new histograms, one per structure)
+	/// \return summaries of structures (empty for wrong inputs)
+	std::vector<DVHSummary> compute(TH3* dose, std::vector<TH1D*>& differential, std::vector<TH1D*>& cumulative);
+
+	/// \brief Get minimum dose received by a percentage of the volume
+	/// \param cumulative cumulative DVH
+	/// \param volume percentage of volume
+	/// \return dose (interpolated between bin edges)
+	static double getDose(TH1* cumulative, double volume);
+
+private:
+	/// Types of structures
+	enum Type{BOX, CYLINDER, LABEL};
+
+	/// \brief Structure definition
+	struct Structure {
+		TString name;      ///< name of structure
+		Type type;         ///< type of structure
+		int axis;          ///< axis of cylinder
+		double param[6];   ///< box limits or cylinder parameters
+		int label;         ///< label value
+	};
+
+	/// \brief Check if a voxel belongs to a geometric structure
+	/// \param s structure
+	/// \param x coordinates of voxel center
+	bool inside(const Structure& s, const double* x) const;
+
+	std::vector<Structure> m_structure;   ///< structures
+	TH3* m_label;                         ///< label volume
+	int m_nbins;                          ///< number of dose bins
+	double m_maxDose;                     ///< upper edge of dose bins
+	ThreadPool m_pool;                    ///< threads filling private histograms
+	ErrHandler message;                   ///< label of class to print out with message
+};
+
+#endif
@@ -36,6 +36,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <mutex>
 #include <TString.h>
 
 /// Check operation system (true if Windows and false if Linux)
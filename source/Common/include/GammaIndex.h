@@ -0,0 +1,111 @@
+/**
+ * \class    GammaIndex
+ * \ingroup  Common
+ *
+ * \brief    3D gamma-index comparison of two dose distributions
+ *
+ * This class compares an evaluated dose distribution with a reference
+ * one (two TH3 grids with the same binning, e.g. PTSim dose histograms or
+ * MCNP mesh tallies) with the gamma index of Low et al., combining the
+ * dose difference criterion \f$ \Delta D \f$ and the distance-to-agreement
+ * criterion \f$ \Delta d \f$:
+ * \f[ \gamma(r) = \min_{r'} \sqrt{ \frac{|r'-r|^2}{\Delta d^2} +
+ *     \frac{(D_e(r')-D_r(r))^2}{\Delta D^2} } \f]
+ * A voxel passes if \f$ \gamma \le 1 \f$. The dose criterion is a
+ * percentage of the maximum reference dose (global) or of the reference
+ * dose of the voxel (local). Reference voxels below a threshold (percentage
+ * of the maximum reference dose) are not evaluated.
+ *
+ * The search is limited to a sphere of a few \f$ \Delta d \f$ and runs over
+ * the voxel grid: the offsets of the voxels in the sphere are computed once
+ * and sorted by distance, so the search of a voxel stops at the first
+ * offset whose distance term alone is larger than the best gamma found.
+ * The rows of the grid are split over the threads of a \ref ThreadPool,
+ * each chunk of rows keeps its own pass counts. The grids must have fixed
+ * bin widths; the result is only as fine as the grid, so the voxels should
+ * be smaller than about a third of \f$ \Delta d \f$.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     GammaIndex.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH3.h>
+#include <TH3F.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __GammaIndex__
+#define __GammaIndex__
+
+/// Pass-rate summary of a gamma-index comparison
+struct GammaSummary {
+	int nvoxels;        ///< number of evaluated voxels (above threshold)
+	int npassed;        ///< number of voxels with gamma <= 1
+	double passRate;    ///< percentage of passed voxels
+	double meanGamma;   ///< mean gamma of evaluated voxels
+	double maxGamma;    ///< maximum gamma of evaluated voxels
+};
+
+class GammaIndex {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	GammaIndex(int nthreads = 0) : m_doseDiff(3.), m_distance(3.), m_local(false), m_threshold(10.), m_radius(2.), m_pool(nthreads), message("GammaIndex") {};
+
+	/// \brief Class destructor
+	~GammaIndex() {};
+
+	/// \brief Set gamma criteria
+	/// \param doseDiff dose difference criterion (percent)
+	/// \param distance distance-to-agreement criterion (units of the axes)
+	/// \param local dose difference relative to the local reference dose instead of the maximum
+	void setCriteria(double doseDiff, double distance, bool local = false) { m_doseDiff = doseDiff; m_distance = distance; m_local = local; };
+
+	/// \brief Set low dose threshold
+	/// \param threshold reference voxels below this percentage of the maximum dose are not evaluated
+	void setThreshold(double threshold) { m_threshold = threshold; };
+
+	/// \brief Set search radius
+	/// \param radius search radius in units of the distance criterion
+	void setSearchRadius(double radius) { m_radius = radius; };
+
+	/// \brief Compute gamma map of two dose distributions
+	/// \param reference reference dose (TH3F or TH3D)
+	/// \param evaluated evaluated dose (TH3F or TH3D, same binning)
+	/// \param name name of gamma map
+	/// \param summary pass-rate summary (output)
+	/// \return gamma map (-1 for voxels which are not evaluated), 0 for wrong inputs
+	TH3F* compute(TH3* reference, TH3* evaluated, TString name, GammaSummary& summary);
+
+private:
+	/// \brief Voxel offset of the search sphere
+	struct Offset {
+		int dx, dy, dz;   ///< offsets of bin numbers
+		double dist2;     ///< squared distance over squared distance criterion
+	};
+
+	/// \brief Make offsets of the search sphere sorted by distance
+	/// \param width bin widths of axes
+	std::vector<Offset> makeOffsets(const double* width);
+
+	/// \brief Check histograms and get their bin arrays
+	/// \return false for unsupported histogram type
+	bool getArray(TH1* hist, const float*& arrayF, const double*& arrayD);
+
+	double m_doseDiff;     ///< dose difference criterion (percent)
+	double m_distance;     ///< distance-to-agreement criterion
+	bool m_local;          ///< local dose difference
+	double m_threshold;    ///< low dose threshold (percent of maximum)
+	double m_radius;       ///< search radius (in distance criterion)
+	ThreadPool m_pool;     ///< threads evaluating rows of voxels
+	ErrHandler message;    ///< label of class to print out with message
+};
+
+#endif
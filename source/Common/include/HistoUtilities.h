@@ -16,6 +16,8 @@
  */
 
 #include <vector>
+#include <map>
+#include <list>
 #include <TKey.h>
 #include <TObject.h>
 #include <TH1F.h>
@@ -24,6 +26,9 @@
 #include <TFile.h>
 #include <TString.h>
 #include "ErrHandler.h"
+#include "SummedAreaTable.h"
+#include "HistoView.h"
+#include "MeshKernels.h"
 
 #ifndef __HistoUtilities__
 #define __HistoUtilities__
@@ -33,10 +38,10 @@ class HistoUtilities {
 public:
 	/// \brief Class constructor,
 	/// initialize label of class to print out with messages
-	HistoUtilities() : message("HistoUtilities") {};
+	HistoUtilities() : m_cacheSize(0), message("HistoUtilities") {};
 	
-	/// \brief Class destructor
-	~HistoUtilities() {};
+	/// \brief Class destructor, delete cached histograms
+	~HistoUtilities();
 	
 	/// \brief Get all histograms from file
 	/// \param histolist vector of histograms retrieved from file
@@ -45,13 +50,36 @@ public:
 	
 	/// \brief Get all histograms with specific names from file
 	/// \param histolist vector of histograms retrieved from file
-	/// \param histoname vector of specific histogram names
+	/// \param histoname vector of specific histogram names, glob patterns (e.g. "ratio_*") 
+	/// or regular expressions (e.g. "regex:^L[0-9]+$")
 	/// \param file pointer of \a TFile object
 	void getHistosFromFile(std::vector<TH1*> &histolist, std::vector<TString> histoname, TFile* file);
+
+	/// \brief Set size of histogram cache
+	/// \param size maximum number of cached histograms (0 for no cache)
+	void setCacheSize(int size);
+
+	/// \brief Delete all cached histograms
+	void clearCache();
 	
 	/// \brief Merge all histograms in file
 	/// \param file pointer of \a TFile object
-	void mergeHistos(TFile* file);
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	void mergeHistos(TFile* file, int nthreads = 0);
+
+	/// \brief Merge histograms with specific names in file
+	/// \param file pointer of \a TFile object
+	/// \param histoname vector of histogram names or patterns (see \ref getHistosFromFile)
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	void mergeHistos(TFile* file, std::vector<TString> histoname, int nthreads = 0);
+
+	/// \brief Merge histograms with the same name in several files
+	/// \param filelist names of input files
+	/// \param outname name of output file
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	/// \param batch number of files read at the same time (0 means number of threads)
+	/// \return number of merged histograms
+	int mergeFiles(std::vector<TString> filelist, TString outname, int nthreads = 0, int batch = 0);
 	
 	/// \brief Write a histogram to file
 	/// \param hist pointer to histogram object
@@ -100,8 +128,9 @@ public:
 	/// \param hist 3-dimension histogram
 	/// \param option option for rotation
 	/// \param name name of new histogram
+	/// \param nthreads number of threads (0 means number of CPU cores)
 	/// \return 3-dimension histogram
-	TH3F* changeAxis(TH3F* hist, TString option, TString name);
+	TH3F* changeAxis(TH3F* hist, TString option, TString name, int nthreads = 0);
 
 	/// \brief Create 1D projection histogam 
 	/// \param hist 2D histogram
@@ -128,18 +157,46 @@ public:
 	TH1* makeProjection(TH3F* hist, TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, 
 													std::vector<double> valueX, std::vector<double> valueY, std::vector<double> valueZ, double weight = 1.);								
 													
-private:
-	/// \brief Get histogram with user-defined axis ranges 
-	/// \param hist histogram
+	/// \brief Create projection histogam from summed-area table of a 3D histogram
+	/// \param table summed-area table of 3D histogram
+	/// \param option projected axis or plane
 	/// \param rangeX bin range on x-axis
 	/// \param rangeY bin range on y-axis
 	/// \param rangeZ bin range on z-axis
-	/// \param valueX value range on x-axis
-	/// \param valueY value range on y-axis
-	/// \param valueZ value range on z-axis
+	/// \param weight scale projected histogram
 	/// \return TH1 histogram
-	TH1* makeRange(TH1* hist, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, std::vector<double> valueX, std::vector<double> valueY, std::vector<double> valueZ);
-	
+	TH1* makeProjection(SummedAreaTable& table, TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight = 1.);
+
+private:
+	/// \brief Check class of object in file without reading it
+	/// \param key key of object
+	/// \param name name of (base) class
+	/// \return true if object inherits from class
+	bool isClass(TKey* key, TString name);
+
+	/// \brief Check if key is a histogram
+	bool isHisto(TKey* key) { return isClass(key, "TH1"); };
+
+	/// \brief Read histogram of key (through cache)
+	/// \param file pointer of \a TFile object
+	/// \param key key of histogram
+	/// \return histogram
+	TH1* readHisto(TFile* file, TKey* key);
+
+	/// \brief Sum of two histograms (inputs are deleted)
+	/// \param a first histogram (or 0)
+	/// \param b second histogram (or 0)
+	/// \param kernels kernels for float and double histograms
+	/// \return sum
+	TH1* addPair(TH1* a, TH1* b, MeshKernels& kernels);
+
+	/// \brief Remove least recently used histograms from cache
+	/// \param size number of histograms to keep
+	void shrinkCache(int size);
+
+	int m_cacheSize;                       ///< maximum number of cached histograms
+	std::map<TString, TH1*> m_cache;       ///< cached histograms by "file:key;cycle"
+	std::list<TString> m_cacheOrder;       ///< cached keys, least recently used first
 	ErrHandler message;  ///< label of class to print out with message
 	
 };
@@ -0,0 +1,110 @@
+/**
+ * \class    HistoView
+ * \ingroup  Common
+ *
+ * \brief    Bin range view of a 3D histogram
+ *
+ * This class refers to the bin array of a TH3F or TH3D histogram with a
+ * bin range on each axis and optionally new axis limits (the axis is then
+ * mapped linearly on the new limits, as done by \a TH1::SetBins()).
+ * Projections, integrals and the export of the selected bins work directly
+ * on the bin array of the source histogram, so restricting the range does
+ * not need a copy of the full histogram. The view does not own the
+ * histogram, which must stay alive (and keep its binning) while the view
+ * is used.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     HistoView.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH3F.h>
+#include "ErrHandler.h"
+#include "DenseHisto.h"
+
+#ifndef __HistoView__
+#define __HistoView__
+
+class HistoView {
+
+public:
+	/// \brief Class constructor
+	/// \param hist 3D histogram (TH3F or TH3D)
+	/// \param rangeX bin range on x-axis (empty for all bins)
+	/// \param rangeY bin range on y-axis (empty for all bins)
+	/// \param rangeZ bin range on z-axis (empty for all bins)
+	/// \param valueX new limits of x-axis (empty to keep the axis)
+	/// \param valueY new limits of y-axis (empty to keep the axis)
+	/// \param valueZ new limits of z-axis (empty to keep the axis)
+	HistoView(TH3* hist, std::vector<int> rangeX = std::vector<int>(), std::vector<int> rangeY = std::vector<int>(), std::vector<int> rangeZ = std::vector<int>(),
+			std::vector<double> valueX = std::vector<double>(), std::vector<double> valueY = std::vector<double>(), std::vector<double> valueZ = std::vector<double>());
+
+	/// \brief Class destructor
+	~HistoView() {};
+
+	/// \brief Get first bin (of source histogram) in view
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	int getFirst(int axis) const { return m_lo[axis]; };
+
+	/// \brief Get last bin (of source histogram) in view
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	int getLast(int axis) const { return m_hi[axis]; };
+
+	/// \brief Get number of bins in view
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	int getNbins(int axis) const { return m_hi[axis]-m_lo[axis]+1; };
+
+	/// \brief Get (mapped) low edge of a bin
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	/// \param bin bin of source histogram
+	double getBinLowEdge(int axis, int bin) const { return m_edge[axis][bin-1]; };
+
+	/// \brief Get content of a bin
+	/// \param i,j,k bin numbers in view (starting from 1)
+	double getBinContent(int i, int j, int k) const { return m_hist->GetBinContent(i+m_lo[0]-1, j+m_lo[1]-1, k+m_lo[2]-1); };
+
+	/// \brief Get error of a bin
+	/// \param i,j,k bin numbers in view (starting from 1)
+	double getBinError(int i, int j, int k) const { return m_hist->GetBinError(i+m_lo[0]-1, j+m_lo[1]-1, k+m_lo[2]-1); };
+
+	/// \brief Sum of bins in view
+	/// \param error2 sum of squared errors (output, if not 0)
+	/// \return sum of bin contents
+	double integral(double* error2 = 0);
+
+	/// \brief Create projection histogram (same option as \a TH3::Project3D())
+	/// \param option projected axis ("x", "y", "z") or plane ("yx", "zx",...)
+	/// \param name name of new histogram
+	/// \return TH1D or TH2D histogram with the bins of the view (0 for wrong option)
+	TH1* project(TString option, TString name);
+
+	/// \brief Copy bins in view to a new histogram
+	/// \param name name of new histogram
+	/// \return TH3F histogram with the bins of the view
+	TH3F* toHisto(TString name);
+
+private:
+	/// \brief Sum bins of view into the bins of a projection
+	/// \param h horizontal axis of projection (-1 for integral)
+	/// \param v vertical axis of projection (-1 for 1D projection)
+	/// \param sum sums of bin contents
+	/// \param sum2 sums of squared errors
+	/// \return false for unsupported histogram type
+	bool accumulate(int h, int v, double* sum, double* sum2);
+
+	/// \brief Get (mapped) bin edges of view on an axis
+	std::vector<double> getEdges(int axis) const { return std::vector<double>(m_edge[axis].begin()+m_lo[axis]-1, m_edge[axis].begin()+m_hi[axis]+1); };
+
+	TH3* m_hist;                    ///< source histogram
+	int m_n[3];                     ///< number of bins of source histogram
+	int m_lo[3], m_hi[3];           ///< bin ranges
+	std::vector<double> m_edge[3];  ///< (mapped) bin edges of source histogram
+	ErrHandler message;             ///< label of class to print out with message
+};
+
+#endif
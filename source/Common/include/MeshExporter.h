@@ -0,0 +1,73 @@
+/**
+ * \class    MeshExporter
+ * \ingroup  Common
+ *
+ * \brief    Export of 3D meshes to binary VTK files (e.g. for ParaView)
+ *
+ * This class writes TH3F or TH3D meshes to VTK XML files with the bin
+ * values and bin errors as cell data arrays ("value" and "error"). A
+ * mesh with fixed bin widths is written as image data (".vti"), other
+ * meshes as rectilinear grid (".vtr") with the bin boundaries as
+ * coordinates.
+ *
+ * The arrays are stored as raw binary appended data (in the type of the
+ * histogram bins, little- or big-endian as the machine), so the files
+ * are about as large as the histograms in memory. The bins are copied
+ * row by row (without under- and overflow bins) into a large buffer
+ * which is written at once when full. Several meshes are written in
+ * parallel, each to its own file, by the threads of a \ref ThreadPool.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshExporter.h
+ *
+ */
+
+#include <vector>
+#include <fstream>
+#include <TString.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __MeshExporter__
+#define __MeshExporter__
+
+class MeshExporter {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	MeshExporter(int nthreads = 0) : m_pool(nthreads), message("MeshExporter") {};
+
+	/// \brief Class destructor
+	~MeshExporter() {};
+
+	/// \brief Write a mesh to a VTK file
+	/// \param hist 3D histogram (TH3F or TH3D)
+	/// \param filename name of file without extension (".vti" or ".vtr" is added)
+	/// \return false if the file can not be written
+	bool write(TH3* hist, TString filename);
+
+	/// \brief Write meshes to VTK files in parallel
+	/// \param hist vector of 3D histograms
+	/// \param prefix prefix of file names (followed by the names of histograms)
+	/// \return number of written files
+	int write(std::vector<TH3*> hist, TString prefix);
+
+private:
+	/// \brief Write bins or errors of a mesh as raw block (with byte count)
+	/// \param out output file
+	/// \param array bin array of histogram
+	/// \param error2 squared errors (0 if the histogram has none)
+	/// \param n numbers of bins on axes
+	/// \param isError write errors instead of bins
+	template<class T> void writeBlock(std::ofstream& out, const T* array, const double* error2, const int* n, bool isError);
+
+	ThreadPool m_pool;   ///< threads writing meshes
+	ErrHandler message;  ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * \class    MeshKernels
+ * \ingroup  Common
+ *
+ * \brief    Elementwise operations on mesh histograms
+ *
+ * This class provides elementwise sum, weighted sum, ratio and relative
+ * difference of histograms (usually TH3F meshes) with error propagation.
+ * The kernels work directly on the bin arrays and error arrays of the
+ * histograms: the bins are split in blocks which are processed by the
+ * threads of a \ref ThreadPool, and inside a block all input histograms
+ * are handled one after another with simple loops the compiler can
+ * vectorize. So N meshes are processed in a single pass over memory
+ * instead of N calls of \a TH1::Add() or \a TH1::Divide().
+ *
+ * All histograms of one operation must have the same binning and the
+ * same bin type (float or double). Histograms without error array are
+ * treated as \a TH1::Add() does, i.e. with squared errors equal to the
+ * bin values.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshKernels.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <TH1.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __MeshKernels__
+#define __MeshKernels__
+
+/// Summary of the significance comparison of a mesh with a reference mesh
+struct MeshSignificance {
+	int nbins;      ///< number of compared bins (with non-zero error)
+	int noutside;   ///< number of bins with |z| above tolerance
+	double chi2;    ///< sum of z^2 of compared bins
+	double maxZ;    ///< largest |z|
+	MeshSignificance() : nbins(0), noutside(0), chi2(0.), maxZ(0.) {};
+};
+
+class MeshKernels {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	MeshKernels(int nthreads = 0) : m_pool(nthreads), message("MeshKernels") {};
+
+	/// \brief Class destructor
+	~MeshKernels() {};
+
+	/// \brief Sum of histograms
+	/// \param hist vector of histograms
+	/// \param name name of new histogram
+	/// \return new histogram
+	TH1* sum(std::vector<TH1*> hist, TString name);
+
+	/// \brief Weighted sum of histograms
+	/// \param hist vector of histograms
+	/// \param weight weights of histograms
+	/// \param name name of new histogram
+	/// \return new histogram
+	TH1* weightedSum(std::vector<TH1*> hist, std::vector<double> weight, TString name);
+
+	/// \brief Ratios of histograms to a reference histogram
+	/// \param hist vector of histograms (numerators)
+	/// \param ref reference histogram (denominator)
+	/// \param name names of new histograms
+	/// \return vector of new histograms
+	std::vector<TH1*> ratio(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name);
+
+	/// \brief Relative differences (hist-ref)/ref of histograms to a reference histogram
+	/// \param hist vector of histograms
+	/// \param ref reference histogram
+	/// \param name names of new histograms
+	/// \return vector of new histograms
+	std::vector<TH1*> relDiff(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name);
+
+	/// \brief Significance of differences of histograms to a reference histogram
+	/// \param hist vector of histograms
+	/// \param ref reference histogram
+	/// \param name names of new histograms (empty for summary only)
+	/// \param map content of new histograms: "z" for z-scores, "chi2" for z^2
+	/// \param tolerance tolerance on |z|
+	/// \param summary summary of each comparison (output)
+	/// \return vector of new histograms (empty if \a name is empty)
+	std::vector<TH1*> significance(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name, TString map, double tolerance, std::vector<MeshSignificance>& summary);
+
+	/// \brief Add a weighted histogram to a running sum (in place)
+	/// \param sum running sum (0 to create it from \a hist)
+	/// \param hist histogram to add
+	/// \param weight weight of \a hist
+	/// \param name name of running sum if it is created
+	/// \return running sum
+	TH1* accumulate(TH1* sum, TH1* hist, double weight, TString name);
+
+	/// \brief Relative errors of a histogram
+	/// \param hist histogram
+	/// \param name name of new histogram
+	/// \return new histogram with relative errors of bins (and zero errors)
+	TH1* relError(TH1* hist, TString name);
+
+	/// \brief Check that histograms can be used together
+	/// \param hist vector of histograms
+	/// \return true if all histograms have the same number of cells and bin type
+	bool check(const std::vector<TH1*>& hist);
+
+private:
+	/// \brief Create an empty histogram (with error array) with binning of \a hist
+	/// \param hist template histogram
+	/// \param name name of new histogram
+	/// \return new histogram
+	TH1* create(TH1* hist, TString name);
+
+	/// \brief Weighted sum kernel
+	template<class T> void sumKernel(const std::vector<TH1*>& hist, const std::vector<double>& weight, TH1* out);
+
+	/// \brief Significance kernel
+	template<class T> void significanceKernel(const std::vector<TH1*>& hist, TH1* ref, const std::vector<TH1*>& out, bool chi2, double tolerance, std::vector<MeshSignificance>& summary);
+
+	/// \brief Relative error kernel
+	template<class T> void relErrorKernel(TH1* hist, TH1* out);
+
+	/// \brief Ratio and relative difference kernel
+	template<class T> void divideKernel(const std::vector<TH1*>& hist, TH1* ref, const std::vector<TH1*>& out, double offset);
+
+	/// \brief Ratio or relative difference of histograms
+	std::vector<TH1*> divide(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name, double offset);
+
+	ThreadPool m_pool;   ///< worker threads
+	ErrHandler message;  ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * \class    MeshPyramid
+ * \ingroup  Common
+ *
+ * \brief    Multi-resolution levels of a 3D mesh
+ *
+ * This class builds a pyramid of downsampled copies of a TH3F mesh: each
+ * level halves the number of bins on every axis by pooling blocks of
+ * 2 x 2 x 2 bins of the previous level, either with the volume weighted
+ * mean ("mean") or with the maximum ("max") of the block. The levels are
+ * written in the sub-directory "<mesh name>_pyramid" of the output file
+ * with names "L1", "L2",..., together with the pooling method (TNamed
+ * "pooling").
+ *
+ * Plots of very fine meshes can then be made from the coarsest level
+ * which still has a target number of bins on the plotted axes (see
+ * \ref select(); \ref Plotter uses the option \a Pyramid \a Resolution,
+ * default 200 bins), which is much faster and gives much smaller files.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshPyramid.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TDirectory.h>
+#include <TH3F.h>
+#include "ErrHandler.h"
+
+#ifndef __MeshPyramid__
+#define __MeshPyramid__
+
+class MeshPyramid {
+
+public:
+	/// \brief Class constructor
+	/// \param pooling pooling method ("mean" or "max")
+	MeshPyramid(TString pooling = "mean") : m_pooling(pooling), message("MeshPyramid") {};
+
+	/// \brief Class destructor
+	~MeshPyramid() {};
+
+	/// \brief Build downsampled levels of a mesh
+	/// \param hist 3D mesh histogram (level 0)
+	/// \param nlevels maximum number of levels
+	/// \return levels 1, 2,... (each with half of bins of previous one)
+	std::vector<TH3F*> build(TH3F* hist, int nlevels);
+
+	/// \brief Write levels to the pyramid directory of a mesh
+	/// \param hist 3D mesh histogram (level 0)
+	/// \param levels downsampled levels
+	/// \param dir pointer of directory (e.g. \a TFile object)
+	void write(TH3* hist, const std::vector<TH3F*>& levels, TDirectory* dir);
+
+	/// \brief Read all levels of a mesh
+	/// \param hist 3D mesh histogram (level 0)
+	/// \param dir pointer of directory containing pyramid
+	/// \param pooling only read levels built with this pooling method ("" for any)
+	/// \return levels 0, 1, 2,... (only \a hist if there is no matching pyramid)
+	static std::vector<TH3*> read(TH3* hist, TDirectory* dir, TString pooling = "");
+
+	/// \brief Get pooling method of the pyramid of a mesh
+	/// \param hist 3D mesh histogram (level 0)
+	/// \param dir pointer of directory containing pyramid
+	/// \return pooling method ("" if there is no pyramid or the method is not recorded)
+	static TString getPooling(TH3* hist, TDirectory* dir);
+
+	/// \brief Select coarsest level with enough bins for a plot
+	/// \param levels levels 0, 1, 2,...
+	/// \param axis1 first plotted axis (0, 1, 2 for x, y, z)
+	/// \param n1 number of pixels along first axis
+	/// \param axis2 second plotted axis (-1 for 1D plot)
+	/// \param n2 number of pixels along second axis
+	/// \return index of level
+	static int select(const std::vector<TH3*>& levels, int axis1, int n1, int axis2 = -1, int n2 = 0);
+
+private:
+	/// \brief Pool blocks of 2 x 2 x 2 bins
+	/// \param hist finer level
+	/// \param name name of new level
+	/// \return coarser level
+	TH3F* pool(TH3F* hist, TString name);
+
+	TString m_pooling;   ///< pooling method
+	ErrHandler message;  ///< label of class to print out with message
+};
+
+#endif
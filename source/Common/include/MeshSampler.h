@@ -0,0 +1,94 @@
+/**
+ * \class    MeshSampler
+ * \ingroup  Common
+ *
+ * \brief    Trilinear interpolation of a mesh at many points
+ *
+ * This class evaluates a TH3F or TH3D mesh (e.g. made by
+ * \ref MeshTallyReader) at a batch of points, with the same trilinear
+ * interpolation between bin centers as \a TH3::Interpolate(). The bin
+ * centers of the axes are computed once by the constructor, so fixed
+ * (also variable) binnings are handled without the axis lookups of
+ * \a TH3::Interpolate() for every point.
+ *
+ * A batch of points is first sorted by the mesh cell which contains them,
+ * so that neighbouring points read neighbouring bins. The sorted points are
+ * split in blocks which are processed by the threads of a \ref ThreadPool;
+ * inside a block, the cell indices and weights of all points are computed
+ * first and the 8 corner bins are then gathered with simple loops the
+ * compiler can vectorize.
+ *
+ * Between the outermost bin centers and the mesh boundaries the value of
+ * the nearest bin center plane is used. Points outside of the mesh get
+ * value and error 0. The errors are propagated from the bin errors as for
+ * independent bins, i.e. \f$ \sigma^2 = \sum_c w_c^2 \sigma_c^2 \f$ over
+ * the 8 corners \a c with weights \f$ w_c \f$.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshSampler.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __MeshSampler__
+#define __MeshSampler__
+
+class MeshSampler {
+
+public:
+	/// \brief Class constructor
+	/// \param hist 3D mesh histogram (TH3F or TH3D)
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	MeshSampler(TH3* hist, int nthreads = 0);
+
+	/// \brief Class destructor
+	~MeshSampler() {};
+
+	/// \brief Interpolate mesh at points
+	/// \param x,y,z coordinates of points (same size)
+	/// \param value interpolated values (output)
+	/// \param error interpolated errors (output)
+	/// \return number of points inside of the mesh
+	int sample(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+			std::vector<double>& value, std::vector<double>& error);
+
+	/// \brief Interpolate mesh at one point
+	/// \param x,y,z coordinates of point
+	/// \param error interpolated error (output, if not 0)
+	/// \return interpolated value (0 outside of the mesh)
+	double sample(double x, double y, double z, double* error = 0);
+
+	/// \brief Get name of sampled mesh
+	TString getName() const { return m_hist->GetName(); };
+
+private:
+	/// \brief Find interpolation cell and weight of a coordinate on an axis
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	/// \param x coordinate
+	/// \param cell lower bin of cell (output)
+	/// \param weight weight of upper bin (output)
+	/// \return false if \a x is outside of the mesh
+	bool locate(int axis, double x, int& cell, double& weight) const;
+
+	/// \brief Interpolate a block of sorted points
+	template<class T> void sampleKernel(const T* array, const double* error2, const int* order, int n,
+			const double* x, const double* y, const double* z, double* value, double* error);
+
+	TH3* m_hist;                       ///< sampled mesh
+	int m_n[3];                        ///< number of bins on axes
+	double m_low[3], m_up[3];          ///< limits of axes
+	std::vector<double> m_center[3];   ///< bin centers of axes
+	bool m_uniform[3];                 ///< axis has fixed bin width
+	ThreadPool m_pool;                 ///< threads processing blocks of points
+	ErrHandler message;                ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * \class    MeshStore
+ * \ingroup  Common
+ *
+ * \brief    Out-of-core chunked mesh container
+ *
+ * This class keeps a 3D mesh (values and errors) in a ROOT file as
+ * a set of tiles instead of one TH3F histogram, so meshes larger than
+ * the available memory can be handled. Each tile holds a block of
+ * (tx,ty,tz) bins and is written as two compressed \a TArrayF keys
+ * (values and squared errors) in the directory of the mesh. Tiles which
+ * were never filled are not written and are read back as zeros.
+ *
+ * Only a limited number of tiles (see \ref setCacheSize()) are kept in
+ * memory; the least recently used tile is written out when a new tile
+ * is needed. The mesh can therefore be filled incrementally bin by bin
+ * (e.g. by \ref MeshTallyReader) and projections, ranges and ratios
+ * are computed tile by tile with a bounded memory footprint.
+ *
+ * The modified tiles are written to the file only by \ref close() (or
+ * the destructor), so the mesh must be closed before its file is closed;
+ * the destructor drops the tiles with a warning if the file is already
+ * closed.
+ *
+ * The bin numbers used in this class start from 1, as in ROOT histograms.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshStore.h
+ *
+ */
+
+#include <vector>
+#include <map>
+#include <list>
+#include <TString.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TArrayI.h>
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3F.h>
+#include "ErrHandler.h"
+
+#ifndef __MeshStore__
+#define __MeshStore__
+
+class MeshStore {
+
+public:
+	/// \brief Class constructor
+	MeshStore();
+
+	/// \brief Class destructor, write out modified tiles; close the mesh
+	/// (or destroy it) before its file, otherwise the tiles are lost
+	~MeshStore();
+
+	/// \brief Create a new mesh in a directory
+	/// \param dir pointer of parent directory (e.g. \a TFile object)
+	/// \param name name of mesh (name of its sub-directory)
+	/// \param title title of mesh
+	/// \param xedge bin boundaries of x-axis
+	/// \param yedge bin boundaries of y-axis
+	/// \param zedge bin boundaries of z-axis
+	/// \param tx number of x bins per tile
+	/// \param ty number of y bins per tile
+	/// \param tz number of z bins per tile
+	/// \return true if the mesh was created
+	bool create(TDirectory* dir, TString name, TString title, const std::vector<double>& xedge, const std::vector<double>& yedge, const std::vector<double>& zedge,
+	            int tx = 32, int ty = 32, int tz = 32);
+
+	/// \brief Open an existing mesh
+	/// \param dir pointer of parent directory (e.g. \a TFile object)
+	/// \param name name of mesh
+	/// \return true if the mesh was found
+	bool open(TDirectory* dir, TString name);
+
+	/// \brief Write out modified tiles and mesh information, must be called
+	/// before the file of the mesh is closed
+	void close();
+
+	/// \brief Set maximum number of tiles kept in memory
+	/// \param ntiles number of tiles
+	void setCacheSize(int ntiles);
+
+	/// \brief Get value of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \return bin value
+	double getBinContent(int ix, int iy, int iz);
+
+	/// \brief Get error of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \return bin error
+	double getBinError(int ix, int iy, int iz);
+
+	/// \brief Set value of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param value bin value
+	void setBinContent(int ix, int iy, int iz, double value);
+
+	/// \brief Set error of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param error bin error
+	void setBinError(int ix, int iy, int iz, double error);
+
+	/// \brief Copy a 3D histogram to the mesh (same binning)
+	/// \param hist 3-dimension histogram
+	void fill(TH3* hist);
+
+	/// \brief Convert the mesh to a 3D histogram (needs memory of whole mesh)
+	/// \param name name of histogram (mesh name if empty)
+	/// \return 3-dimension histogram
+	TH3F* toHisto(TString name = "");
+
+	/// \brief Create projection histogram, tile by tile
+	/// \param option projected axis or plane (as \a TH3::Project3D())
+	/// \param rangeX bin range on x-axis
+	/// \param rangeY bin range on y-axis
+	/// \param rangeZ bin range on z-axis
+	/// \param weight scale projected histogram (negative means normalize to 1)
+	/// \return TH1D or TH2D histogram
+	TH1* makeProjection(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight = 1.);
+
+	/// \brief Copy a bin range of the mesh to a new mesh, tile by tile
+	/// \param out new mesh
+	/// \param dir pointer of parent directory of new mesh
+	/// \param name name of new mesh
+	/// \param rangeX bin range on x-axis
+	/// \param rangeY bin range on y-axis
+	/// \param rangeZ bin range on z-axis
+	/// \return true if the new mesh was created
+	bool makeRange(MeshStore& out, TDirectory* dir, TString name, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ);
+
+	/// \brief Divide the mesh by another mesh, tile by tile
+	/// \param den denominator mesh (same binning)
+	/// \param out ratio mesh
+	/// \param dir pointer of parent directory of ratio mesh
+	/// \param name name of ratio mesh
+	/// \return true if the ratio mesh was created
+	bool makeRatio(MeshStore& den, MeshStore& out, TDirectory* dir, TString name);
+
+	/// \brief Get mesh name
+	TString getName() { return m_name; };
+
+	/// \brief Get mesh title
+	TString getTitle() { return m_title; };
+
+	/// \brief Get number of bins
+	/// \param axis axis index (0, 1, 2 for x, y, z)
+	int getNbins(int axis) { return m_nbin[axis]; };
+
+	/// \brief Get bin boundaries
+	/// \param axis axis index (0, 1, 2 for x, y, z)
+	const std::vector<double>& getEdges(int axis) { return m_edge[axis]; };
+
+private:
+	/// \brief Tile of mesh in memory
+	struct Tile {
+		std::vector<float> value;  ///< bin values
+		std::vector<float> error;  ///< squared bin errors
+		bool dirty;                ///< tile has been modified
+		std::list<int>::iterator used;  ///< position in usage list
+	};
+
+	/// \brief Get a tile, load it from file if needed
+	/// \param index tile index
+	/// \return reference to the tile
+	Tile& getTile(int index);
+
+	/// \brief Get tile of a bin and position of the bin in the tile
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param pos position of the bin in the tile
+	/// \return reference to the tile
+	Tile& locate(int ix, int iy, int iz, int& pos);
+
+	/// \brief Write a tile to file
+	/// \param index tile index
+	/// \param tile tile to be written
+	void saveTile(int index, Tile& tile);
+
+	/// \brief Write out least recently used tiles until there is room for a new one
+	void evict();
+
+	/// \brief Set bin numbers and tile numbers from the bin boundaries
+	void setup();
+
+	/// \brief Fill default values of bin ranges
+	void checkRange(std::vector<int>& range, int axis);
+
+	TDirectory* m_dir;                   ///< directory of mesh
+	TFile* m_file;                       ///< file of mesh directory
+	TString m_name;                      ///< name of mesh
+	TString m_title;                     ///< title of mesh
+	std::vector<double> m_edge[3];       ///< bin boundaries of axes
+	int m_nbin[3];                       ///< number of bins of axes
+	int m_tile[3];                       ///< tile size on axes
+	int m_ntile[3];                      ///< number of tiles on axes
+	int m_cacheSize;                     ///< maximum number of tiles in memory
+	std::list<int> m_lru;                ///< indices of cached tiles, least recently used first
+	std::map<int, Tile> m_cache;         ///< tiles in memory
+	int m_lastIndex;                     ///< index of last used tile
+	Tile* m_last;                        ///< last used tile
+	ErrHandler message;                  ///< label of class to print out with message
+};
+
+#endif
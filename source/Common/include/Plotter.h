@@ -36,8 +36,14 @@
 #include <TH1.h>
 #include <TH2.h>
 #include <TH3.h>
+#include <TGraph.h>
+#include <TMultiGraph.h>
 #include "ErrHandler.h"
 #include "Config.h"
+#include "MeshPyramid.h"
+#include "SummedAreaTable.h"
+#include "HistoView.h"
+#include "ContourExtractor.h"
 
 #ifndef __Plotter__
 #define __Plotter__
@@ -50,14 +56,21 @@ public:
 	Plotter() : m_logscale(0), m_smooth(0), m_grid(0), m_ratio(0), m_plotStyle(""), m_ratioStyle(""), m_plotFormat(""), m_plotDir(""),
 			m_titleX(""), m_titleY(""), m_titleZ(""), m_unit(""), m_plotColor(Blue), m_markerSize(0.),
 			m_minBin(0), m_maxBin(0), m_markerStyle(0), m_lineStyle(0), m_lineWidth(0), m_nContour(0),
-			message("Plotter") {};
-	/// \brief Class destructor.
-	~Plotter() {};
+			m_pyramidRes(200), m_nthreads(0), m_summedArea(0), m_contourLines(0), m_contour(0), message("Plotter") {};
+	/// \brief Class destructor, delete summed-area tables and contour extractor
+	~Plotter();
 
 	/// \brief Set configuration
 	/// \param config pointer of Config object
 	void setStyle(Config* config);
 
+	/// \brief Switch ratio pad of comparison plots on or off
+	/// \param ratio draw ratios to the first histogram below comparison plots
+	void setRatio(bool ratio) { m_ratio = ratio; };
+
+	/// \brief Get if ratio pad of comparison plots is drawn
+	bool getRatio() const { return m_ratio; };
+
 	/// \brief Create single histogam plot
 	/// \param hist vector of histograms
 	void makeSinglePlot(std::vector<TH1*> hist);
@@ -76,6 +89,25 @@ public:
 	/// \param hist vector of histograms 
 	void makeHistPlots(std::vector<TH1*> hist);
 
+	/// \brief Create 2D projection plot of a 3D mesh, from the coarsest 
+	/// pyramid level which matches the plot resolution
+	/// \param levels mesh histogram and its downsampled levels with "mean" pooling (see \ref MeshPyramid)
+	/// \param plane projection plane (e.g. "XY")
+	/// \param firstBin first bin (of mesh histogram) of third axis included in projection
+	/// \param lastBin last bin (of mesh histogram) of third axis included in projection
+	/// \param weight scale projected histogram
+	void makeProj2DPlot(std::vector<TH3*> levels, TString plane, int firstBin, int lastBin, double weight = 1.);
+
+	/// \brief Delete summed-area tables of projected meshes, call it when
+	/// all bin ranges of a mesh are projected
+	void clearTables();
+
+	/// \brief Create comparison plot of graphs
+	/// \param graph vector of graphs
+	/// \param title vector of legends
+	/// \param name name of output file (without extension)
+	void makeGraphPlot(std::vector<TGraph*> graph, std::vector<TString> title, TString name);
+
 	/// \brief Create all histogams from a file
 	/// \param file pointer to \a TFile object
 	void makeFilePlot(TFile* file);
@@ -121,8 +153,12 @@ private:
 	TString m_plotStyle, m_ratioStyle, m_plotFormat, m_plotDir, m_titleX, m_titleY, m_titleZ, m_unit;
 	Color m_plotColor;
 	float m_markerSize;
-	int m_minBin, m_maxBin, m_markerStyle, m_lineStyle, m_lineWidth, m_nContour;
+	int m_minBin, m_maxBin, m_markerStyle, m_lineStyle, m_lineWidth, m_nContour, m_pyramidRes, m_nthreads;
+	bool m_summedArea, m_contourLines;
 	//@}
+
+	std::map<TH3*, SummedAreaTable*> m_tables;  ///< summed-area tables of projected meshes
+	ContourExtractor* m_contour;                ///< contour extractor of projections, created at first use
 	
 	ErrHandler message;  ///< label of class to print out with message
 
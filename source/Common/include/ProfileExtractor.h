@@ -0,0 +1,118 @@
+/**
+ * \class    ProfileExtractor
+ * \ingroup  Common
+ *
+ * \brief    Profiles along arbitrary lines and planes through a 3D mesh
+ *
+ * This class extracts line profiles (e.g. depth-dose or lateral profiles)
+ * and oblique plane cuts from a TH3 mesh (MCNP mesh tally or PTSim
+ * histogram), in the coordinates of the mesh axes.
+ *
+ * Line profiles are exact by default: the line is traced through the
+ * voxels (Siddon's method), giving the length of the line in each voxel.
+ * Without a number of bins, the profile has one bin per crossed voxel
+ * (bin edges at the voxel boundaries along the line); with a number of
+ * bins, each profile bin is the length-weighted mean of the voxels it
+ * overlaps. Optionally the profile is instead interpolated (trilinear, see
+ * \ref MeshSampler) at the bin centers. The x-axis of a profile is the
+ * distance from the start point of the line.
+ *
+ * Plane cuts are sampled on a regular grid spanned by two vectors from an
+ * origin, with the value of the voxel containing each point or with
+ * trilinear interpolation.
+ *
+ * Many profiles of the same mesh are made together: exact profiles are
+ * traced in parallel by the threads of a \ref ThreadPool, interpolated
+ * profiles and planes are sampled as one batch of points.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ProfileExtractor.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+#include "MeshSampler.h"
+
+#ifndef __ProfileExtractor__
+#define __ProfileExtractor__
+
+class ProfileExtractor {
+
+public:
+	/// \brief Class constructor
+	/// \param hist 3D mesh histogram (TH3F or TH3D)
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	ProfileExtractor(TH3* hist, int nthreads = 0);
+
+	/// \brief Class destructor
+	~ProfileExtractor() {};
+
+	/// \brief Make profile along a line
+	/// \param start coordinates x, y, z of start point
+	/// \param end coordinates x, y, z of end point
+	/// \param name name of new histogram
+	/// \param nbins number of bins (0 for one bin per crossed voxel)
+	/// \param interpolate interpolate at bin centers instead of exact voxel intersections
+	/// \return TH1D histogram (0 for wrong points)
+	TH1D* line(std::vector<double> start, std::vector<double> end, TString name, int nbins = 0, bool interpolate = false);
+
+	/// \brief Make profiles along many lines
+	/// \param start coordinates of start points (x, y, z for each line)
+	/// \param end coordinates of end points (x, y, z for each line)
+	/// \param name names of new histograms
+	/// \param nbins number of bins (0 for one bin per crossed voxel)
+	/// \param interpolate interpolate at bin centers instead of exact voxel intersections
+	/// \return vector of TH1D histograms (0 for wrong points)
+	std::vector<TH1D*> lines(std::vector< std::vector<double> > start, std::vector< std::vector<double> > end, std::vector<TString> name,
+			int nbins = 0, bool interpolate = false);
+
+	/// \brief Make cut on a plane
+	/// \param origin coordinates x, y, z of a corner of the plane
+	/// \param u vector of first (horizontal) side of the plane
+	/// \param v vector of second (vertical) side of the plane
+	/// \param nu number of bins along \a u
+	/// \param nv number of bins along \a v
+	/// \param name name of new histogram
+	/// \param interpolate trilinear interpolation instead of voxel values
+	/// \return TH2D histogram (0 for wrong vectors)
+	TH2D* plane(std::vector<double> origin, std::vector<double> u, std::vector<double> v, int nu, int nv, TString name, bool interpolate = true);
+
+private:
+	/// \brief Voxel segments of a line
+	struct Segment {
+		std::vector<double> edge;   ///< distances of voxel boundaries along the line
+		std::vector<int> bin;       ///< global bins of crossed voxels
+	};
+
+	/// \brief Trace a line through the voxels
+	/// \param start,end start and end points
+	/// \param segment crossed voxels (output)
+	void trace(const double* start, const double* end, Segment& segment) const;
+
+	/// \brief Make histogram of exact profile from traced voxels
+	TH1D* makeExact(const Segment& segment, double length, TString name, int nbins);
+
+	/// \brief Find global bin of the voxel containing a point
+	/// \return bin (-1 outside of the mesh)
+	int findBin(const double* point) const;
+
+	/// \brief Check that a vector has 3 coordinates
+	bool checkPoint(const std::vector<double>& point, TString what);
+
+	TH3* m_hist;                     ///< mesh histogram
+	int m_nthreads;                  ///< number of threads
+	std::vector<double> m_edge[3];   ///< bin boundaries of axes
+	ThreadPool m_pool;               ///< threads tracing lines
+	ErrHandler message;              ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * \class    ResponseFunction
+ * \ingroup  Common
+ *
+ * \brief    Energy-dependent response (e.g. flux-to-dose conversion factors)
+ *
+ * This class keeps a response curve given at tabulated energies (e.g. the
+ * ICRP-74 flux-to-dose conversion factors) and interpolates it
+ * logarithmically in energy and response, as done for the DE/DF cards of
+ * MCNP. Segments with zero or negative values are interpolated linearly.
+ * Outside of the tabulated energies the first or last factor is used.
+ *
+ * \ref getFactors() gives one factor per bin of an energy binning, so an
+ * energy-binned mesh is folded with the response by a weighted sum of its
+ * energy bin meshes (see \ref MeshKernels::weightedSum()).
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ResponseFunction.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include "ErrHandler.h"
+
+#ifndef __ResponseFunction__
+#define __ResponseFunction__
+
+class ResponseFunction {
+
+public:
+	/// \brief Class constructor
+	ResponseFunction() : message("ResponseFunction") {};
+
+	/// \brief Class destructor
+	~ResponseFunction() {};
+
+	/// \brief Read response curve from text file
+	/// \param filename name of file with energy and factor on each line ('#' for comments)
+	/// \return false if the file can not be read or has no valid curve
+	bool read(TString filename);
+
+	/// \brief Set response curve
+	/// \param energy tabulated energies (increasing)
+	/// \param factor response factors at energies
+	/// \return false for wrong curve
+	bool set(std::vector<double> energy, std::vector<double> factor);
+
+	/// \brief Interpolate response at an energy
+	/// \param energy energy
+	/// \return response factor
+	double eval(double energy) const;
+
+	/// \brief Get response factors of energy bins
+	/// \param edge energy bin boundaries
+	/// \return factors at the centers of energy bins (geometric center for positive energies)
+	std::vector<double> getFactors(const std::vector<double>& edge);
+
+	/// \brief Get number of tabulated points
+	int getSize() const { return (int)m_energy.size(); };
+
+private:
+	std::vector<double> m_energy;  ///< tabulated energies
+	std::vector<double> m_factor;  ///< tabulated response factors
+	ErrHandler message;            ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * \class    SparseMesh
+ * \ingroup  Common
+ *
+ * \brief    Block-sparse 3D mesh container for mostly empty meshes
+ *
+ * This class keeps a 3D mesh (values and errors) as a grid of cubic
+ * blocks of (b,b,b) bins, where only the blocks holding a non-zero value
+ * or error are allocated. Shielding meshes are often mostly zeros outside
+ * of the beam path, so they need only a fraction of the memory of a TH3F
+ * histogram. Bins of empty blocks read as zero, and setting a zero value
+ * in an empty block does not allocate it, so a mesh can be filled bin by
+ * bin (e.g. by \ref MeshTallyReader) without ever being dense.
+ *
+ * Merging (\ref add()), ratios (\ref makeRatio()) and projections
+ * (\ref makeProjection()) only visit the allocated blocks and are split
+ * over the threads of a \ref ThreadPool block by block. A TH3F histogram
+ * is only made on demand by \ref toHisto(). In a ROOT file the mesh is
+ * written as a sub-directory with the indices of the allocated blocks and
+ * their values and squared errors (see \ref write() and \ref open()).
+ *
+ * The bin numbers used in this class start from 1, as in ROOT histograms.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     SparseMesh.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TDirectory.h>
+#include <TArrayI.h>
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3F.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+
+#ifndef __SparseMesh__
+#define __SparseMesh__
+
+class SparseMesh {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	SparseMesh(int nthreads = 0);
+
+	/// \brief Class destructor, stop threads
+	~SparseMesh();
+
+	/// \brief Create a new empty mesh
+	/// \param name name of mesh
+	/// \param title title of mesh
+	/// \param xedge bin boundaries of x-axis
+	/// \param yedge bin boundaries of y-axis
+	/// \param zedge bin boundaries of z-axis
+	/// \param block number of bins per block on each axis
+	/// \return true if the mesh was created
+	bool create(TString name, TString title, const std::vector<double>& xedge, const std::vector<double>& yedge, const std::vector<double>& zedge,
+	            int block = 8);
+
+	/// \brief Create a new mesh from a 3D histogram, keeping only its non-empty blocks
+	/// \param hist 3-dimension histogram (TH3F or TH3D)
+	/// \param name name of mesh (histogram name if empty)
+	/// \param block number of bins per block on each axis
+	/// \return true if the mesh was created
+	bool create(TH3* hist, TString name = "", int block = 8);
+
+	/// \brief Read a mesh written by \ref write()
+	/// \param dir pointer of parent directory (e.g. \a TFile object)
+	/// \param name name of mesh
+	/// \return true if the mesh was found
+	bool open(TDirectory* dir, TString name);
+
+	/// \brief Write the allocated blocks and mesh information to a directory
+	/// \param dir pointer of parent directory (e.g. \a TFile object)
+	/// \return true if the mesh was written
+	bool write(TDirectory* dir);
+
+	/// \brief Get value of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \return bin value
+	double getBinContent(int ix, int iy, int iz) const;
+
+	/// \brief Get error of a bin
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \return bin error
+	double getBinError(int ix, int iy, int iz) const;
+
+	/// \brief Set value of a bin (a zero value does not allocate a block)
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param value bin value
+	void setBinContent(int ix, int iy, int iz, double value);
+
+	/// \brief Set error of a bin (a zero error does not allocate a block)
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param error bin error
+	void setBinError(int ix, int iy, int iz, double error);
+
+	/// \brief Add another mesh (same binning) block by block
+	/// \param other mesh to be added
+	/// \param weight factor of added values (errors are scaled by its absolute value)
+	/// \return false if the binning is different
+	bool add(const SparseMesh& other, double weight = 1.);
+
+	/// \brief Divide the mesh by another mesh, block by block
+	/// \param den denominator mesh (same binning)
+	/// \param out ratio mesh
+	/// \param name name of ratio mesh
+	/// \return false if the binning is different
+	bool makeRatio(const SparseMesh& den, SparseMesh& out, TString name);
+
+	/// \brief Create projection histogram from the allocated blocks
+	/// \param option projected axis or plane (as \a TH3::Project3D())
+	/// \param rangeX bin range on x-axis
+	/// \param rangeY bin range on y-axis
+	/// \param rangeZ bin range on z-axis
+	/// \param weight scale projected histogram (negative means normalize to 1)
+	/// \return TH1D or TH2D histogram
+	TH1* makeProjection(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight = 1.);
+
+	/// \brief Convert the mesh to a 3D histogram (needs memory of whole mesh)
+	/// \param name name of histogram (mesh name if empty)
+	/// \return 3-dimension histogram
+	TH3F* toHisto(TString name = "");
+
+	/// \brief Release the blocks which hold only zeros
+	/// \return number of released blocks
+	int compact();
+
+	/// \brief Get mesh name
+	TString getName() const { return m_name; };
+
+	/// \brief Get mesh title
+	TString getTitle() const { return m_title; };
+
+	/// \brief Get number of bins
+	/// \param axis axis index (0, 1, 2 for x, y, z)
+	int getNbins(int axis) const { return m_nbin[axis]; };
+
+	/// \brief Get bin boundaries
+	/// \param axis axis index (0, 1, 2 for x, y, z)
+	const std::vector<double>& getEdges(int axis) const { return m_edge[axis]; };
+
+	/// \brief Get number of blocks of the mesh
+	int getNblocks() const { return (int)m_blocks.size(); };
+
+	/// \brief Get number of allocated blocks
+	int getNfilled() const;
+
+	/// \brief Set number of threads
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	void setThreads(int nthreads);
+
+private:
+	SparseMesh(const SparseMesh&) = delete;
+	SparseMesh& operator=(const SparseMesh&) = delete;
+
+	/// \brief Get thread pool of mesh operations, start it at first use
+	ThreadPool& getPool();
+
+	/// \brief Block of bins, empty vectors for a block which is not allocated
+	struct Block {
+		std::vector<float> value;  ///< bin values
+		std::vector<float> error;  ///< squared bin errors
+	};
+
+	/// \brief Get block of a bin and position of the bin in the block
+	/// \param ix,iy,iz bin numbers (from 1)
+	/// \param pos position of the bin in the block
+	/// \return block index (-1 outside of the mesh)
+	int locate(int ix, int iy, int iz, int& pos) const;
+
+	/// \brief Get bin range of a block
+	/// \param index block index
+	/// \param lo,hi first and end bins (from 0) on each axis
+	void getRange(int index, int* lo, int* hi) const;
+
+	/// \brief Allocate a block filled with zeros if needed
+	void allocate(Block& block);
+
+	/// \brief Set bin numbers and block numbers from the bin boundaries
+	void setup();
+
+	/// \brief Check that another mesh has the same binning
+	bool checkBinning(const SparseMesh& other, TString what);
+
+	/// \brief Fill default values of bin ranges
+	void checkRange(std::vector<int>& range, int axis);
+
+	/// \brief Copy the non-empty blocks of a histogram
+	template<class T> void fillKernel(TH3* hist, const T* array);
+
+	TString m_name;                      ///< name of mesh
+	TString m_title;                     ///< title of mesh
+	std::vector<double> m_edge[3];       ///< bin boundaries of axes
+	int m_nbin[3];                       ///< number of bins of axes
+	int m_nblock[3];                     ///< number of blocks of axes
+	int m_block;                         ///< number of bins per block on each axis
+	int m_nthreads;                      ///< number of threads
+	ThreadPool* m_pool;                  ///< threads of mesh operations (0 before first operation)
+	std::vector<Block> m_blocks;         ///< all blocks, in x-fastest order
+	ErrHandler message;                  ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * \class    SummedAreaTable
+ * \ingroup  Common
+ *
+ * \brief    3D prefix sums of a mesh for fast box integrals and projections
+ *
+ * This class builds once the 3D prefix sums (summed-area table) of the bin
+ * values and of the squared bin errors of a TH3 mesh. Afterwards the sum
+ * over any box of bins costs 8 lookups, independent of the box size, and
+ * a projection on a plane (axis) over any bin range of the other axes
+ * costs one box sum per bin of the projection. Making projections for
+ * many \a First \a Bin / \a Last \a Bin settings therefore does not need
+ * a clone of the mesh and a full pass over it for every setting, as
+ * \a TH3::Project3D() does.
+ *
+ * The tables are kept in double precision and need 2 x (nx+1)(ny+1)(nz+1)
+ * doubles; as box sums are differences of large prefix sums, bins which
+ * are many orders of magnitude below the total of the mesh lose precision.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     SummedAreaTable.h
+ *
+ */
+
+#include <vector>
+#include <TString.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3.h>
+#include "ErrHandler.h"
+
+#ifndef __SummedAreaTable__
+#define __SummedAreaTable__
+
+class SummedAreaTable {
+
+public:
+	/// \brief Class constructor, build tables of a mesh
+	/// \param hist 3D mesh histogram
+	SummedAreaTable(TH3* hist);
+
+	/// \brief Class destructor
+	~SummedAreaTable() {};
+
+	/// \brief Sum of bin values in a box
+	/// \param x1,x2 first and last bin on x-axis
+	/// \param y1,y2 first and last bin on y-axis
+	/// \param z1,z2 first and last bin on z-axis
+	/// \return sum of bin values
+	double integral(int x1, int x2, int y1, int y2, int z1, int z2) const { return boxSum(m_value, x1, x2, y1, y2, z1, z2); };
+
+	/// \brief Sum of squared bin errors in a box
+	/// \param x1,x2 first and last bin on x-axis
+	/// \param y1,y2 first and last bin on y-axis
+	/// \param z1,z2 first and last bin on z-axis
+	/// \return sum of squared errors
+	double integralError2(int x1, int x2, int y1, int y2, int z1, int z2) const { return boxSum(m_error, x1, x2, y1, y2, z1, z2); };
+
+	/// \brief Create projection histogram (same option as \a TH3::Project3D())
+	/// \param option projected axis ("x", "y", "z") or plane ("yx", "zx",...)
+	/// \param rangeX bin range on x-axis (empty for all bins)
+	/// \param rangeY bin range on y-axis (empty for all bins)
+	/// \param rangeZ bin range on z-axis (empty for all bins)
+	/// \param name name of new histogram
+	/// \return TH1D or TH2D histogram (0 for wrong option)
+	TH1* project(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, TString name);
+
+	/// \brief Get name of indexed mesh
+	TString getName() const { return m_name; };
+
+private:
+	/// \brief Sum of table \a table over a box (8 lookups)
+	double boxSum(const std::vector<double>& table, int x1, int x2, int y1, int y2, int z1, int z2) const;
+
+	/// \brief Index of prefix sum of bins [1,i] x [1,j] x [1,k]
+	int index(int i, int j, int k) const { return i + (m_n[0]+1)*(j + (m_n[1]+1)*k); };
+
+	TString m_name, m_title;               ///< name and title of mesh
+	double m_entries;                      ///< number of entries of mesh
+	int m_n[3];                            ///< number of bins on axes
+	std::vector<double> m_edge[3];         ///< bin boundaries of axes
+	TString m_axisTitle[3];                ///< titles of axes
+	std::vector<double> m_value, m_error;  ///< prefix sums of values and squared errors
+	ErrHandler message;                    ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * \class    ThreadPool
+ * \ingroup  Common
+ *
+ * \brief    Pool of worker threads
+ *
+ * This class keeps a fixed number of worker threads which take jobs
+ * from a common queue. It is used to run independent jobs, e.g. parsing
+ * several MCNP output files, at the same time. Each submitted job returns
+ * a \a std::future so the caller can wait for the jobs in any order it
+ * wants (e.g. to write ROOT files from one thread only).
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ThreadPool.h
+ *
+ */
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include "ErrHandler.h"
+
+#ifndef __ThreadPool__
+#define __ThreadPool__
+
+class ThreadPool {
+
+public:
+	/// \brief Class constructor, start worker threads
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	ThreadPool(int nthreads = 0);
+
+	/// \brief Class destructor, finish queued jobs and join worker threads
+	~ThreadPool();
+
+	/// \brief Add a job to the queue
+	/// \param job function to be executed
+	/// \return future which becomes ready when the job is done
+	std::future<void> submit(std::function<void()> job);
+
+	/// \brief Run a job on chunks of an index range and wait for all of them
+	/// \param begin first index
+	/// \param end index after the last one
+	/// \param job function called with the first and end index of a chunk
+	/// \param chunk number of indices per chunk (0 means a few chunks per thread)
+	void parallelFor(int begin, int end, std::function<void(int,int)> job, int chunk = 0);
+
+	/// \brief Get number of worker threads
+	/// \return number of threads
+	int size() const { return (int)m_workers.size(); }
+
+	/// \brief Get default number of threads
+	/// \param nthreads requested number of threads (0 means number of CPU cores)
+	/// \return number of threads to be used
+	static int defaultSize(int nthreads = 0);
+
+private:
+	/// \brief Loop of worker thread, takes and executes jobs from queue
+	void work();
+
+	std::vector<std::thread> m_workers;                  ///< worker threads
+	std::queue< std::packaged_task<void()> > m_jobs;     ///< queue of waiting jobs
+	std::mutex m_mutex;                                  ///< lock of job queue
+	std::condition_variable m_condition;                 ///< signal of new job or stop
+	bool m_stop;                                         ///< stop flag of worker threads
+	ErrHandler message;                                  ///< label of class to print out with message
+};
+
+#endif
@@ -0,0 +1,385 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ContourExtractor.cxx
+ *
+ */
+
+#include "ContourExtractor.h"
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+/// Tetrahedra of a cube around its diagonal 0-7 (corner = dx + 2dy + 4dz)
+static const int kTetra[6][4] = { {0,7,1,3}, {0,7,3,2}, {0,7,2,6}, {0,7,6,4}, {0,7,4,5}, {0,7,5,1} };
+
+/***************************************************************************/
+/**
+ * This function gives the segments (pairs of cell edges 0: bottom,
+ * 1: right, 2: top, 3: left) of a marching squares case; saddles are
+ * resolved with the value at the cell center.
+ */
+static int squareSegments(int index, bool centerAbove, int* seg)
+{
+	static const int table[16][4] = {
+		{-1,-1,-1,-1}, {3,0,-1,-1}, {0,1,-1,-1}, {3,1,-1,-1},
+		{1,2,-1,-1},   {-1,-1,-1,-1}, {0,2,-1,-1}, {3,2,-1,-1},
+		{2,3,-1,-1},   {0,2,-1,-1}, {-1,-1,-1,-1}, {1,2,-1,-1},
+		{1,3,-1,-1},   {0,1,-1,-1}, {3,0,-1,-1}, {-1,-1,-1,-1} };
+	if (index == 5 || index == 10) {
+		// corners 0,2 (case 5) or 1,3 (case 10) above: cut off either
+		// corners 1 and 3 or corners 0 and 2
+		static const int cut13[4] = { 0,1, 2,3 };
+		static const int cut02[4] = { 3,0, 1,2 };
+		const int* s = ((index == 5) == centerAbove ? cut13 : cut02);
+		std::copy(s, s+4, seg);
+		return 2;
+	}
+	std::copy(table[index], table[index]+4, seg);
+	return (seg[0] < 0 ? 0 : 1);
+}
+
+/***************************************************************************/
+/**
+ * This method gives the float or double bin array of a histogram.
+ */
+bool ContourExtractor::getArray(TH1* hist, const float*& arrayF, const double*& arrayD)
+{
+	arrayF = 0;
+	arrayD = 0;
+	if (TArrayF* array = dynamic_cast<TArrayF*>(hist))
+		arrayF = array->GetArray();
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(hist))
+		arrayD = array->GetArray();
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", hist->GetName() ) );
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method returns \a n levels between the minimum (or the smallest
+ * positive value for \a logscale) and the maximum of the histogram,
+ * without the limits themselves.
+ */
+std::vector<double> ContourExtractor::makeLevels(TH1* hist, int n, bool logscale)
+{
+	double low = hist->GetMinimum(), up = hist->GetMaximum();
+	if (logscale)
+		low = hist->GetMinimum(0.);
+	std::vector<double> levels;
+	for (int i = 1; i <= n; ++i) {
+		if (logscale && low > 0.)
+			levels.push_back( low * std::pow(up/low, (double)i/(n+1)) );
+		else
+			levels.push_back( low + (up-low)*i/(n+1) );
+	}
+	return levels;
+}
+
+/***************************************************************************/
+/**
+ * This method runs marching squares on the grid of bin centers, slab of
+ * cell rows by slab, and joins the segments of each level at their
+ * shared grid edges into polylines. Grid edges are numbered 2 x node
+ * (+1 for the edge along y) with node = i + nx*j.
+ */
+std::vector<ContourLine> ContourExtractor::contours(TH2* hist, std::vector<double> levels)
+{
+	std::vector<ContourLine> lines;
+	const float* arrayF;
+	const double* arrayD;
+	if (!getArray(hist, arrayF, arrayD))
+		return lines;
+	int nx = hist->GetXaxis()->GetNbins(), ny = hist->GetYaxis()->GetNbins();
+	if (nx < 2 || ny < 2) {
+		ERROR( TString::Format( "Histogram '%s' needs at least 2 bins on each axis for contours", hist->GetName() ) );
+		return lines;
+	}
+	std::vector<double> cx(nx), cy(ny);
+	for (int i = 0; i < nx; ++i) cx[i] = hist->GetXaxis()->GetBinCenter(i+1);
+	for (int j = 0; j < ny; ++j) cy[j] = hist->GetYaxis()->GetBinCenter(j+1);
+	auto value = [&](int i, int j) { int bin = (i+1) + (nx+2)*(j+1); return (arrayF ? (double)arrayF[bin] : arrayD[bin]); };
+
+	int chunk = std::max(1, (ny-1) / (4*m_pool.size()) + 1);
+	int nchunk = (ny-1 + chunk-1) / chunk;
+	for (size_t l = 0; l < levels.size(); ++l) {
+		double level = levels[l];
+
+		// segments of cells, per slab
+		std::vector< std::vector<long long> > slab(nchunk);
+		m_pool.parallelFor(0, ny-1, [&](int first, int last) {
+			std::vector<long long>& seg = slab[first/chunk];
+			for (int j = first; j < last; ++j)
+				for (int i = 0; i+1 < nx; ++i) {
+					double v[4] = { value(i,j), value(i+1,j), value(i+1,j+1), value(i,j+1) };
+					int index = (v[0] > level) | (v[1] > level) << 1 | (v[2] > level) << 2 | (v[3] > level) << 3;
+					if (index == 0 || index == 15) continue;
+					long long edge[4] = { 2LL*(i+nx*j), 2LL*(i+1+nx*j)+1, 2LL*(i+nx*(j+1)), 2LL*(i+nx*j)+1 };
+					int s[4];
+					int nseg = squareSegments(index, 0.25*(v[0]+v[1]+v[2]+v[3]) > level, s);
+					for (int k = 0; k < nseg; ++k) {
+						seg.push_back( edge[s[2*k]] );
+						seg.push_back( edge[s[2*k+1]] );
+					}
+				}
+		}, chunk);
+		std::vector<long long> seg;
+		for (int c = 0; c < nchunk; ++c)
+			seg.insert(seg.end(), slab[c].begin(), slab[c].end());
+
+		// join segments at shared edges
+		int nseg = (int)seg.size()/2;
+		std::unordered_map<long long, std::pair<int,int> > link;
+		for (int s = 0; s < nseg; ++s)
+			for (int e = 0; e < 2; ++e) {
+				std::unordered_map<long long, std::pair<int,int> >::iterator it = link.find(seg[2*s+e]);
+				if (it == link.end())
+					link[seg[2*s+e]] = std::make_pair(s, -1);
+				else
+					it->second.second = s;
+			}
+		auto point = [&](long long edge, double& x, double& y) {
+			long long node = edge/2;
+			int i = (int)(node % nx), j = (int)(node / nx);
+			int i2 = i + (edge % 2 == 0 ? 1 : 0), j2 = j + (edge % 2 == 1 ? 1 : 0);
+			double va = value(i,j), vb = value(i2,j2);
+			double t = (level - va) / (vb - va);
+			x = cx[i] + t*(cx[i2]-cx[i]);
+			y = cy[j] + t*(cy[j2]-cy[j]);
+		};
+		std::vector<bool> used(nseg, false);
+		for (int pass = 0; pass < 2; ++pass)
+			for (int s0 = 0; s0 < nseg; ++s0) {
+				if (used[s0]) continue;
+				// open polylines start at an edge with one segment
+				long long start = seg[2*s0];
+				if (pass == 0) {
+					if (link[seg[2*s0]].second >= 0 && link[seg[2*s0+1]].second >= 0) continue;
+					if (link[start].second >= 0) start = seg[2*s0+1];
+				}
+				ContourLine line;
+				line.level = level;
+				double x, y;
+				point(start, x, y);
+				line.x.push_back(x);
+				line.y.push_back(y);
+				long long edge = start;
+				int s = s0;
+				while (s >= 0 && !used[s]) {
+					used[s] = true;
+					edge = (seg[2*s] == edge ? seg[2*s+1] : seg[2*s]);
+					point(edge, x, y);
+					line.x.push_back(x);
+					line.y.push_back(y);
+					const std::pair<int,int>& p = link[edge];
+					s = (p.first == s ? p.second : p.first);
+				}
+				line.closed = (edge == start);
+				if (line.closed) {
+					line.x.pop_back();
+					line.y.pop_back();
+				}
+				lines.push_back(line);
+			}
+	}
+	DEBUG( TString::Format( "%d contour lines of '%s'", (int)lines.size(), hist->GetName() ) );
+	return lines;
+}
+
+/***************************************************************************/
+/**
+ * This method runs marching tetrahedra on the grid of bin centers, slab of
+ * cell layers by slab. Vertices lie on the edges of the tetrahedra, which
+ * connect grid nodes with offsets (dx,dy,dz) in {0,1}^3; they are numbered
+ * 7 x node + offset - 1 (node = i + nx*(j + ny*k)) and shared first inside
+ * a slab, then between the slabs.
+ */
+IsoSurface ContourExtractor::isosurface(TH3* hist, double level)
+{
+	IsoSurface surface;
+	surface.level = level;
+	const float* arrayF;
+	const double* arrayD;
+	if (!getArray(hist, arrayF, arrayD))
+		return surface;
+	int n[3] = { hist->GetXaxis()->GetNbins(), hist->GetYaxis()->GetNbins(), hist->GetZaxis()->GetNbins() };
+	if (n[0] < 2 || n[1] < 2 || n[2] < 2) {
+		ERROR( TString::Format( "Histogram '%s' needs at least 2 bins on each axis for isosurfaces", hist->GetName() ) );
+		return surface;
+	}
+	std::vector<double> c[3];
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a)
+		for (int i = 1; i <= n[a]; ++i)
+			c[a].push_back( axis[a]->GetBinCenter(i) );
+	int sy = n[0]+2, sz = (n[0]+2)*(n[1]+2);
+
+	struct Slab {
+		std::vector<long long> key;
+		std::vector<double> vertex;
+		std::vector<int> triangle;
+	};
+	int chunk = std::max(1, (n[2]-1) / (4*m_pool.size()) + 1);
+	int nchunk = (n[2]-1 + chunk-1) / chunk;
+	std::vector<Slab> slab(nchunk);
+	m_pool.parallelFor(0, n[2]-1, [&](int first, int last) {
+		Slab& out = slab[first/chunk];
+		std::unordered_map<long long, int> index;
+		for (int k = first; k < last; ++k)
+		for (int j = 0; j+1 < n[1]; ++j)
+		for (int i = 0; i+1 < n[0]; ++i) {
+			double v[8];
+			int above = 0;
+			for (int b = 0; b < 8; ++b) {
+				int bin = (i+1+(b&1)) + sy*(j+1+((b>>1)&1)) + sz*(k+1+((b>>2)&1));
+				v[b] = (arrayF ? (double)arrayF[bin] : arrayD[bin]);
+				above += (v[b] > level);
+			}
+			if (above == 0 || above == 8) continue;
+
+			// vertex on edge between cube corners a and b
+			auto vertex = [&](int a, int b) {
+				int lo = ((a & b) == a ? a : b), hi = (lo == a ? b : a);
+				long long node = (i+(lo&1)) + (long long)n[0]*((j+((lo>>1)&1)) + (long long)n[1]*(k+((lo>>2)&1)));
+				long long key = 7*node + (hi ^ lo) - 1;
+				std::unordered_map<long long, int>::iterator it = index.find(key);
+				if (it != index.end())
+					return it->second;
+				double t = (level - v[a]) / (v[b] - v[a]);
+				int ia[3] = { i+(a&1), j+((a>>1)&1), k+((a>>2)&1) };
+				int ib[3] = { i+(b&1), j+((b>>1)&1), k+((b>>2)&1) };
+				for (int d = 0; d < 3; ++d)
+					out.vertex.push_back( c[d][ia[d]] + t*(c[d][ib[d]] - c[d][ia[d]]) );
+				int id = (int)out.key.size();
+				out.key.push_back(key);
+				index[key] = id;
+				return id;
+			};
+			// triangle oriented with normal from inside (above) to outside
+			auto triangle = [&](int t0, int t1, int t2, const double* dir) {
+				const double* p0 = &out.vertex[3*t0];
+				const double* p1 = &out.vertex[3*t1];
+				const double* p2 = &out.vertex[3*t2];
+				double u[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+				double w[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+				double nrm[3] = { u[1]*w[2]-u[2]*w[1], u[2]*w[0]-u[0]*w[2], u[0]*w[1]-u[1]*w[0] };
+				out.triangle.push_back(t0);
+				if (nrm[0]*dir[0] + nrm[1]*dir[1] + nrm[2]*dir[2] >= 0.) {
+					out.triangle.push_back(t1);
+					out.triangle.push_back(t2);
+				} else {
+					out.triangle.push_back(t2);
+					out.triangle.push_back(t1);
+				}
+			};
+
+			for (int t = 0; t < 6; ++t) {
+				const int* tet = kTetra[t];
+				int in[4], outc[4], nin = 0, nout = 0;
+				double dir[3] = { 0., 0., 0. };
+				for (int q = 0; q < 4; ++q) {
+					int b = tet[q];
+					double sign = (v[b] > level ? -1. : 1.);
+					if (v[b] > level) in[nin++] = b;
+					else outc[nout++] = b;
+					dir[0] += sign*(b&1);
+					dir[1] += sign*((b>>1)&1);
+					dir[2] += sign*((b>>2)&1);
+				}
+				if (nin == 0 || nin == 4) continue;
+				if (nin == 1 || nin == 3) {
+					int p = (nin == 1 ? in[0] : outc[0]);
+					const int* q = (nin == 1 ? outc : in);
+					triangle( vertex(p,q[0]), vertex(p,q[1]), vertex(p,q[2]), dir );
+				} else {
+					int e0 = vertex(in[0],outc[0]), e1 = vertex(in[0],outc[1]);
+					int e2 = vertex(in[1],outc[1]), e3 = vertex(in[1],outc[0]);
+					triangle(e0, e1, e2, dir);
+					triangle(e0, e2, e3, dir);
+				}
+			}
+		}
+	}, chunk);
+
+	// share vertices between slabs
+	std::unordered_map<long long, int> index;
+	for (int s = 0; s < nchunk; ++s) {
+		std::vector<int> global(slab[s].key.size());
+		for (size_t v = 0; v < slab[s].key.size(); ++v) {
+			std::unordered_map<long long, int>::iterator it = index.find(slab[s].key[v]);
+			if (it != index.end())
+				global[v] = it->second;
+			else {
+				global[v] = (int)surface.vertex.size()/3;
+				index[slab[s].key[v]] = global[v];
+				surface.vertex.insert(surface.vertex.end(), slab[s].vertex.begin()+3*v, slab[s].vertex.begin()+3*v+3);
+			}
+		}
+		for (size_t t = 0; t < slab[s].triangle.size(); ++t)
+			surface.triangle.push_back( global[slab[s].triangle[t]] );
+	}
+	DEBUG( TString::Format( "Isosurface %g of '%s': %d vertices, %d triangles", level, hist->GetName(),
+			(int)surface.vertex.size()/3, (int)surface.triangle.size()/3 ) );
+	return surface;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the polylines as columns "x y", with a comment line
+ * giving the level before each polyline and an empty line after it (the
+ * first point is repeated at the end of closed polylines).
+ */
+bool ContourExtractor::writeContours(const std::vector<ContourLine>& lines, TString filename)
+{
+	std::ofstream out(filename.Data());
+	if (!out.is_open()) {
+		ERROR("Unable to open file '"+filename+"'!");
+		return false;
+	}
+	for (size_t l = 0; l < lines.size(); ++l) {
+		out << "# level " << lines[l].level << std::endl;
+		for (size_t p = 0; p < lines[l].x.size(); ++p)
+			out << lines[l].x[p] << " " << lines[l].y[p] << std::endl;
+		if (lines[l].closed && lines[l].x.size() > 0)
+			out << lines[l].x[0] << " " << lines[l].y[0] << std::endl;
+		out << std::endl;
+	}
+	out.close();
+	MESSAGE( TString::Format( "Write %d contour lines to '%s'", (int)lines.size(), filename.Data() ) );
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the vertices ("v x y z") and triangles ("f i j k",
+ * indices starting from 1) of the isosurface.
+ */
+bool ContourExtractor::writeSurface(const IsoSurface& surface, TString filename)
+{
+	std::ofstream out(filename.Data());
+	if (!out.is_open()) {
+		ERROR("Unable to open file '"+filename+"'!");
+		return false;
+	}
+	out << "# isosurface level " << surface.level << std::endl;
+	char buf[128];
+	for (size_t v = 0; v+2 < surface.vertex.size(); v += 3) {
+		snprintf(buf, sizeof(buf), "v %g %g %g\n", surface.vertex[v], surface.vertex[v+1], surface.vertex[v+2]);
+		out << buf;
+	}
+	for (size_t t = 0; t+2 < surface.triangle.size(); t += 3) {
+		snprintf(buf, sizeof(buf), "f %d %d %d\n", surface.triangle[t]+1, surface.triangle[t+1]+1, surface.triangle[t+2]+1);
+		out << buf;
+	}
+	out.close();
+	MESSAGE( TString::Format( "Write isosurface (%d triangles) to '%s'", (int)surface.triangle.size()/3, filename.Data() ) );
+	return true;
+}
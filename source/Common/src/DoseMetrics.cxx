@@ -0,0 +1,170 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     DoseMetrics.cxx
+ *
+ */
+
+#include "DoseMetrics.h"
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This is constructor of DoseMetrics class, it sets the depth axis (z if
+ * \a depthAxis is not "x", "y" or "z").
+ */
+DoseMetrics::DoseMetrics(TString depthAxis) : message("DoseMetrics")
+{
+	depthAxis.ToLower();
+	m_depth = (depthAxis.Length() == 1 ? depthAxis[0]-'x' : 2);
+	if (m_depth < 0 || m_depth > 2) {
+		WARN("Undefined depth axis '"+depthAxis+"', z-axis is used");
+		m_depth = 2;
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method walks along \a profile from \a start in direction \a step
+ * until the dose is below \a level, and interpolates the position of the
+ * crossing between the centers of the last two bins.
+ */
+bool DoseMetrics::findCrossing(const std::vector<double>& profile, const std::vector<double>& center, int start, int step, double level, double& pos)
+{
+	int n = (int)profile.size();
+	for (int j = start+step; j >= 0 && j < n; j += step) {
+		if (profile[j] >= level) continue;
+		int k = j-step;
+		double f = (profile[k] > profile[j] ? (profile[k]-level)/(profile[k]-profile[j]) : 0.);
+		pos = center[k] + f*(center[j]-center[k]);
+		return true;
+	}
+	return false;
+}
+
+/***************************************************************************/
+/**
+ * This method finds the Bragg peak, entrance dose and distal ranges of a
+ * depth-dose curve. The peak depth is the vertex of the parabola through
+ * the maximum bin and its two neighbours.
+ */
+int DoseMetrics::depthMetrics(const std::vector<double>& dose, const std::vector<double>& center, DoseProfileMetrics& metrics)
+{
+	int n = (int)dose.size();
+	int ipeak = (int)( std::max_element(dose.begin(), dose.end()) - dose.begin() );
+	metrics.peakDose     = dose[ipeak];
+	metrics.peakDepth    = center[ipeak];
+	metrics.entranceDose = dose[0];
+	if (ipeak > 0 && ipeak < n-1) {
+		double d0 = dose[ipeak-1], d1 = dose[ipeak], d2 = dose[ipeak+1];
+		double denom = d0 - 2.*d1 + d2;
+		if (denom < 0.) {
+			double shift = 0.5*(d0 - d2)/denom;
+			metrics.peakDepth = center[ipeak] + shift*(shift > 0. ? center[ipeak+1]-center[ipeak] : center[ipeak]-center[ipeak-1]);
+		}
+	}
+	metrics.r90 = metrics.r80 = -1.;
+	if (!findCrossing(dose, center, ipeak, 1, 0.9*metrics.peakDose, metrics.r90) ||
+	    !findCrossing(dose, center, ipeak, 1, 0.8*metrics.peakDose, metrics.r80))
+		WARN("Dose does not fall below 80% of the peak behind the Bragg peak, distal range is not found");
+	return ipeak;
+}
+
+/***************************************************************************/
+/**
+ * This method computes the distances between the 80% and 20% crossings of
+ * the profile maximum on both sides of the maximum, and returns their
+ * mean (or the width of the only side found).
+ */
+double DoseMetrics::penumbra(const std::vector<double>& profile, const std::vector<double>& center)
+{
+	int imax = (int)( std::max_element(profile.begin(), profile.end()) - profile.begin() );
+	double pmax = profile[imax];
+	if (pmax <= 0.)
+		return -1.;
+	double sum = 0.;
+	int nside = 0;
+	for (int step = -1; step <= 1; step += 2) {
+		double x80, x20;
+		if (findCrossing(profile, center, imax, step, 0.8*pmax, x80) && findCrossing(profile, center, imax, step, 0.2*pmax, x20)) {
+			sum += std::fabs(x20 - x80);
+			++nside;
+		}
+	}
+	return (nside > 0 ? sum/nside : -1.);
+}
+
+/***************************************************************************/
+/**
+ * This method computes the metrics of a 3D dose histogram (depth-dose
+ * curve integrated over the lateral bins, lateral profiles in the slice
+ * of the peak) or of a 1D depth-dose histogram.
+ */
+bool DoseMetrics::compute(TH1* hist, DoseProfileMetrics& metrics)
+{
+	metrics.peakDepth = metrics.peakDose = metrics.entranceDose = metrics.r90 = metrics.r80 = -1.;
+	metrics.penumbra[0] = metrics.penumbra[1] = -1.;
+	if (!hist || hist->GetMaximum() <= 0.) {
+		ERROR("Histogram '"+TString(hist ? hist->GetName() : "")+"' has no positive dose");
+		return false;
+	}
+
+	TH3* hist3D = dynamic_cast<TH3*>(hist);
+	if (!hist3D) {
+		int n = hist->GetNbinsX();
+		std::vector<double> dose(n), center(n);
+		for (int i = 0; i < n; ++i) {
+			dose[i]   = hist->GetBinContent(i+1);
+			center[i] = hist->GetXaxis()->GetBinCenter(i+1);
+		}
+		depthMetrics(dose, center, metrics);
+		return true;
+	}
+
+	// depth-dose curve integrated over lateral bins
+	const TAxis* axis[3] = { hist3D->GetXaxis(), hist3D->GetYaxis(), hist3D->GetZaxis() };
+	int n[3] = { axis[0]->GetNbins(), axis[1]->GetNbins(), axis[2]->GetNbins() };
+	int lat[2] = { (m_depth == 0 ? 1 : 0), (m_depth == 2 ? 1 : 2) };
+	std::vector<double> center[3];
+	for (int a = 0; a < 3; ++a)
+		for (int i = 1; i <= n[a]; ++i)
+			center[a].push_back( axis[a]->GetBinCenter(i) );
+	std::vector<double> depthDose(n[m_depth], 0.);
+	int b[3];
+	for (b[2] = 1; b[2] <= n[2]; ++b[2])
+		for (b[1] = 1; b[1] <= n[1]; ++b[1])
+			for (b[0] = 1; b[0] <= n[0]; ++b[0])
+				depthDose[b[m_depth]-1] += hist3D->GetBinContent(b[0], b[1], b[2]);
+	int ipeak = depthMetrics(depthDose, center[m_depth], metrics);
+
+	// lateral profiles through the dose-weighted beam center in the slice of the peak
+	int nu = n[lat[0]], nv = n[lat[1]];
+	std::vector<double> slice(nu*nv);
+	double sum = 0., su = 0., sv = 0.;
+	b[m_depth] = ipeak+1;
+	for (int v = 0; v < nv; ++v)
+		for (int u = 0; u < nu; ++u) {
+			b[lat[0]] = u+1;
+			b[lat[1]] = v+1;
+			double d = hist3D->GetBinContent(b[0], b[1], b[2]);
+			slice[u + nu*v] = d;
+			if (d <= 0.) continue;
+			sum += d;
+			su  += d*u;
+			sv  += d*v;
+		}
+	if (sum <= 0.)
+		return true;
+	int cu = (int)std::floor(su/sum + 0.5), cv = (int)std::floor(sv/sum + 0.5);
+	std::vector<double> pu(nu), pv(nv);
+	for (int u = 0; u < nu; ++u)
+		pu[u] = slice[u + nu*cv];
+	for (int v = 0; v < nv; ++v)
+		pv[v] = slice[cu + nu*v];
+	metrics.penumbra[0] = penumbra(pu, center[lat[0]]);
+	metrics.penumbra[1] = penumbra(pv, center[lat[1]]);
+	return true;
+}
@@ -0,0 +1,256 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     DoseVolumeHistogram.cxx
+ *
+ */
+
+#include "DoseVolumeHistogram.h"
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This method adds a box structure with limits \a range.
+ */
+bool DoseVolumeHistogram::addBox(TString name, std::vector<double> range)
+{
+	if (range.size() != 6) {
+		ERROR( TString::Format( "Box '%s' needs 6 limits (has %d)", name.Data(), (int)range.size() ) );
+		return false;
+	}
+	Structure s;
+	s.name  = name;
+	s.type  = BOX;
+	s.axis  = 0;
+	s.label = 0;
+	for (int i = 0; i < 6; ++i)
+		s.param[i] = range[i];
+	m_structure.push_back(s);
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method adds a cylinder structure along axis \a axis.
+ */
+bool DoseVolumeHistogram::addCylinder(TString name, TString axis, std::vector<double> param)
+{
+	axis.ToLower();
+	int a = (axis.Length() == 1 ? axis[0]-'x' : -1);
+	if (a < 0 || a > 2 || param.size() != 5) {
+		ERROR("Cylinder '"+name+"' needs axis x, y or z and 5 parameters (center, radius, lower and upper limits)");
+		return false;
+	}
+	Structure s;
+	s.name  = name;
+	s.type  = CYLINDER;
+	s.axis  = a;
+	s.label = 0;
+	for (int i = 0; i < 5; ++i)
+		s.param[i] = param[i];
+	s.param[5] = 0.;
+	m_structure.push_back(s);
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method adds one structure per value of \a values of the label
+ * volume \a label. Only one label volume can be used.
+ */
+bool DoseVolumeHistogram::addLabels(TH3* label, std::vector<int> values, std::vector<TString> names)
+{
+	if (!label || (m_label && m_label != label)) {
+		ERROR("Only one label volume can be used");
+		return false;
+	}
+	m_label = label;
+	for (size_t i = 0; i < values.size(); ++i) {
+		Structure s;
+		s.name  = (i < names.size() ? names[i] : TString::Format("label%d", values[i]));
+		s.type  = LABEL;
+		s.axis  = 0;
+		s.label = values[i];
+		for (int k = 0; k < 6; ++k)
+			s.param[k] = 0.;
+		m_structure.push_back(s);
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method checks if the voxel center \a x is inside of a box or a
+ * cylinder structure.
+ */
+bool DoseVolumeHistogram::inside(const Structure& s, const double* x) const
+{
+	const double* p = s.param;
+	if (s.type == BOX)
+		return x[0] >= p[0] && x[0] <= p[1] && x[1] >= p[2] && x[1] <= p[3] && x[2] >= p[4] && x[2] <= p[5];
+	int b = (s.axis == 0 ? 1 : 0), c = (s.axis == 2 ? 1 : 2);
+	double du = x[b]-p[0], dv = x[c]-p[1];
+	return du*du + dv*dv <= p[2]*p[2] && x[s.axis] >= p[3] && x[s.axis] <= p[4];
+}
+
+/***************************************************************************/
+/**
+ * This method fills the DVHs of all structures in one parallel pass over
+ * the voxels. Each chunk of rows of the grid has private dose-volume
+ * arrays of all structures (histogram privatization), they are added in
+ * chunk order afterwards. Doses below zero are counted in the first dose
+ * bin and doses above the last bin edge in the last bin.
+ */
+std::vector<DVHSummary> DoseVolumeHistogram::compute(TH3* dose, std::vector<TH1D*>& differential, std::vector<TH1D*>& cumulative)
+{
+	std::vector<DVHSummary> summary;
+	differential.clear();
+	cumulative.clear();
+	int ns = (int)m_structure.size();
+	if (!dose || ns == 0) {
+		ERROR("No dose histogram or structure for DVH!");
+		return summary;
+	}
+	const float* arrayF = 0;
+	const double* arrayD = 0;
+	if (TArrayF* array = dynamic_cast<TArrayF*>(dose))
+		arrayF = array->GetArray();
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(dose))
+		arrayD = array->GetArray();
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", dose->GetName() ) );
+		return summary;
+	}
+	const TAxis* axis[3] = { dose->GetXaxis(), dose->GetYaxis(), dose->GetZaxis() };
+	int n[3] = { axis[0]->GetNbins(), axis[1]->GetNbins(), axis[2]->GetNbins() };
+	if (m_label && (m_label->GetNbinsX() != n[0] || m_label->GetNbinsY() != n[1] || m_label->GetNbinsZ() != n[2])) {
+		ERROR( TString::Format( "Binning of label volume '%s' is different from dose '%s'", m_label->GetName(), dose->GetName() ) );
+		return summary;
+	}
+
+	// voxel centers and widths, dose binning
+	std::vector<double> center[3], width[3];
+	for (int a = 0; a < 3; ++a)
+		for (int i = 1; i <= n[a]; ++i) {
+			center[a].push_back( axis[a]->GetBinCenter(i) );
+			width[a].push_back ( axis[a]->GetBinWidth(i) );
+		}
+	int nb = std::max(m_nbins, 1);
+	double maxDose = (m_maxDose > 0. ? m_maxDose : dose->GetMaximum());
+	if (maxDose <= 0.)
+		maxDose = 1.;
+	double scale = nb/maxDose;
+
+	// private dose-volume arrays, one set per chunk of rows
+	struct Partial {
+		std::vector<double> volume;                // volume per structure and dose bin
+		std::vector<double> total, sum, lo, hi;    // volume, dose x volume, minimum and maximum dose per structure
+		std::vector<int> nvoxels;                  // number of voxels per structure
+	};
+	int nrows = n[1]*n[2];
+	int chunk = std::max( (nrows + m_pool.size() - 1) / m_pool.size(), 1 );
+	int npart = (nrows + chunk - 1) / chunk;
+	std::vector<Partial> part(npart);
+	int nx = n[0]+2, nxy = (n[0]+2)*(n[1]+2);
+	m_pool.parallelFor(0, nrows, [&](int first, int last) {
+		Partial& p = part[first/chunk];
+		p.volume.assign(ns*nb, 0.);
+		p.total.assign(ns, 0.);
+		p.sum.assign(ns, 0.);
+		p.lo.assign(ns, 0.);
+		p.hi.assign(ns, 0.);
+		p.nvoxels.assign(ns, 0);
+		for (int row = first; row < last; ++row) {
+			int iy = row % n[1], iz = row / n[1];
+			double x[3] = { 0., center[1][iy], center[2][iz] };
+			double area = width[1][iy]*width[2][iz];
+			for (int ix = 0; ix < n[0]; ++ix) {
+				int bin = (ix+1) + nx*(iy+1) + nxy*(iz+1);
+				x[0] = center[0][ix];
+				double v = area*width[0][ix];
+				double d = (arrayF ? arrayF[bin] : arrayD[bin]);
+				int db = std::min( std::max( (int)std::floor(d*scale), 0 ), nb-1 );
+				int label = (m_label ? (int)std::floor(m_label->GetBinContent(bin) + 0.5) : 0);
+				for (int s = 0; s < ns; ++s) {
+					const Structure& st = m_structure[s];
+					if (st.type == LABEL ? label != st.label : !inside(st, x))
+						continue;
+					p.volume[s*nb+db] += v;
+					p.total[s] += v;
+					p.sum[s]   += d*v;
+					if (p.nvoxels[s] == 0 || d < p.lo[s]) p.lo[s] = d;
+					if (p.nvoxels[s] == 0 || d > p.hi[s]) p.hi[s] = d;
+					++p.nvoxels[s];
+				}
+			}
+		}
+	}, chunk);
+
+	// add private arrays and create histograms
+	for (int s = 0; s < ns; ++s) {
+		DVHSummary sum;
+		sum.name = m_structure[s].name;
+		sum.nvoxels = 0;
+		sum.volume = sum.minDose = sum.meanDose = sum.maxDose = 0.;
+		std::vector<double> volume(nb, 0.);
+		double dsum = 0.;
+		for (int k = 0; k < npart; ++k) {
+			const Partial& p = part[k];
+			if (p.nvoxels[s] == 0) continue;
+			for (int b = 0; b < nb; ++b)
+				volume[b] += p.volume[s*nb+b];
+			sum.minDose = (sum.nvoxels == 0 ? p.lo[s] : std::min(sum.minDose, p.lo[s]));
+			sum.maxDose = (sum.nvoxels == 0 ? p.hi[s] : std::max(sum.maxDose, p.hi[s]));
+			sum.nvoxels += p.nvoxels[s];
+			sum.volume  += p.total[s];
+			dsum        += p.sum[s];
+		}
+		if (sum.nvoxels == 0)
+			WARN("Structure '"+sum.name+"' has no voxel in dose grid '"+TString(dose->GetName())+"'");
+		sum.meanDose = (sum.volume > 0. ? dsum/sum.volume : 0.);
+
+		TH1D* ddvh = new TH1D(TString(dose->GetName())+"_ddvh_"+sum.name, sum.name, nb, 0., maxDose);
+		TH1D* cdvh = new TH1D(TString(dose->GetName())+"_dvh_"+sum.name, sum.name, nb, 0., maxDose);
+		double above = 0.;
+		for (int b = nb-1; b >= 0; --b) {
+			above += volume[b];
+			ddvh->SetBinContent(b+1, volume[b]);
+			cdvh->SetBinContent(b+1, sum.volume > 0. ? 100.*above/sum.volume : 0.);
+		}
+		ddvh->GetXaxis()->SetTitle("Dose");
+		ddvh->GetYaxis()->SetTitle("Volume");
+		cdvh->GetXaxis()->SetTitle("Dose");
+		cdvh->GetYaxis()->SetTitle("Volume (%)");
+		sum.d98 = getDose(cdvh, 98.);
+		sum.d95 = getDose(cdvh, 95.);
+		sum.d50 = getDose(cdvh, 50.);
+		sum.d2  = getDose(cdvh, 2.);
+		differential.push_back(ddvh);
+		cumulative.push_back(cdvh);
+		summary.push_back(sum);
+	}
+	return summary;
+}
+
+/***************************************************************************/
+/**
+ * This method finds the highest dose received by at least \a volume
+ * percent of the structure, interpolating linearly between the low edges
+ * of the bins of the cumulative DVH.
+ */
+double DoseVolumeHistogram::getDose(TH1* cumulative, double volume)
+{
+	int nb = cumulative->GetNbinsX();
+	for (int i = nb; i >= 1; --i) {
+		double c = cumulative->GetBinContent(i);
+		if (c < volume || c <= 0.)
+			continue;
+		double next = (i < nb ? cumulative->GetBinContent(i+1) : 0.);
+		double f = (c > next ? (c-volume)/(c-next) : 0.);
+		return cumulative->GetXaxis()->GetBinLowEdge(i) + f*cumulative->GetXaxis()->GetBinWidth(i);
+	}
+	return 0.;
+}
@@ -9,11 +9,15 @@
 
 #include "ErrHandler.h"
 
+/// Lock of standard output, keeps messages from different threads on separate lines
+static std::mutex print_mutex;
+
 /***************************************************************************/
 
 void ErrHandler::error(TString message)
 {
 	if(debug_level >= 0) {
+		std::lock_guard<std::mutex> lock(print_mutex);
 		if(WINSYS)	std::cout << ">>> ERROR ";
 		else		std::cout << "\033[31mERROR \033[0m";
 		std::cout << std::resetiosflags(std::ios::adjustfield);
@@ -27,6 +31,7 @@ void ErrHandler::error(TString message)
 void ErrHandler::warn(TString message)
 {
 	if(debug_level >= 1) {
+		std::lock_guard<std::mutex> lock(print_mutex);
 		if(WINSYS)	std::cout << ">>> WARN  ";
 		else		std::cout << "\033[1;33mWARN  \033[0m";
 		std::cout << std::resetiosflags(std::ios::adjustfield);
@@ -47,6 +52,7 @@ void ErrHandler::info(TString message)
 
 void ErrHandler::message(TString message)
 {
+	std::lock_guard<std::mutex> lock(print_mutex);
 	if(WINSYS)	std::cout << "    INFO  ";
 	else		std::cout << "\033[32mINFO  \033[0m";
 	std::cout << std::resetiosflags(std::ios::adjustfield);
@@ -59,6 +65,7 @@ void ErrHandler::message(TString message)
 void ErrHandler::debug(TString message, int line)
 {
 	if(debug_level >= 3) {
+		std::lock_guard<std::mutex> lock(print_mutex);
 		if(WINSYS)	std::cout << "... DEBUG  ";
 		else		std::cout << "\033[1;37mDEBUG \033[0m";
 		std::cout << std::resetiosflags(std::ios::adjustfield);
@@ -0,0 +1,190 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     GammaIndex.cxx
+ *
+ */
+
+#include "GammaIndex.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This method gets the bin array of a TH3F or TH3D histogram.
+ */
+bool GammaIndex::getArray(TH1* hist, const float*& arrayF, const double*& arrayD)
+{
+	arrayF = 0;
+	arrayD = 0;
+	if (TArrayF* array = dynamic_cast<TArrayF*>(hist))
+		arrayF = array->GetArray();
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(hist))
+		arrayD = array->GetArray();
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", hist->GetName() ) );
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method makes the bin offsets inside of the search sphere (radius
+ * \ref m_radius times \ref m_distance), sorted by increasing distance. The
+ * first offset is the voxel itself.
+ */
+std::vector<GammaIndex::Offset> GammaIndex::makeOffsets(const double* width)
+{
+	double rmax = m_radius*m_distance;
+	int nmax[3];
+	for (int a = 0; a < 3; ++a)
+		nmax[a] = (int)std::floor(rmax/width[a]);
+	std::vector<Offset> offset;
+	double inv2 = 1./(m_distance*m_distance);
+	for (int k = -nmax[2]; k <= nmax[2]; ++k)
+		for (int j = -nmax[1]; j <= nmax[1]; ++j)
+			for (int i = -nmax[0]; i <= nmax[0]; ++i) {
+				double dx = i*width[0], dy = j*width[1], dz = k*width[2];
+				Offset o;
+				o.dx = i; o.dy = j; o.dz = k;
+				o.dist2 = (dx*dx + dy*dy + dz*dz)*inv2;
+				if (o.dist2 <= m_radius*m_radius)
+					offset.push_back(o);
+			}
+	std::sort(offset.begin(), offset.end(), [](const Offset& a, const Offset& b) { return a.dist2 < b.dist2; });
+	DEBUG( TString::Format( "Gamma search sphere has %d voxels", (int)offset.size() ) );
+	return offset;
+}
+
+/***************************************************************************/
+/**
+ * This method computes the gamma index of all reference voxels above the
+ * threshold. For each voxel the offsets of the search sphere are scanned
+ * in order of distance until the distance term alone is not smaller than
+ * the best squared gamma, so voxels which agree well stop after a few
+ * neighbours. The pass counts are kept per chunk of rows and added in
+ * chunk order.
+ */
+TH3F* GammaIndex::compute(TH3* reference, TH3* evaluated, TString name, GammaSummary& summary)
+{
+	summary.nvoxels = summary.npassed = 0;
+	summary.passRate = summary.meanGamma = summary.maxGamma = 0.;
+	if (!reference || !evaluated) {
+		ERROR("No dose histograms for gamma index!");
+		return 0;
+	}
+	if (m_doseDiff <= 0. || m_distance <= 0. || m_radius <= 0.) {
+		ERROR("Gamma criteria and search radius must be positive!");
+		return 0;
+	}
+	const float *refF, *evalF;
+	const double *refD, *evalD;
+	if (!getArray(reference, refF, refD) || !getArray(evaluated, evalF, evalD))
+		return 0;
+
+	const TAxis* axis[3]  = { reference->GetXaxis(), reference->GetYaxis(), reference->GetZaxis() };
+	const TAxis* eaxis[3] = { evaluated->GetXaxis(), evaluated->GetYaxis(), evaluated->GetZaxis() };
+	int n[3];
+	double width[3];
+	for (int a = 0; a < 3; ++a) {
+		n[a] = axis[a]->GetNbins();
+		width[a] = (axis[a]->GetXmax() - axis[a]->GetXmin()) / n[a];
+		if (eaxis[a]->GetNbins() != n[a] || std::fabs(eaxis[a]->GetXmin() - axis[a]->GetXmin()) > 1.e-6*width[a]
+		    || std::fabs(eaxis[a]->GetXmax() - axis[a]->GetXmax()) > 1.e-6*width[a]) {
+			ERROR( TString::Format( "Binning of histogram '%s' is different from '%s'", evaluated->GetName(), reference->GetName() ) );
+			return 0;
+		}
+		for (int i = 1; i <= n[a]; ++i)
+			if (std::fabs(axis[a]->GetBinWidth(i) - width[a]) > 1.e-6*width[a]) {
+				ERROR( TString::Format( "Gamma index needs fixed bin widths, histogram '%s' has variable bins", reference->GetName() ) );
+				return 0;
+			}
+	}
+
+	// maximum reference dose and search sphere
+	int nx = n[0]+2, nxy = (n[0]+2)*(n[1]+2);
+	double maxDose = 0.;
+	for (int iz = 1; iz <= n[2]; ++iz)
+		for (int iy = 1; iy <= n[1]; ++iy)
+			for (int ix = 1; ix <= n[0]; ++ix) {
+				int bin = ix + nx*iy + nxy*iz;
+				maxDose = std::max(maxDose, (refF ? (double)refF[bin] : refD[bin]));
+			}
+	if (maxDose <= 0.) {
+		ERROR( TString::Format( "Reference dose '%s' has no positive value", reference->GetName() ) );
+		return 0;
+	}
+	std::vector<Offset> offset = makeOffsets(width);
+	double cut = m_threshold/100.*maxDose;
+
+	TString title = TString::Format( "Gamma %g%%/%g (%s)", m_doseDiff, m_distance, (m_local ? "local" : "global") );
+	TH3F* gamma = new TH3F(name, title, n[0], axis[0]->GetXmin(), axis[0]->GetXmax(), n[1], axis[1]->GetXmin(), axis[1]->GetXmax(),
+	                       n[2], axis[2]->GetXmin(), axis[2]->GetXmax());
+	float* g = gamma->GetArray();
+
+	// evaluate rows of voxels, pass counts per chunk
+	struct Partial {
+		int nvoxels, npassed;     // evaluated and passed voxels
+		double sum, max;          // sum and maximum of gamma
+	};
+	int nrows = n[1]*n[2];
+	int chunk = std::max( (nrows + 4*m_pool.size() - 1) / (4*m_pool.size()), 1 );
+	int npart = (nrows + chunk - 1) / chunk;
+	std::vector<Partial> part(npart);
+	m_pool.parallelFor(0, nrows, [&](int first, int last) {
+		Partial& p = part[first/chunk];
+		p.nvoxels = p.npassed = 0;
+		p.sum = p.max = 0.;
+		for (int row = first; row < last; ++row) {
+			int iy = row % n[1], iz = row / n[1];
+			for (int ix = 0; ix < n[0]; ++ix) {
+				int bin = (ix+1) + nx*(iy+1) + nxy*(iz+1);
+				double dr = (refF ? (double)refF[bin] : refD[bin]);
+				double norm = m_doseDiff/100.*(m_local ? dr : maxDose);
+				if (dr < cut || norm <= 0.) {
+					g[bin] = -1.f;
+					continue;
+				}
+				double inv2 = 1./(norm*norm);
+				double best = std::numeric_limits<double>::max();
+				for (size_t k = 0; k < offset.size(); ++k) {
+					const Offset& o = offset[k];
+					if (o.dist2 >= best)
+						break;
+					int x = ix + o.dx, y = iy + o.dy, z = iz + o.dz;
+					if (x < 0 || x >= n[0] || y < 0 || y >= n[1] || z < 0 || z >= n[2])
+						continue;
+					int nbin = (x+1) + nx*(y+1) + nxy*(z+1);
+					double diff = (evalF ? (double)evalF[nbin] : evalD[nbin]) - dr;
+					best = std::min(best, o.dist2 + diff*diff*inv2);
+				}
+				double value = std::sqrt(best);
+				g[bin] = (float)value;
+				++p.nvoxels;
+				if (value <= 1.)
+					++p.npassed;
+				p.sum += value;
+				p.max = std::max(p.max, value);
+			}
+		}
+	}, chunk);
+
+	double sum = 0.;
+	for (int k = 0; k < npart; ++k) {
+		summary.nvoxels += part[k].nvoxels;
+		summary.npassed += part[k].npassed;
+		summary.maxGamma = std::max(summary.maxGamma, part[k].max);
+		sum += part[k].sum;
+	}
+	if (summary.nvoxels > 0) {
+		summary.passRate  = 100.*summary.npassed/summary.nvoxels;
+		summary.meanGamma = sum/summary.nvoxels;
+	} else
+		WARN( TString::Format( "No voxel of '%s' is above the dose threshold", reference->GetName() ) );
+	gamma->SetEntries( (double)summary.nvoxels );
+	return gamma;
+}
@@ -6,22 +6,38 @@
  ***************************************************************************/
 
 #include "HistoUtilities.h"
+#include "MeshKernels.h"
+#include "ThreadPool.h"
+#include <future>
+#include <TROOT.h>
+#include <algorithm>
+#include <set>
+#include <cmath>
+#include <TClass.h>
+#include <TRegexp.h>
+
+/***************************************************************************/
+/**
+ * The destructor deletes the cached histograms.
+ */
+HistoUtilities::~HistoUtilities()
+{
+	clearCache();
+}
 
 /***************************************************************************/
 /**
  * This method gets all histograms from a file and put them to
- * a vector \a histolist
+ * a vector \a histolist; only keys of histogram classes are read
 */
 void HistoUtilities::getHistosFromFile(std::vector<TH1*> &histolist, TFile* file)
 {
-	TObject* obj;
 	TIter next(file->GetListOfKeys());
 	TKey* key;
 	while ((key=(TKey*)next())) {
-		obj = key->ReadObj();
-		if (obj->InheritsFrom("TH1"))
-			histolist.push_back( (TH1*)obj );
-		else
+		if (isHisto(key))
+			histolist.push_back( readHisto(file, key) );
+		else if (!isClass(key, "TDirectory"))
 			WARN("No histogram found!");
 	}
 }
@@ -29,53 +45,304 @@ void HistoUtilities::getHistosFromFile(std::vector<TH1*> &histolist, TFile* file
 /***************************************************************************/
 /**
  * This method gets specific histograms (with a list \a histoname) from 
- * a file and put them to a vector \a histolist
+ * a file and put them to a vector \a histolist, in the order of 
+ * \a histoname. A plain name is looked up directly in the key directory 
+ * of the file; a name with wildcards ('*', '?', '[') is a glob pattern and
+ * a name starting with "regex:" is a regular expression, both are matched
+ * against the key names. Only matching keys are read, each histogram is
+ * added once.
 */
 void HistoUtilities::getHistosFromFile(std::vector<TH1*> &histolist, std::vector<TString> histoname, TFile* file)
 {
-	TObject* obj;
-	TIter next(file->GetListOfKeys());
-	TKey* key;
-	while ((key=(TKey*)next())) {
-		obj = key->ReadObj();
-		if (obj->InheritsFrom("TH1")) {
-			for(std::vector<TString>::iterator histoname_it = histoname.begin(); histoname_it != histoname.end(); ++histoname_it) {
-				TString name; name.Form("%s",obj->GetName());
-				DEBUG("Compare '"+name+"' and '"+(*histoname_it)+"'");
-				if( name == (*histoname_it) ) {
-					histolist.push_back( (TH1*)obj );
-					DEBUG("Added histogram '"+name+"'");
-					break;
+	std::set<TString> added;
+	for(std::vector<TString>::iterator histoname_it = histoname.begin(); histoname_it != histoname.end(); ++histoname_it) {
+		TString pattern = (*histoname_it);
+		bool isRegex = pattern.BeginsWith("regex:");
+		bool isGlob  = !isRegex && (pattern.First('*') >= 0 || pattern.First('?') >= 0 || pattern.First('[') >= 0);
+		if (!isRegex && !isGlob) {
+			TKey* key = file->GetKey(pattern);
+			if (!key || !isHisto(key)) {
+				DEBUG("No histogram '"+pattern+"' in file");
+				continue;
+			}
+			if (added.insert(pattern).second) {
+				histolist.push_back( readHisto(file, key) );
+				DEBUG("Added histogram '"+pattern+"'");
+			}
+			continue;
+		}
+
+		TRegexp regexp( (isRegex ? pattern(6, pattern.Length()-6) : pattern), isGlob );
+		TIter next(file->GetListOfKeys());
+		TKey* key;
+		while ((key=(TKey*)next())) {
+			TString name = key->GetName();
+			int len = 0;
+			if (regexp.Index(name, &len) != 0 || len != name.Length() || !isHisto(key))
+				continue;
+			DEBUG("Key '"+name+"' matches '"+pattern+"'");
+			if (added.insert(name).second) {
+				histolist.push_back( readHisto(file, file->GetKey(name)) );
+				DEBUG("Added histogram '"+name+"'");
+			}
+		}
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method sets the maximum number of histograms kept in the cache;
+ * with a cache, histograms read again from the same key of the same file
+ * are copied from memory instead of being read from the file. Cached
+ * histograms are not attached to a file, each call returns a new copy.
+ */
+void HistoUtilities::setCacheSize(int size)
+{
+	m_cacheSize = size;
+	shrinkCache( std::max(size, 0) );
+}
+
+/***************************************************************************/
+/**
+ * This method removes the least recently used histograms from the cache
+ * until at most \a size are left.
+ */
+void HistoUtilities::shrinkCache(int size)
+{
+	while ((int)m_cacheOrder.size() > size) {
+		delete m_cache[m_cacheOrder.front()];
+		m_cache.erase(m_cacheOrder.front());
+		m_cacheOrder.pop_front();
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method deletes all cached histograms.
+ */
+void HistoUtilities::clearCache()
+{
+	for (std::map<TString, TH1*>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+		delete it->second;
+	m_cache.clear();
+	m_cacheOrder.clear();
+}
+
+/***************************************************************************/
+/**
+ * This method checks the class of object of \a key without reading it.
+ */
+bool HistoUtilities::isClass(TKey* key, TString name)
+{
+	TClass* cl = TClass::GetClass( key->GetClassName() );
+	return (cl && cl->InheritsFrom(name));
+}
+
+/***************************************************************************/
+/**
+ * This method reads the histogram of \a key, through the cache if there 
+ * is one: the least recently used histogram is removed from a full cache.
+ */
+TH1* HistoUtilities::readHisto(TFile* file, TKey* key)
+{
+	if (m_cacheSize <= 0)
+		return (TH1*)key->ReadObj();
+
+	TString id = TString::Format( "%s:%s;%d", file->GetName(), key->GetName(), key->GetCycle() );
+	std::map<TString, TH1*>::iterator it = m_cache.find(id);
+	if (it != m_cache.end()) {
+		DEBUG("Reuse cached histogram '"+id+"'");
+		m_cacheOrder.remove(id);
+	} else {
+		shrinkCache(m_cacheSize-1);
+		TH1* hist = (TH1*)key->ReadObj();
+		hist->SetDirectory(0);
+		it = m_cache.insert( std::make_pair(id, hist) ).first;
+	}
+	m_cacheOrder.push_back(id);
+	return (TH1*)it->second->Clone();
+}
+
+/***************************************************************************/
+/**
+ * This method merges all histotgrams in a file, the histograms are summed 
+ * in one pass by \ref MeshKernels
+ */
+void HistoUtilities::mergeHistos(TFile* file, int nthreads)
+{
+	std::vector<TH1*> histolist;
+	getHistosFromFile(histolist, file);
+	if (histolist.size() == 0)
+		return;
+	MeshKernels kernels(nthreads);
+	TH1* merged = kernels.sum(histolist, "mergedHisto");
+	if (merged)
+		writeHisto(merged,file);
+}
+
+/***************************************************************************/
+/**
+ * This method merges only the histograms \a histoname of a file, e.g. the
+ * file-total meshes of a file which also holds meshes of other tallies or
+ * energy bins. The histograms must have the same binning.
+ */
+void HistoUtilities::mergeHistos(TFile* file, std::vector<TString> histoname, int nthreads)
+{
+	std::vector<TH1*> histolist;
+	getHistosFromFile(histolist, histoname, file);
+	if (histolist.size() == 0) {
+		WARN("No histogram to merge!");
+		return;
+	}
+	MeshKernels kernels(nthreads);
+	TH1* merged = kernels.sum(histolist, "mergedHisto");
+	if (merged)
+		writeHisto(merged,file);
+	for (size_t i = 0; i < histolist.size(); ++i)
+		delete histolist[i];
+}
+
+/***************************************************************************/
+/**
+ * This method merges the histograms with the same name in files 
+ * \a filelist and writes the sums to file \a outname. The histograms are
+ * those of the first readable file; a file without one of them does not
+ * contribute to it.
+ *
+ * The files are read in batches of \a batch files by the threads of a 
+ * \ref ThreadPool. The histograms of each batch are then added in file
+ * order into a binary tree of partial sums (a partial sum of 2^k files is
+ * added to the previous one of 2^k files), so at most \a batch plus 
+ * log2(N) histograms of each name are in memory. The shape of the tree 
+ * only depends on the number of files and the sums are made by 
+ * \ref MeshKernels, so the result does not depend on the number of 
+ * threads or on \a batch.
+ */
+int HistoUtilities::mergeFiles(std::vector<TString> filelist, TString outname, int nthreads, int batch)
+{
+	// names of histograms
+	std::vector<TString> names;
+	for (size_t i = 0; i < filelist.size() && names.size() == 0; ++i) {
+		TFile* file = TFile::Open(filelist[i], "READ");
+		if (!file || file->IsZombie()) continue;
+		std::set<TString> found;
+		TIter next(file->GetListOfKeys());
+		TKey* key;
+		while ((key=(TKey*)next()))
+			if (isHisto(key) && found.insert(key->GetName()).second)
+				names.push_back(key->GetName());
+		file->Close();
+		delete file;
+	}
+	if (names.size() == 0) {
+		ERROR("No histogram found in input files!");
+		return 0;
+	}
+
+	ROOT::EnableThreadSafety();
+	bool addDirectory = TH1::AddDirectoryStatus();
+	TH1::AddDirectory(kFALSE);
+	ThreadPool pool(nthreads);
+	MeshKernels kernels(nthreads);
+	if (batch <= 0) batch = pool.size();
+	int nfiles = (int)filelist.size(), nhist = (int)names.size();
+
+	// partial sums (number of files, histogram) of each name
+	std::vector< std::vector< std::pair<int,TH1*> > > partial(nhist);
+	for (int first = 0; first < nfiles; first += batch) {
+		int last = std::min(first+batch, nfiles);
+		INFO( TString::Format( "Read files %d to %d of %d", first+1, last, nfiles ) );
+		std::vector< std::vector<TH1*> > leaves(last-first, std::vector<TH1*>(nhist, (TH1*)0));
+		std::vector< std::future<void> > jobs;
+		for (int i = first; i < last; ++i)
+			jobs.push_back( pool.submit( [this,&filelist,&names,&leaves,first,i]() {
+				TFile* file = TFile::Open(filelist[i], "READ");
+				if (!file || file->IsZombie()) {
+					ERROR("Cannot open file '"+filelist[i]+"'");
+					return;
+				}
+				for (size_t n = 0; n < names.size(); ++n) {
+					TKey* key = file->GetKey(names[n]);
+					if (!key || !isHisto(key)) continue;
+					leaves[i-first][n] = (TH1*)key->ReadObj();
+					leaves[i-first][n]->SetDirectory(0);
+				}
+				file->Close();
+				delete file;
+			} ) );
+		for (size_t j = 0; j < jobs.size(); ++j)
+			jobs[j].get();
+
+		for (int i = first; i < last; ++i) {
+			for (int n = 0; n < nhist; ++n) {
+				std::vector< std::pair<int,TH1*> >& stack = partial[n];
+				stack.push_back( std::make_pair(1, leaves[i-first][n]) );
+				while (stack.size() > 1 && stack[stack.size()-2].first == stack.back().first) {
+					std::pair<int,TH1*> right = stack.back();
+					stack.pop_back();
+					stack.back().first += right.first;
+					stack.back().second = addPair(stack.back().second, right.second, kernels);
 				}
 			}
 		}
 	}
+
+	TFile* outfile = TFile::Open(outname, "RECREATE");
+	if (!outfile || outfile->IsZombie()) {
+		ERROR("Cannot create file '"+outname+"'");
+		for (int n = 0; n < nhist; ++n)
+			for (size_t j = 0; j < partial[n].size(); ++j)
+				delete partial[n][j].second;
+		delete outfile;
+		TH1::AddDirectory(addDirectory);
+		return 0;
+	}
+	int nmerged = 0;
+	for (int n = 0; n < nhist; ++n) {
+		std::vector< std::pair<int,TH1*> >& stack = partial[n];
+		while (stack.size() > 1) {
+			TH1* right = stack.back().second;
+			stack.pop_back();
+			stack.back().second = addPair(stack.back().second, right, kernels);
+		}
+		TH1* merged = stack[0].second;
+		if (!merged) continue;
+		merged->SetName(names[n]);
+		writeHisto(merged, outfile);
+		delete merged;
+		++nmerged;
+	}
+	outfile->Close();
+	delete outfile;
+	TH1::AddDirectory(addDirectory);
+	return nmerged;
 }
 
 /***************************************************************************/
 /**
- * This method merges all histotgrams in a file
+ * This method returns the sum of \a a and \a b and deletes them; the sum
+ * of float or double histograms is made by \ref MeshKernels, other 
+ * histograms are added with \a TH1::Add().
  */
-void HistoUtilities::mergeHistos(TFile* file)
+TH1* HistoUtilities::addPair(TH1* a, TH1* b, MeshKernels& kernels)
 {
-	TH1* merged = 0;
-	TObject* obj;
-	TIter next(file->GetListOfKeys());
-	TKey* key;
-	int i = 0;
-	while ((key=(TKey*)next())) {
-		obj = key->ReadObj();
-		if (obj->InheritsFrom("TH1")) {
-			if (i == 0)
-				merged = (TH1*)obj->Clone();
-			else
-				merged->Add( (TH1*)obj );
-		} else
-			WARN("No histogram found!");
-		++i;
+	if (!a) return b;
+	if (!b) return a;
+	bool isFloat  = (dynamic_cast<TArrayF*>(a) && dynamic_cast<TArrayF*>(b));
+	bool isDouble = (dynamic_cast<TArrayD*>(a) && dynamic_cast<TArrayD*>(b));
+	if ((isFloat || isDouble) && a->GetNcells() == b->GetNcells()) {
+		std::vector<TH1*> pair;
+		pair.push_back(a);
+		pair.push_back(b);
+		TH1* sum = kernels.sum(pair, a->GetName());
+		sum->SetEntries( a->GetEntries() + b->GetEntries() );
+		delete a;
+		delete b;
+		return sum;
 	}
-	merged->SetName("mergedHisto");
-	writeHisto(merged,file);
+	a->Add(b);
+	delete b;
+	return a;
 }
 
 /***************************************************************************/
@@ -177,97 +444,157 @@ TH3F* HistoUtilities::convert(TString name, TString title, std::vector< std::vec
 	return hist;
 }
 
+/// Edge length of the cubic tiles of bins copied by \ref permuteKernel()
+static const int kTile = 16;
+
 /***************************************************************************/
 /**
- * This method rotates a TH3F histogram axis
+ * This is the axis permutation kernel: new axis \a d is old axis \a P<d>,
+ * i.e. new bin (i,j,k) is the old bin with index i on axis P0, j on axis
+ * P1 and k on axis P2. The new bins are copied in tiles of kTile^3 bins, 
+ * so the strided reads of a tile stay in cache, and the tiles along the 
+ * new z-axis are shared by the threads of \a pool. With the permutation 
+ * known at compile time the inner loop is a plain (vectorizable) copy when
+ * the x-axis is kept.
  */
-TH3F* HistoUtilities::changeAxis(TH3F* hist, TString option, TString name)
+template<int P0, int P1, int P2, class T> static void permuteKernel(const T* in, T* out, const int* n, ThreadPool& pool)
 {
-	//TString name  = hist->GetName();
-	TString title = hist->GetTitle();
-	int nbinx = hist->GetNbinsX();
-	int nbiny = hist->GetNbinsY();
-	int nbinz = hist->GetNbinsZ();
-	double xmin = hist->GetXaxis()->GetBinLowEdge(1);
-	double xmax = hist->GetXaxis()->GetBinLowEdge(hist->GetNbinsX()) + hist->GetXaxis()->GetBinWidth(1);
-	double ymin = hist->GetYaxis()->GetBinLowEdge(1);
-	double ymax = hist->GetYaxis()->GetBinLowEdge(hist->GetNbinsY()) + hist->GetYaxis()->GetBinWidth(1);
-	double zmin = hist->GetZaxis()->GetBinLowEdge(1);
-	double zmax = hist->GetZaxis()->GetBinLowEdge(hist->GetNbinsZ()) + hist->GetZaxis()->GetBinWidth(1);
-
-	TH3F* newhist = 0;
-	if (option == "XYZ") {
-		newhist = new TH3F(name, title, nbinx, xmin, xmax, nbiny, ymin, ymax, nbinz, zmin, zmax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(i+1, j+1, k+1, hist->GetBinContent(i+1, j+1, k+1) );
-	}
-	else if (option == "ZXY") {
-		newhist = new TH3F(name, title, nbinz, zmin, zmax, nbinx, xmin, xmax, nbiny, ymin, ymax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(k+1, i+1, j+1, hist->GetBinContent(i+1, j+1, k+1) );
-	}
-	else if (option == "XZY") {
-		newhist = new TH3F(name, title, nbinx, xmin, xmax, nbinz, zmin, zmax, nbiny, ymin, ymax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(i+1, k+1, j+1, hist->GetBinContent(i+1, j+1, k+1) );
-	}
-	else if (option == "YXZ") {
-		newhist = new TH3F(name, title, nbiny, ymin, ymax, nbinx, xmin, xmax, nbinz, zmin, zmax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(j+1, i+1, k+1, hist->GetBinContent(i+1, j+1, k+1) );
-	}
-	else if (option == "ZYX") {
-		newhist = new TH3F(name, title, nbinz, zmin, zmax, nbiny, ymin, ymax, nbinx, xmin, xmax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(k+1, j+1, i+1, hist->GetBinContent(i+1, j+1, k+1) );
+	const int s[3] = { 1, n[0]+2, (n[0]+2)*(n[1]+2) };   // old strides
+	const int m[3] = { n[P0], n[P1], n[P2] };             // new numbers of bins
+	const int t1 = m[0]+2, t2 = (m[0]+2)*(m[1]+2);        // new strides
+	const int s0 = (P0 == 0 ? 1 : s[P0]), s1 = s[P1], s2 = s[P2];
+	int ntiles = (m[2] + kTile - 1) / kTile;
+	pool.parallelFor(0, ntiles, [&](int first, int last) {
+		for (int tk = first*kTile+1; tk <= std::min(last*kTile, m[2]); tk += kTile)
+		for (int tj = 1; tj <= m[1]; tj += kTile)
+		for (int ti = 1; ti <= m[0]; ti += kTile) {
+			int kmax = std::min(tk+kTile, m[2]+1), jmax = std::min(tj+kTile, m[1]+1), imax = std::min(ti+kTile, m[0]+1);
+			for (int k = tk; k < kmax; ++k)
+			for (int j = tj; j < jmax; ++j) {
+				const T* src = in + j*s1 + k*s2;
+				T* dst = out + j*t1 + k*t2;
+				for (int i = ti; i < imax; ++i)
+					dst[i] = src[i*s0];
+			}
+		}
+	}, 1);
+}
+
+/***************************************************************************/
+/**
+ * This function calls the kernel of permutation \a perm (e.g. "ZXY").
+ */
+template<class T> static void permute(const T* in, T* out, const int* n, TString perm, ThreadPool& pool)
+{
+	if      (perm == "XYZ") permuteKernel<0,1,2>(in, out, n, pool);
+	else if (perm == "ZXY") permuteKernel<2,0,1>(in, out, n, pool);
+	else if (perm == "XZY") permuteKernel<0,2,1>(in, out, n, pool);
+	else if (perm == "YXZ") permuteKernel<1,0,2>(in, out, n, pool);
+	else if (perm == "ZYX") permuteKernel<2,1,0>(in, out, n, pool);
+	else if (perm == "YZX") permuteKernel<1,2,0>(in, out, n, pool);
+}
+
+/***************************************************************************/
+/**
+ * This method rotates a TH3F histogram axis: with option e.g. "ZXY" the
+ * x-, y- and z-axis of the new histogram are the z-, x- and y-axis of 
+ * \a hist. Bin contents and errors are copied by \ref permuteKernel().
+ */
+TH3F* HistoUtilities::changeAxis(TH3F* hist, TString option, TString name, int nthreads)
+{
+	if (option != "XYZ" && option != "ZXY" && option != "XZY" && option != "YXZ" && option != "ZYX" && option != "YZX") {
+		ERROR("Incorrect type of axis transformation. Should use 'XYZ' 'ZXY' 'XZY' 'YXZ' 'ZYX' 'YZX'");
+		return 0;
 	}
-	else if (option == "YZX") {
-		newhist = new TH3F(name, title, nbiny, ymin, ymax, nbinz, zmin, zmax, nbinx, xmin, xmax);
-		for (int i = 0; i < nbinx; ++i)
-			for (int j = 0; j < nbiny; ++j)
-				for (int k = 0; k < nbinz; ++k)
-					newhist->SetBinContent(j+1, k+1, i+1, hist->GetBinContent(i+1, j+1, k+1) );
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	int n[3] = { hist->GetNbinsX(), hist->GetNbinsY(), hist->GetNbinsZ() };
+	std::vector<double> edge[3];
+	for (int d = 0; d < 3; ++d) {
+		const TAxis* old = axis[option[d]-'X'];
+		for (int i = 1; i <= old->GetNbins(); ++i)
+			edge[d].push_back( old->GetBinLowEdge(i) );
+		edge[d].push_back( old->GetBinUpEdge(old->GetNbins()) );
 	}
-	else
-		ERROR("Incorrect type of axis transformation. Should use 'XYZ' 'ZXY' 'XZY' 'YXZ' 'ZYX' 'YZX'");
+	TH3F* newhist = new TH3F(name, hist->GetTitle(), (int)edge[0].size()-1, &edge[0][0], (int)edge[1].size()-1, &edge[1][0], (int)edge[2].size()-1, &edge[2][0]);
 
+	ThreadPool pool(nthreads);
+	permute<float>(hist->GetArray(), newhist->GetArray(), n, option, pool);
+	if (hist->GetSumw2N() > 0) {
+		newhist->Sumw2();
+		permute<double>(hist->GetSumw2()->GetArray(), newhist->GetSumw2()->GetArray(), n, option, pool);
+	}
+	newhist->SetEntries( hist->GetEntries() );
 	return newhist;
 }
 
 
 /***************************************************************************/
 /**
- * This method creates a 1-dimension (axis) projection from a 2-dimension histogam 
+ * This method creates a 1-dimension (axis) projection from a 2-dimension histogam,
+ * summing the bins of the other axis within the bin ranges (with new axis limits, 
+ * the projected axis is made uniform between them, as in \ref HistoView)
  */
 TH1* HistoUtilities::makeProjection(TH2F* hist, TString axis, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<double> valueX, std::vector<double> valueY, double weight)
 {
-	TH1* hist1D;
-	return hist1D;
+	axis.ToLower();
+	if(axis != "x" && axis != "y") {
+		ERROR("Undefined projection axis '"+axis+"'!");
+		return 0;
+	}
+	const TAxis* axes[2] = { hist->GetXaxis(), hist->GetYaxis() };
+	std::vector<int>* range[2] = { &rangeX, &rangeY };
+	int lo[2], hi[2];
+	for(int a = 0; a < 2; ++a) {
+		int n = axes[a]->GetNbins();
+		lo[a] = (range[a]->size() > 0 ? std::max((*range[a])[0], 1) : 1);
+		hi[a] = (range[a]->size() > 1 ? std::min((*range[a])[1], n) : n);
+	}
+	int h = (axis == "x" ? 0 : 1);
+	std::vector<double>& value = (h == 0 ? valueX : valueY);
+	int n = axes[h]->GetNbins();
+	std::vector<double> edge;
+	for(int i = lo[h]; i <= hi[h]+1; ++i) {
+		if(value.size() > 0) {
+			double low = value[0], up = (value.size() > 1 ? value[1] : axes[h]->GetBinUpEdge(n));
+			edge.push_back( low + (i-1)*(up-low)/n );
+		} else
+			edge.push_back( axes[h]->GetBinLowEdge(i) );
+	}
+
+	TH1D* proj_hist = new TH1D(TString(hist->GetName())+"_"+axis, hist->GetTitle(), hi[h]-lo[h]+1, &edge[0]);
+	proj_hist->GetXaxis()->SetTitle( axes[h]->GetTitle() );
+	std::vector<double> sum(hi[h]-lo[h]+1, 0.), sum2(hi[h]-lo[h]+1, 0.);
+	for(int i = lo[0]; i <= hi[0]; ++i)
+		for(int j = lo[1]; j <= hi[1]; ++j) {
+			int b = (h == 0 ? i-lo[0] : j-lo[1]);
+			double error = hist->GetBinError(i,j);
+			sum[b]  += hist->GetBinContent(i,j);
+			sum2[b] += error*error;
+		}
+	for(size_t b = 0; b < sum.size(); ++b) {
+		proj_hist->SetBinContent(b+1, sum[b]);
+		proj_hist->SetBinError  (b+1, std::sqrt(sum2[b]));
+	}
+	proj_hist->SetEntries( hist->GetEntries() );
+	if(weight < 0)
+	  proj_hist->Scale(1./proj_hist->Integral());
+	else if(weight != 1.)
+	  proj_hist->Scale(weight);
+	return proj_hist;
 }
 
 /***************************************************************************/
 /**
- * This method creates a 1- and 2-dimension projection from a 3-dimension histogam 
+ * This method creates a 1- and 2-dimension projection from a 3-dimension histogam,
+ * through a \ref HistoView of the bin ranges (no copy of the histogram)
  */
 TH1* HistoUtilities::makeProjection(TH3F* hist, TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, 
 																std::vector<double> valueX, std::vector<double> valueY, std::vector<double> valueZ, double weight)
 {
-  TH3F* newhist = (TH3F*)makeRange(hist,rangeX,rangeY,rangeZ,valueX,valueY,valueZ);
-  TH1* proj_hist;		
-	if (option.Contains("x") || option.Contains("X") || option.Contains("y") || option.Contains("Y") || option.Contains("z") || option.Contains("Z")) 
-	  proj_hist = newhist->Project3D(option);
-	else
-	  	ERROR("Undefined projection axis or plane!");
+	HistoView view(hist,rangeX,rangeY,rangeZ,valueX,valueY,valueZ);
+	TH1* proj_hist = view.project(option, TString(hist->GetName())+"_"+option);
+	if (!proj_hist)
+		return 0;
 	if(weight < 0)
 	  proj_hist->Scale(1./proj_hist->Integral());
 	else if(weight != 1.)
@@ -276,32 +603,19 @@ TH1* HistoUtilities::makeProjection(TH3F* hist, TString option, std::vector<int>
 	return proj_hist;
 }
 
-
 /***************************************************************************/
-
-TH1* HistoUtilities::makeRange(TH1* hist, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, std::vector<double> valueX, std::vector<double> valueY, std::vector<double> valueZ)
+/**
+ * This method creates a 1- and 2-dimension projection from the summed-area
+ * table of a 3-dimension histogram, without copying the histogram
+ */
+TH1* HistoUtilities::makeProjection(SummedAreaTable& table, TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight)
 {
-	TH1* newhist = (TH1*)hist->Clone();
-		
-	if(rangeX.size() < 1) rangeX.push_back(1);
-	if(rangeX.size() < 2) rangeX.push_back(newhist->GetNbinsX());
-	if(rangeY.size() < 1) rangeY.push_back(1);
-	if(rangeY.size() < 2) rangeY.push_back(newhist->GetNbinsY());
-	if(rangeZ.size() < 1) rangeZ.push_back(1);
-	if(rangeZ.size() < 2) rangeZ.push_back(newhist->GetNbinsZ());
-
-	if(valueX.size() < 1) valueX.push_back( newhist->GetXaxis()->GetBinLowEdge(1) );
-	if(valueX.size() < 2) valueX.push_back( newhist->GetXaxis()->GetBinLowEdge(newhist->GetNbinsX()) + newhist->GetXaxis()->GetBinWidth(1) );
-	if(valueY.size() < 1) valueY.push_back( newhist->GetYaxis()->GetBinLowEdge(1) );
-	if(valueY.size() < 2) valueY.push_back( newhist->GetYaxis()->GetBinLowEdge(newhist->GetNbinsY()) + newhist->GetYaxis()->GetBinWidth(1) );
-	if(valueZ.size() < 1) valueZ.push_back( newhist->GetZaxis()->GetBinLowEdge(1) );
-	if(valueZ.size() < 2) valueZ.push_back( newhist->GetZaxis()->GetBinLowEdge(newhist->GetNbinsZ()) + newhist->GetZaxis()->GetBinWidth(1) );
-		
-	newhist->SetBins(newhist->GetNbinsX(),valueX[0],valueX[1],newhist->GetNbinsY(),valueY[0],valueY[1],newhist->GetNbinsZ(),valueZ[0],valueZ[1]);
-	
-	newhist->GetXaxis()->SetRange(rangeX[0],rangeX[1]);
-	newhist->GetYaxis()->SetRange(rangeY[0],rangeY[1]);
-	newhist->GetZaxis()->SetRange(rangeZ[0],rangeZ[1]);
-	
-	return newhist;
+	TH1* proj_hist = table.project(option, rangeX, rangeY, rangeZ, table.getName()+"_"+option);
+	if (!proj_hist)
+		return 0;
+	if (weight < 0)
+		proj_hist->Scale(1./proj_hist->Integral());
+	else if (weight != 1.)
+		proj_hist->Scale(weight);
+	return proj_hist;
 }
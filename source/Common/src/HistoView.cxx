@@ -0,0 +1,170 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     HistoView.cxx
+ *
+ */
+
+#include "HistoView.h"
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This function adds the bins [lo,hi] of the bin array \a value (and of
+ * the squared errors \a error, or the bin values if there is none) to the
+ * bins of a projection on axes \a h (horizontal) and \a v (vertical). The
+ * source bins are read in memory order.
+ */
+template<class T> static void sumBins(const T* value, const double* error, const int* n, const int* lo, const int* hi, int h, int v,
+		double* sum, double* sum2)
+{
+	int sy = n[0]+2, sz = (n[0]+2)*(n[1]+2);
+	int nh = (h >= 0 ? hi[h]-lo[h]+1 : 0);
+	int idx[3];
+	for (idx[2] = lo[2]; idx[2] <= hi[2]; ++idx[2])
+	for (idx[1] = lo[1]; idx[1] <= hi[1]; ++idx[1]) {
+		int row = idx[1]*sy + idx[2]*sz;
+		for (idx[0] = lo[0]; idx[0] <= hi[0]; ++idx[0]) {
+			int bin = row + idx[0];
+			int out = (h >= 0 ? idx[h]-lo[h] : 0) + (v >= 0 ? (idx[v]-lo[v])*nh : 0);
+			sum[out]  += value[bin];
+			sum2[out] += (error ? error[bin] : std::fabs((double)value[bin]));
+		}
+	}
+}
+
+/***************************************************************************/
+/**
+ * The constructor clips the bin ranges to the histogram and computes the
+ * bin edges; with new axis limits the bins are made uniform between them.
+ */
+HistoView::HistoView(TH3* hist, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ,
+		std::vector<double> valueX, std::vector<double> valueY, std::vector<double> valueZ) : m_hist(hist), message("HistoView")
+{
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	std::vector<int>* range[3] = { &rangeX, &rangeY, &rangeZ };
+	std::vector<double>* value[3] = { &valueX, &valueY, &valueZ };
+	for (int a = 0; a < 3; ++a) {
+		m_n[a]  = axis[a]->GetNbins();
+		m_lo[a] = (range[a]->size() > 0 ? std::max((*range[a])[0], 1) : 1);
+		m_hi[a] = (range[a]->size() > 1 ? std::min((*range[a])[1], m_n[a]) : m_n[a]);
+		double low = axis[a]->GetBinLowEdge(1), up = axis[a]->GetBinUpEdge(m_n[a]);
+		if (value[a]->size() > 0) {
+			low = (*value[a])[0];
+			if (value[a]->size() > 1) up = (*value[a])[1];
+			for (int i = 0; i <= m_n[a]; ++i)
+				m_edge[a].push_back( low + i*(up-low)/m_n[a] );
+		} else {
+			for (int i = 1; i <= m_n[a]; ++i)
+				m_edge[a].push_back( axis[a]->GetBinLowEdge(i) );
+			m_edge[a].push_back(up);
+		}
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method calls the sum kernel for the bin type of the histogram.
+ */
+bool HistoView::accumulate(int h, int v, double* sum, double* sum2)
+{
+	const double* error = (m_hist->GetSumw2N() > 0 ? m_hist->GetSumw2()->GetArray() : 0);
+	if (TArrayF* array = dynamic_cast<TArrayF*>(m_hist))
+		sumBins(array->GetArray(), error, m_n, m_lo, m_hi, h, v, sum, sum2);
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(m_hist))
+		sumBins(array->GetArray(), error, m_n, m_lo, m_hi, h, v, sum, sum2);
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", m_hist->GetName() ) );
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the sum of bins in the view.
+ */
+double HistoView::integral(double* error2)
+{
+	double sum = 0., sum2 = 0.;
+	accumulate(-1, -1, &sum, &sum2);
+	if (error2)
+		*error2 = sum2;
+	return sum;
+}
+
+/***************************************************************************/
+/**
+ * This method creates the projection of the bins in the view, with the
+ * axis convention of \a TH3::Project3D() (e.g. "yx" has x on the
+ * horizontal and y on the vertical axis). Other characters of \a option
+ * (e.g. "e") are ignored.
+ */
+TH1* HistoView::project(TString option, TString name)
+{
+	option.ToLower();
+	TString letters = "";
+	for (int i = 0; i < option.Length(); ++i)
+		if (option[i] >= 'x' && option[i] <= 'z')
+			letters += option[i];
+	int h = -1, v = -1;
+	if (letters.Length() == 1)
+		h = letters[0]-'x';
+	else if (letters.Length() == 2 && letters[0] != letters[1]) {
+		h = letters[1]-'x';
+		v = letters[0]-'x';
+	}
+	if (h < 0) {
+		ERROR("Undefined projection axis or plane '"+option+"'!");
+		return 0;
+	}
+
+	// sum in a dense histogram, converted to ROOT at the end
+	TH1* proj = 0;
+	if (v < 0) {
+		DenseHisto<1,double>::Axes axes = {{ DenseAxis(getEdges(h)) }};
+		DenseHisto<1,double> sum(axes, true);
+		if (!accumulate(h, v, sum.getArray(), sum.getErrors()))
+			return 0;
+		proj = sum.toROOT(name, m_hist->GetTitle());
+	} else {
+		DenseHisto<2,double>::Axes axes = {{ DenseAxis(getEdges(h)), DenseAxis(getEdges(v)) }};
+		DenseHisto<2,double> sum(axes, true);
+		if (!accumulate(h, v, sum.getArray(), sum.getErrors()))
+			return 0;
+		proj = sum.toROOT(name, m_hist->GetTitle());
+	}
+	const TAxis* axis[3] = { m_hist->GetXaxis(), m_hist->GetYaxis(), m_hist->GetZaxis() };
+	proj->GetXaxis()->SetTitle( axis[h]->GetTitle() );
+	if (v >= 0)
+		proj->GetYaxis()->SetTitle( axis[v]->GetTitle() );
+	proj->SetEntries( m_hist->GetEntries() );
+	return proj;
+}
+
+/***************************************************************************/
+/**
+ * This method copies the bins in the view, with their errors, to a new
+ * histogram which has only the bins of the view.
+ */
+TH3F* HistoView::toHisto(TString name)
+{
+	std::vector<double> edge[3] = { getEdges(0), getEdges(1), getEdges(2) };
+	TH3F* out = new TH3F(name, m_hist->GetTitle(), getNbins(0), &edge[0][0], getNbins(1), &edge[1][0], getNbins(2), &edge[2][0]);
+	out->Sumw2();
+	bool hasErrors = (m_hist->GetSumw2N() > 0);
+	for (int k = m_lo[2]; k <= m_hi[2]; ++k)
+	for (int j = m_lo[1]; j <= m_hi[1]; ++j)
+	for (int i = m_lo[0]; i <= m_hi[0]; ++i) {
+		int bin = m_hist->GetBin(i, j, k);
+		int outBin = out->GetBin(i-m_lo[0]+1, j-m_lo[1]+1, k-m_lo[2]+1);
+		double value = m_hist->GetBinContent(bin);
+		out->SetBinContent(outBin, value);
+		out->GetSumw2()->GetArray()[outBin] = (hasErrors ? m_hist->GetSumw2()->GetArray()[bin] : std::fabs(value));
+	}
+	out->SetEntries( m_hist->GetEntries() );
+	return out;
+}
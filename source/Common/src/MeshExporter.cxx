@@ -0,0 +1,171 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshExporter.cxx
+ *
+ */
+
+#include "MeshExporter.h"
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <future>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+
+/// Size of write buffer (bytes)
+static const size_t kBufferSize = 1 << 22;
+
+/***************************************************************************/
+/**
+ * This function checks if the bins of an axis have the same width.
+ */
+static bool isUniform(const TAxis* axis)
+{
+	int n = axis->GetNbins();
+	double width = (axis->GetBinUpEdge(n) - axis->GetBinLowEdge(1)) / n;
+	for (int i = 1; i <= n; ++i)
+		if (std::fabs(axis->GetBinWidth(i) - width) > 1.e-6*std::fabs(width))
+			return false;
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the byte count of the block followed by the bins (or
+ * errors) in VTK order (x fastest, no under- and overflow bins), through a
+ * buffer which is written when full.
+ */
+template<class T> void MeshExporter::writeBlock(std::ofstream& out, const T* array, const double* error2, const int* n, bool isError)
+{
+	uint64_t nbytes = (uint64_t)n[0]*n[1]*n[2]*sizeof(T);
+	out.write((const char*)&nbytes, sizeof(nbytes));
+	std::vector<T> buffer;
+	buffer.reserve( std::max(kBufferSize/sizeof(T), (size_t)n[0]) );
+	int sy = n[0]+2, sz = (n[0]+2)*(n[1]+2);
+	for (int k = 1; k <= n[2]; ++k)
+		for (int j = 1; j <= n[1]; ++j) {
+			int row = 1 + j*sy + k*sz;
+			if (buffer.size() + n[0] > buffer.capacity()) {
+				out.write((const char*)&buffer[0], buffer.size()*sizeof(T));
+				buffer.clear();
+			}
+			for (int i = 0; i < n[0]; ++i) {
+				if (!isError)
+					buffer.push_back( array[row+i] );
+				else if (error2)
+					buffer.push_back( (T)std::sqrt(error2[row+i]) );
+				else
+					buffer.push_back( (T)std::sqrt(std::fabs((double)array[row+i])) );
+			}
+		}
+	if (buffer.size() > 0)
+		out.write((const char*)&buffer[0], buffer.size()*sizeof(T));
+}
+
+/***************************************************************************/
+/**
+ * This method writes the XML header with the mesh geometry and the
+ * descriptions of the two arrays, followed by the appended raw data.
+ */
+bool MeshExporter::write(TH3* hist, TString filename)
+{
+	const float* arrayF = 0;
+	const double* arrayD = 0;
+	if (TArrayF* array = dynamic_cast<TArrayF*>(hist))
+		arrayF = array->GetArray();
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(hist))
+		arrayD = array->GetArray();
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", hist->GetName() ) );
+		return false;
+	}
+	const double* error2 = (hist->GetSumw2N() > 0 ? hist->GetSumw2()->GetArray() : 0);
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	int n[3];
+	bool uniform = true;
+	for (int a = 0; a < 3; ++a) {
+		n[a] = axis[a]->GetNbins();
+		uniform = uniform && isUniform(axis[a]);
+	}
+
+	TString type = (uniform ? "ImageData" : "RectilinearGrid");
+	filename += (uniform ? ".vti" : ".vtr");
+	std::ofstream out(filename.Data(), std::ios::out | std::ios::binary);
+	if (!out.is_open()) {
+		ERROR("Unable to open file '"+filename+"'!");
+		return false;
+	}
+	uint16_t one = 1;
+	bool little = (*(const char*)&one == 1);
+	size_t size = (arrayF ? sizeof(float) : sizeof(double));
+	uint64_t block = sizeof(uint64_t) + (uint64_t)n[0]*n[1]*n[2]*size;
+	TString extent = TString::Format("0 %d 0 %d 0 %d", n[0], n[1], n[2]);
+	TString dataType = (arrayF ? "Float32" : "Float64");
+
+	out << "<?xml version=\"1.0\"?>\n";
+	out << "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\"" << (little ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">\n";
+	if (uniform)
+		out << TString::Format("  <ImageData WholeExtent=\"%s\" Origin=\"%.10g %.10g %.10g\" Spacing=\"%.10g %.10g %.10g\">\n", extent.Data(),
+				axis[0]->GetBinLowEdge(1), axis[1]->GetBinLowEdge(1), axis[2]->GetBinLowEdge(1),
+				axis[0]->GetBinWidth(1), axis[1]->GetBinWidth(1), axis[2]->GetBinWidth(1));
+	else
+		out << "  <RectilinearGrid WholeExtent=\"" << extent << "\">\n";
+	out << "    <Piece Extent=\"" << extent << "\">\n";
+	out << "      <CellData Scalars=\"value\">\n";
+	out << "        <DataArray type=\"" << dataType << "\" Name=\"value\" format=\"appended\" offset=\"0\"/>\n";
+	out << "        <DataArray type=\"" << dataType << "\" Name=\"error\" format=\"appended\" offset=\"" << block << "\"/>\n";
+	out << "      </CellData>\n";
+	if (!uniform) {
+		const char* label[3] = { "x", "y", "z" };
+		out << "      <Coordinates>\n";
+		for (int a = 0; a < 3; ++a) {
+			out << "        <DataArray type=\"Float64\" Name=\"" << label[a] << "\" format=\"ascii\">\n         ";
+			for (int i = 1; i <= n[a]+1; ++i)
+				out << TString::Format(" %.10g", i <= n[a] ? axis[a]->GetBinLowEdge(i) : axis[a]->GetBinUpEdge(n[a]));
+			out << "\n        </DataArray>\n";
+		}
+		out << "      </Coordinates>\n";
+	}
+	out << "    </Piece>\n";
+	out << "  </" << type << ">\n";
+	out << "  <AppendedData encoding=\"raw\">\n   _";
+	for (int e = 0; e < 2; ++e) {
+		if (arrayF)
+			writeBlock(out, arrayF, error2, n, e == 1);
+		else
+			writeBlock(out, arrayD, error2, n, e == 1);
+	}
+	out << "\n  </AppendedData>\n";
+	out << "</VTKFile>\n";
+	out.close();
+	if (out.fail()) {
+		ERROR("Failed writing file '"+filename+"'!");
+		return false;
+	}
+	MESSAGE("Write mesh '"+TString(hist->GetName())+"' to '"+filename+"'");
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method writes each mesh in its own job of the thread pool.
+ */
+int MeshExporter::write(std::vector<TH3*> hist, TString prefix)
+{
+	std::vector< std::future<void> > jobs;
+	std::vector<int> ok(hist.size(), 0);
+	for (size_t i = 0; i < hist.size(); ++i) {
+		if (!hist[i]) continue;
+		TString filename = prefix + hist[i]->GetName();
+		jobs.push_back( m_pool.submit( [this,&hist,&ok,i,filename]() { ok[i] = write(hist[i], filename); } ) );
+	}
+	for (size_t i = 0; i < jobs.size(); ++i)
+		jobs[i].get();
+	int nwritten = 0;
+	for (size_t i = 0; i < ok.size(); ++i)
+		nwritten += ok[i];
+	return nwritten;
+}
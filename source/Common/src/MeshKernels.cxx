@@ -0,0 +1,419 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshKernels.cxx
+ *
+ */
+
+#include "MeshKernels.h"
+#include <cmath>
+#include <algorithm>
+
+/// Number of bins processed together by the kernels (fits in L1/L2 cache)
+static const int kBlock = 1024;
+
+/// Bin array type of histograms with float or double bins
+template<class T> struct MeshArray;
+template<> struct MeshArray<float>  { typedef TArrayF Type; };
+template<> struct MeshArray<double> { typedef TArrayD Type; };
+
+/***************************************************************************/
+/**
+ * This function returns the bin array of histogram \a hist.
+ */
+template<class T> static T* getValues(TH1* hist)
+{
+	return dynamic_cast<typename MeshArray<T>::Type*>(hist)->GetArray();
+}
+
+/***************************************************************************/
+/**
+ * This function copies the squared errors of bins [\a first, \a first+n)
+ * of \a hist to \a err; without error array the bin values are used.
+ */
+template<class T> static void getErrors(TH1* hist, const T* value, int first, int n, double* err)
+{
+	if (hist->GetSumw2N() > 0) {
+		const double* e = hist->GetSumw2()->GetArray() + first;
+		for (int j = 0; j < n; ++j)
+			err[j] = e[j];
+	} else {
+		for (int j = 0; j < n; ++j)
+			err[j] = std::fabs( (double)value[first+j] );
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method returns the sum of histograms \a hist.
+ */
+TH1* MeshKernels::sum(std::vector<TH1*> hist, TString name)
+{
+	return weightedSum(hist, std::vector<double>(hist.size(), 1.), name);
+}
+
+/***************************************************************************/
+/**
+ * This method returns the sum of histograms \a hist weighted by \a weight;
+ * squared errors are summed with squared weights.
+ */
+TH1* MeshKernels::weightedSum(std::vector<TH1*> hist, std::vector<double> weight, TString name)
+{
+	if (!check(hist))
+		return 0;
+	if (weight.size() != hist.size()) {
+		ERROR( TString::Format( "Number of weights (%d) is different from number of histograms (%d)", (int)weight.size(), (int)hist.size() ) );
+		return 0;
+	}
+	TH1* out = create(hist[0], name);
+	if (dynamic_cast<TArrayF*>(hist[0]))
+		sumKernel<float>(hist, weight, out);
+	else
+		sumKernel<double>(hist, weight, out);
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the ratios hist[i]/ref.
+ */
+std::vector<TH1*> MeshKernels::ratio(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name)
+{
+	return divide(hist, ref, name, 0.);
+}
+
+/***************************************************************************/
+/**
+ * This method returns the relative differences (hist[i]-ref)/ref; their
+ * errors are the errors of the ratios hist[i]/ref.
+ */
+std::vector<TH1*> MeshKernels::relDiff(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name)
+{
+	return divide(hist, ref, name, -1.);
+}
+
+/***************************************************************************/
+/**
+ * This method compares histograms \a hist with \a ref bin by bin with the
+ * z-score
+ * \f[ z = \frac{a - b}{\sqrt{\sigma_a^2 + \sigma_b^2}} \f]
+ * (bins with zero errors are not compared) and summarizes the number of 
+ * bins with |z| > \a tolerance, the \f$ \chi^2 = \sum z^2 \f$ and the 
+ * largest |z|. The maps of z or z^2 are only created if \a name is not 
+ * empty.
+ */
+std::vector<TH1*> MeshKernels::significance(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name, TString map, double tolerance, std::vector<MeshSignificance>& summary)
+{
+	std::vector<TH1*> out;
+	std::vector<TH1*> all(hist);
+	all.push_back(ref);
+	summary.assign(hist.size(), MeshSignificance());
+	if (!ref || !check(all))
+		return out;
+	if (map != "z" && map != "chi2") {
+		ERROR("Unknown significance map '"+map+"', use 'z' or 'chi2'");
+		return out;
+	}
+	if (name.size() > 0 && name.size() != hist.size()) {
+		ERROR( TString::Format( "Number of names (%d) is different from number of histograms (%d)", (int)name.size(), (int)hist.size() ) );
+		return out;
+	}
+	for (size_t i = 0; i < name.size(); ++i) {
+		TH1* h = (TH1*)hist[i]->Clone(name[i]);
+		h->Reset();
+		out.push_back(h);
+	}
+	if (dynamic_cast<TArrayF*>(ref))
+		significanceKernel<float>(hist, ref, out, map == "chi2", tolerance, summary);
+	else
+		significanceKernel<double>(hist, ref, out, map == "chi2", tolerance, summary);
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This method adds \a weight times \a hist to \a sum in place, squared 
+ * errors are added with the squared weight. Runs can so be combined one
+ * after another, keeping only the running sum in memory.
+ */
+TH1* MeshKernels::accumulate(TH1* sum, TH1* hist, double weight, TString name)
+{
+	if (!sum) {
+		std::vector<TH1*> one(1, hist);
+		if (!check(one))
+			return 0;
+		sum = create(hist, name);
+		sum->SetEntries(0);
+	}
+	std::vector<TH1*> pair;
+	pair.push_back(sum);
+	pair.push_back(hist);
+	if (!check(pair))
+		return sum;
+	std::vector<double> weight2(2, 1.);
+	weight2[1] = weight;
+	if (dynamic_cast<TArrayF*>(sum))
+		sumKernel<float>(pair, weight2, sum);
+	else
+		sumKernel<double>(pair, weight2, sum);
+	sum->SetEntries( sum->GetEntries() + hist->GetEntries() );
+	return sum;
+}
+
+/***************************************************************************/
+/**
+ * This method returns a histogram with the relative errors 
+ * \f$ \sigma/|x| \f$ of the bins of \a hist (0 for empty bins).
+ */
+TH1* MeshKernels::relError(TH1* hist, TString name)
+{
+	std::vector<TH1*> one(1, hist);
+	if (!check(one))
+		return 0;
+	TH1* out = (TH1*)hist->Clone(name);
+	out->Reset();
+	if (dynamic_cast<TArrayF*>(hist))
+		relErrorKernel<float>(hist, out);
+	else
+		relErrorKernel<double>(hist, out);
+	out->SetEntries( hist->GetEntries() );
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This method creates the output histograms and runs the division kernel
+ * which computes hist[i]/ref + \a offset for all histograms at once.
+ */
+std::vector<TH1*> MeshKernels::divide(std::vector<TH1*> hist, TH1* ref, std::vector<TString> name, double offset)
+{
+	std::vector<TH1*> out;
+	std::vector<TH1*> all(hist);
+	all.push_back(ref);
+	if (!ref || !check(all))
+		return out;
+	if (name.size() != hist.size()) {
+		ERROR( TString::Format( "Number of names (%d) is different from number of histograms (%d)", (int)name.size(), (int)hist.size() ) );
+		return out;
+	}
+	for (size_t i = 0; i < hist.size(); ++i)
+		out.push_back( create(hist[i], name[i]) );
+	if (dynamic_cast<TArrayF*>(ref))
+		divideKernel<float>(hist, ref, out, offset);
+	else
+		divideKernel<double>(hist, ref, out, offset);
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This method checks that all histograms exist and have the same number
+ * of cells and the same (float or double) bin type.
+ */
+bool MeshKernels::check(const std::vector<TH1*>& hist)
+{
+	if (hist.size() == 0 || !hist[0]) {
+		ERROR("No histogram given");
+		return false;
+	}
+	bool isFloat = (dynamic_cast<TArrayF*>(hist[0]) != 0);
+	if (!isFloat && !dynamic_cast<TArrayD*>(hist[0])) {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", hist[0]->GetName() ) );
+		return false;
+	}
+	for (size_t i = 1; i < hist.size(); ++i) {
+		if (!hist[i] || hist[i]->GetNcells() != hist[0]->GetNcells() || (dynamic_cast<TArrayF*>(hist[i]) != 0) != isFloat) {
+			ERROR( TString::Format( "Histogram %d is not compatible with histogram '%s'", (int)i, hist[0]->GetName() ) );
+			return false;
+		}
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method creates an empty copy of \a hist with error array.
+ */
+TH1* MeshKernels::create(TH1* hist, TString name)
+{
+	TH1* out = (TH1*)hist->Clone(name);
+	out->Reset();
+	if (out->GetSumw2N() == 0)
+		out->Sumw2();
+	out->SetEntries( hist->GetEntries() );
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This is the weighted sum kernel. Each thread takes a range of bins; for
+ * each block of bins the contributions of all histograms are accumulated
+ * in double precision in local arrays and then stored in \a out.
+ */
+template<class T> void MeshKernels::sumKernel(const std::vector<TH1*>& hist, const std::vector<double>& weight, TH1* out)
+{
+	int ncells = hist[0]->GetNcells();
+	int n = (int)hist.size();
+	std::vector<T*> value(n);
+	for (int k = 0; k < n; ++k)
+		value[k] = getValues<T>(hist[k]);
+	T* outValue = getValues<T>(out);
+	double* outError = out->GetSumw2()->GetArray();
+
+	int chunk = ( (ncells / (4*m_pool.size()) + kBlock) / kBlock ) * kBlock;
+	m_pool.parallelFor(0, ncells, [&](int first, int last) {
+		double sum[kBlock], sum2[kBlock], err[kBlock];
+		for (int b = first; b < last; b += kBlock) {
+			int m = std::min(kBlock, last - b);
+			for (int j = 0; j < m; ++j) {
+				sum[j] = 0.; sum2[j] = 0.;
+			}
+			for (int k = 0; k < n; ++k) {
+				const T* v = value[k] + b;
+				double w = weight[k], w2 = w*w;
+				getErrors(hist[k], value[k], b, m, err);
+				for (int j = 0; j < m; ++j) {
+					sum[j]  += w  * v[j];
+					sum2[j] += w2 * err[j];
+				}
+			}
+			for (int j = 0; j < m; ++j) {
+				outValue[b+j] = (T)sum[j];
+				outError[b+j] = sum2[j];
+			}
+		}
+	}, chunk);
+}
+
+/***************************************************************************/
+/**
+ * This is the division kernel, it computes hist[k]/ref + \a offset with
+ * error
+ * \f[ \sigma^2 = \frac{\sigma_a^2 b^2 + \sigma_b^2 a^2}{b^4} \f]
+ * (uncorrelated histograms, as \a TH1::Divide()). Bins with zero reference
+ * are set to zero. The reference block is read once and reused for all
+ * histograms.
+ */
+template<class T> void MeshKernels::divideKernel(const std::vector<TH1*>& hist, TH1* ref, const std::vector<TH1*>& out, double offset)
+{
+	int ncells = ref->GetNcells();
+	int n = (int)hist.size();
+	T* refValue = getValues<T>(ref);
+	std::vector<T*> value(n), outValue(n);
+	std::vector<double*> outError(n);
+	for (int k = 0; k < n; ++k) {
+		value[k]    = getValues<T>(hist[k]);
+		outValue[k] = getValues<T>(out[k]);
+		outError[k] = out[k]->GetSumw2()->GetArray();
+	}
+
+	int chunk = ( (ncells / (4*m_pool.size()) + kBlock) / kBlock ) * kBlock;
+	m_pool.parallelFor(0, ncells, [&](int first, int last) {
+		double b[kBlock], inv[kBlock], eb2[kBlock], ea2[kBlock];
+		for (int blk = first; blk < last; blk += kBlock) {
+			int m = std::min(kBlock, last - blk);
+			getErrors(ref, refValue, blk, m, eb2);
+			for (int j = 0; j < m; ++j) {
+				b[j]   = refValue[blk+j];
+				inv[j] = (b[j] != 0. ? 1./b[j] : 0.);
+			}
+			for (int k = 0; k < n; ++k) {
+				const T* a = value[k] + blk;
+				T* r = outValue[k] + blk;
+				double* er = outError[k] + blk;
+				getErrors(hist[k], value[k], blk, m, ea2);
+				for (int j = 0; j < m; ++j) {
+					double inv2 = inv[j]*inv[j];
+					r[j]  = (T)( inv[j] != 0. ? a[j]*inv[j] + offset : 0. );
+					er[j] = ( ea2[j]*b[j]*b[j] + eb2[j]*a[j]*a[j] ) * inv2*inv2;
+				}
+			}
+		}
+	}, chunk);
+}
+
+/***************************************************************************/
+/**
+ * This is the relative error kernel; the error array of \a out is not 
+ * touched.
+ */
+template<class T> void MeshKernels::relErrorKernel(TH1* hist, TH1* out)
+{
+	int ncells = hist->GetNcells();
+	T* value = getValues<T>(hist);
+	T* outValue = getValues<T>(out);
+
+	int chunk = ( (ncells / (4*m_pool.size()) + kBlock) / kBlock ) * kBlock;
+	m_pool.parallelFor(0, ncells, [&](int first, int last) {
+		double err[kBlock];
+		for (int b = first; b < last; b += kBlock) {
+			int m = std::min(kBlock, last - b);
+			getErrors(hist, value, b, m, err);
+			for (int j = 0; j < m; ++j) {
+				double v = std::fabs( (double)value[b+j] );
+				outValue[b+j] = (T)( v > 0. ? std::sqrt(err[j])/v : 0. );
+			}
+		}
+	}, chunk);
+}
+
+/***************************************************************************/
+/**
+ * This is the significance kernel. The bins are split in chunks of fixed
+ * size whose partial summaries are added in chunk order at the end, so
+ * the summary does not depend on the number of threads.
+ */
+template<class T> void MeshKernels::significanceKernel(const std::vector<TH1*>& hist, TH1* ref, const std::vector<TH1*>& out, bool chi2, double tolerance, std::vector<MeshSignificance>& summary)
+{
+	int ncells = ref->GetNcells();
+	int n = (int)hist.size();
+	T* refValue = getValues<T>(ref);
+	std::vector<T*> value(n), outValue(out.size());
+	for (int k = 0; k < n; ++k)
+		value[k] = getValues<T>(hist[k]);
+	for (size_t k = 0; k < out.size(); ++k)
+		outValue[k] = getValues<T>(out[k]);
+
+	const int chunk = 16*kBlock;
+	int nchunks = (ncells + chunk - 1) / chunk;
+	std::vector<MeshSignificance> partial(n*nchunks);
+	m_pool.parallelFor(0, ncells, [&](int first, int last) {
+		double eb2[kBlock], ea2[kBlock];
+		int c = first / chunk;
+		for (int blk = first; blk < last; blk += kBlock) {
+			int m = std::min(kBlock, last - blk);
+			getErrors(ref, refValue, blk, m, eb2);
+			for (int k = 0; k < n; ++k) {
+				const T* a = value[k] + blk;
+				const T* b = refValue + blk;
+				T* z = (out.size() > 0 ? outValue[k] + blk : 0);
+				MeshSignificance& s = partial[k*nchunks + c];
+				getErrors(hist[k], value[k], blk, m, ea2);
+				for (int j = 0; j < m; ++j) {
+					double var = ea2[j] + eb2[j];
+					if (var <= 0.) continue;
+					double zj = (a[j] - b[j]) / std::sqrt(var);
+					double az = std::fabs(zj);
+					s.nbins++;
+					s.chi2 += zj*zj;
+					if (az > tolerance) s.noutside++;
+					if (az > s.maxZ) s.maxZ = az;
+					if (z) z[j] = (T)(chi2 ? zj*zj : zj);
+				}
+			}
+		}
+	}, chunk);
+
+	for (int k = 0; k < n; ++k)
+		for (int c = 0; c < nchunks; ++c) {
+			const MeshSignificance& s = partial[k*nchunks + c];
+			summary[k].nbins    += s.nbins;
+			summary[k].noutside += s.noutside;
+			summary[k].chi2     += s.chi2;
+			summary[k].maxZ      = std::max(summary[k].maxZ, s.maxZ);
+		}
+	for (size_t k = 0; k < out.size(); ++k)
+		out[k]->SetEntries( summary[k].nbins );
+}
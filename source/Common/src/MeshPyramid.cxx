@@ -0,0 +1,191 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshPyramid.cxx
+ *
+ */
+
+#include "MeshPyramid.h"
+#include <algorithm>
+#include <TNamed.h>
+
+/***************************************************************************/
+/**
+ * This function returns the bin boundaries of axis \a axis, taking every
+ * second boundary (and the last one) if \a coarse is true.
+ */
+static std::vector<double> getEdges(const TAxis* axis, bool coarse)
+{
+	int n = axis->GetNbins();
+	std::vector<double> edge;
+	for (int i = 1; i <= n; i += (coarse ? 2 : 1))
+		edge.push_back( axis->GetBinLowEdge(i) );
+	edge.push_back( axis->GetBinUpEdge(n) );
+	return edge;
+}
+
+/***************************************************************************/
+/**
+ * This method builds at most \a nlevels levels; it stops when all axes
+ * have only one bin.
+ */
+std::vector<TH3F*> MeshPyramid::build(TH3F* hist, int nlevels)
+{
+	std::vector<TH3F*> levels;
+	if (m_pooling != "mean" && m_pooling != "max") {
+		ERROR("Unknown pooling method '"+m_pooling+"', use 'mean' or 'max'");
+		return levels;
+	}
+	TH3F* level = hist;
+	for (int i = 1; i <= nlevels; ++i) {
+		if (level->GetNbinsX() == 1 && level->GetNbinsY() == 1 && level->GetNbinsZ() == 1)
+			break;
+		level = pool(level, TString::Format("L%d", i));
+		levels.push_back(level);
+		DEBUG( TString::Format( "Level %d of '%s': %d x %d x %d bins", i, hist->GetName(), level->GetNbinsX(), level->GetNbinsY(), level->GetNbinsZ() ) );
+	}
+	return levels;
+}
+
+/***************************************************************************/
+/**
+ * This method creates the next level of \a hist. For "mean" pooling the
+ * value of a coarse bin is the volume weighted mean of its (up to 8) fine
+ * bins, with error
+ * \f[ \sigma^2 = \sum_i (V_i/V)^2 \sigma_i^2 \f]
+ * For "max" pooling it takes value and error of the fine bin with the
+ * largest value.
+ */
+TH3F* MeshPyramid::pool(TH3F* hist, TString name)
+{
+	std::vector<double> edge[3] = { getEdges(hist->GetXaxis(), true), getEdges(hist->GetYaxis(), true), getEdges(hist->GetZaxis(), true) };
+	int n[3] = { hist->GetNbinsX(), hist->GetNbinsY(), hist->GetNbinsZ() };
+	int m[3] = { (int)edge[0].size()-1, (int)edge[1].size()-1, (int)edge[2].size()-1 };
+	TH3F* out = new TH3F(name, hist->GetTitle(), m[0], &edge[0][0], m[1], &edge[1][0], m[2], &edge[2][0]);
+	out->SetDirectory(0);
+	out->Sumw2();
+
+	const float* value = hist->GetArray();
+	const double* error = (hist->GetSumw2N() > 0 ? hist->GetSumw2()->GetArray() : 0);
+	float* outValue = out->GetArray();
+	double* outError = out->GetSumw2()->GetArray();
+	std::vector<double> width[3];
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a)
+		for (int i = 0; i <= n[a]; ++i)
+			width[a].push_back( axis[a]->GetBinWidth(i) );
+	bool isMax = (m_pooling == "max");
+
+	for (int k = 1; k <= m[2]; ++k)
+	for (int j = 1; j <= m[1]; ++j)
+	for (int i = 1; i <= m[0]; ++i) {
+		double sum = 0., sum2 = 0., volume = 0., vmax = 0., emax = 0.;
+		bool first = true;
+		for (int fk = 2*k-1; fk <= std::min(2*k, n[2]); ++fk)
+		for (int fj = 2*j-1; fj <= std::min(2*j, n[1]); ++fj)
+		for (int fi = 2*i-1; fi <= std::min(2*i, n[0]); ++fi) {
+			int bin = fi + (n[0]+2)*(fj + (n[1]+2)*fk);
+			double v = value[bin];
+			double e2 = (error ? error[bin] : std::max(v, 0.));
+			if (isMax) {
+				if (first || v > vmax) {
+					vmax = v;
+					emax = e2;
+				}
+			} else {
+				double dv = width[0][fi] * width[1][fj] * width[2][fk];
+				sum    += dv*v;
+				sum2   += dv*dv*e2;
+				volume += dv;
+			}
+			first = false;
+		}
+		int bin = i + (m[0]+2)*(j + (m[1]+2)*k);
+		if (isMax) {
+			outValue[bin] = (float)vmax;
+			outError[bin] = emax;
+		} else if (volume > 0.) {
+			outValue[bin] = (float)(sum/volume);
+			outError[bin] = sum2/(volume*volume);
+		}
+	}
+	out->SetEntries( hist->GetEntries() );
+	return out;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the levels and the pooling method to the
+ * sub-directory "<mesh name>_pyramid" of \a dir.
+ */
+void MeshPyramid::write(TH3* hist, const std::vector<TH3F*>& levels, TDirectory* dir)
+{
+	if (levels.size() == 0)
+		return;
+	TDirectory* pyramid = dir->mkdir( TString(hist->GetName())+"_pyramid", "Pyramid of "+TString(hist->GetName()), true );
+	if (!pyramid) {
+		ERROR( TString::Format( "Cannot create pyramid directory of '%s'", hist->GetName() ) );
+		return;
+	}
+	for (size_t i = 0; i < levels.size(); ++i)
+		pyramid->WriteTObject(levels[i], levels[i]->GetName(), "WriteDelete");
+	TNamed pooling("pooling", m_pooling.Data());
+	pyramid->WriteTObject(&pooling, "pooling", "WriteDelete");
+	dir->cd();
+}
+
+/***************************************************************************/
+/**
+ * This method reads the levels written by \ref write() for the mesh
+ * \a hist; the first element of the returned vector is \a hist itself.
+ * With \a pooling, the coarser levels are only read if the pyramid was
+ * built with this pooling method.
+ */
+std::vector<TH3*> MeshPyramid::read(TH3* hist, TDirectory* dir, TString pooling)
+{
+	std::vector<TH3*> levels(1, hist);
+	TDirectory* pyramid = dir->GetDirectory( TString(hist->GetName())+"_pyramid" );
+	if (!pyramid)
+		return levels;
+	if (pooling != "" && getPooling(hist, dir) != pooling)
+		return levels;
+	for (int i = 1; ; ++i) {
+		TH3* level = dynamic_cast<TH3*>( pyramid->Get( TString::Format("L%d", i) ) );
+		if (!level)
+			break;
+		levels.push_back(level);
+	}
+	return levels;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the pooling method written by \ref write(), or an
+ * empty string if there is no pyramid or its pooling is not recorded.
+ */
+TString MeshPyramid::getPooling(TH3* hist, TDirectory* dir)
+{
+	TDirectory* pyramid = dir->GetDirectory( TString(hist->GetName())+"_pyramid" );
+	if (!pyramid)
+		return "";
+	TNamed* pooling = dynamic_cast<TNamed*>( pyramid->Get("pooling") );
+	return (pooling ? TString(pooling->GetTitle()) : TString(""));
+}
+
+/***************************************************************************/
+/**
+ * This method returns the coarsest level which has at least \a n1 bins on
+ * axis \a axis1 and \a n2 bins on axis \a axis2; if even level 0 has fewer
+ * bins, level 0 is returned.
+ */
+int MeshPyramid::select(const std::vector<TH3*>& levels, int axis1, int n1, int axis2, int n2)
+{
+	for (int i = (int)levels.size()-1; i > 0; --i) {
+		const TAxis* axis[3] = { levels[i]->GetXaxis(), levels[i]->GetYaxis(), levels[i]->GetZaxis() };
+		if (axis[axis1]->GetNbins() >= n1 && (axis2 < 0 || axis[axis2]->GetNbins() >= n2))
+			return i;
+	}
+	return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshSampler.cxx
+ *
+ */
+
+#include "MeshSampler.h"
+#include <TArrayF.h>
+#include <TArrayD.h>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+static const int kBlock = 1024;
+
+/***************************************************************************/
+/**
+ * The constructor keeps the bin centers of the axes of the mesh.
+ */
+MeshSampler::MeshSampler(TH3* hist, int nthreads) : m_hist(hist), m_pool(nthreads), message("MeshSampler")
+{
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a) {
+		m_n[a]       = axis[a]->GetNbins();
+		m_low[a]     = axis[a]->GetBinLowEdge(1);
+		m_up[a]      = axis[a]->GetBinUpEdge(m_n[a]);
+		m_uniform[a] = !axis[a]->IsVariableBinSize();
+		for (int i = 1; i <= m_n[a]; ++i)
+			m_center[a].push_back( axis[a]->GetBinCenter(i) );
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method finds the two bins \a cell and \a cell+1 around the
+ * coordinate, with the weight of the upper one. Before the first (after
+ * the last) bin center the weight of the first (last) bin is 1.
+ */
+bool MeshSampler::locate(int axis, double x, int& cell, double& weight) const
+{
+	const std::vector<double>& c = m_center[axis];
+	int n = m_n[axis];
+	if (!(x >= m_low[axis] && x <= m_up[axis]))
+		return false;
+	if (n == 1 || x <= c[0]) {
+		cell = 1;
+		weight = 0.;
+	} else if (x >= c[n-1]) {
+		cell = n-1;
+		weight = 1.;
+	} else {
+		int i;
+		if (m_uniform[axis]) {
+			double t = (x - c[0]) / (c[1] - c[0]);
+			i = std::min( (int)t, n-2 );
+		} else
+			i = (int)( std::upper_bound(c.begin(), c.end(), x) - c.begin() ) - 1;
+		cell = i+1;
+		weight = (x - c[i]) / (c[i+1] - c[i]);
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This kernel interpolates the points \a order[0..n-1]. The cells and
+ * weights of the block are computed first, then each of the 8 corners is
+ * added for all points of the block.
+ */
+template<class T> void MeshSampler::sampleKernel(const T* array, const double* error2, const int* order, int n,
+		const double* x, const double* y, const double* z, double* value, double* error)
+{
+	int sy = m_n[0]+2, sz = (m_n[0]+2)*(m_n[1]+2);
+	int base[kBlock];
+	double w[3][kBlock], v[kBlock], e2[kBlock];
+	for (int p = 0; p < n; ++p) {
+		int i = order[p], cell[3];
+		locate(0, x[i], cell[0], w[0][p]);
+		locate(1, y[i], cell[1], w[1][p]);
+		locate(2, z[i], cell[2], w[2][p]);
+		base[p] = cell[0] + cell[1]*sy + cell[2]*sz;
+		v[p]  = 0.;
+		e2[p] = 0.;
+	}
+	for (int c = 0; c < 8; ++c) {
+		int offset = (c & 1) + ((c >> 1) & 1)*sy + ((c >> 2) & 1)*sz;
+		const double* wx = w[0];
+		const double* wy = w[1];
+		const double* wz = w[2];
+		bool ux = (c & 1), uy = ((c >> 1) & 1), uz = ((c >> 2) & 1);
+		for (int p = 0; p < n; ++p) {
+			double weight = (ux ? wx[p] : 1.-wx[p]) * (uy ? wy[p] : 1.-wy[p]) * (uz ? wz[p] : 1.-wz[p]);
+			double val = array[base[p]+offset];
+			v[p]  += weight*val;
+			e2[p] += weight*weight*(error2 ? error2[base[p]+offset] : std::fabs(val));
+		}
+	}
+	for (int p = 0; p < n; ++p) {
+		value[order[p]] = v[p];
+		error[order[p]] = std::sqrt(e2[p]);
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method sorts the points by their mesh cell (points outside of the
+ * mesh first, they are not interpolated) and interpolates blocks of the
+ * sorted points in parallel.
+ */
+int MeshSampler::sample(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+		std::vector<double>& value, std::vector<double>& error)
+{
+	int npoints = (int) x.size();
+	value.assign(npoints, 0.);
+	error.assign(npoints, 0.);
+	if (y.size() != x.size() || z.size() != x.size()) {
+		ERROR("Different numbers of point coordinates!");
+		return 0;
+	}
+	if (npoints == 0)
+		return 0;
+
+	// sort points by their cell
+	std::vector< std::pair<int,int> > key(npoints);
+	int nx = m_n[0]+2, nxy = (m_n[0]+2)*(m_n[1]+2);
+	m_pool.parallelFor(0, npoints, [&](int first, int last) {
+		for (int i = first; i < last; ++i) {
+			int cell[3];
+			double weight;
+			if (locate(0, x[i], cell[0], weight) && locate(1, y[i], cell[1], weight) && locate(2, z[i], cell[2], weight))
+				key[i] = std::make_pair(cell[0] + cell[1]*nx + cell[2]*nxy, i);
+			else
+				key[i] = std::make_pair(-1, i);
+		}
+	}, kBlock);
+	std::sort(key.begin(), key.end());
+	std::vector<int> order(npoints);
+	int ninside = 0;
+	for (int i = 0; i < npoints; ++i) {
+		order[i] = key[i].second;
+		if (key[i].first >= 0) ++ninside;
+	}
+	int begin = npoints - ninside;
+	if (ninside < npoints)
+		DEBUG( TString::Format( "%d of %d points outside of mesh '%s'", npoints-ninside, npoints, m_hist->GetName() ) );
+
+	// interpolate blocks of sorted points
+	const double* error2 = (m_hist->GetSumw2N() > 0 ? m_hist->GetSumw2()->GetArray() : 0);
+	TArrayF* arrayF = dynamic_cast<TArrayF*>(m_hist);
+	TArrayD* arrayD = dynamic_cast<TArrayD*>(m_hist);
+	if (!arrayF && !arrayD) {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", m_hist->GetName() ) );
+		return 0;
+	}
+	m_pool.parallelFor(begin, npoints, [&](int first, int last) {
+		for (int b = first; b < last; b += kBlock) {
+			int m = std::min(kBlock, last - b);
+			if (arrayF)
+				sampleKernel(arrayF->GetArray(), error2, &order[b], m, &x[0], &y[0], &z[0], &value[0], &error[0]);
+			else
+				sampleKernel(arrayD->GetArray(), error2, &order[b], m, &x[0], &y[0], &z[0], &value[0], &error[0]);
+		}
+	}, 4*kBlock);
+	return ninside;
+}
+
+/***************************************************************************/
+/**
+ * This method interpolates the mesh at a single point.
+ */
+double MeshSampler::sample(double x, double y, double z, double* error)
+{
+	std::vector<double> px(1, x), py(1, y), pz(1, z), value, err;
+	sample(px, py, pz, value, err);
+	if (error)
+		*error = err[0];
+	return value[0];
+}
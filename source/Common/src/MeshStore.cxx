@@ -0,0 +1,509 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     MeshStore.cxx
+ *
+ */
+
+#include "MeshStore.h"
+#include <cmath>
+#include <algorithm>
+#include <TROOT.h>
+#include <TFile.h>
+#include <TList.h>
+
+/***************************************************************************/
+/**
+ * This is constructor of MeshStore class, it initializes an empty mesh
+ * with the default cache size (64 tiles).
+ */
+MeshStore::MeshStore() : m_dir(0), m_file(0), m_cacheSize(64), m_lastIndex(-1), m_last(0), message("MeshStore")
+{
+	for (int i = 0; i < 3; ++i) {
+		m_nbin[i] = 0; m_tile[i] = 1; m_ntile[i] = 0;
+	}
+}
+
+/***************************************************************************/
+/**
+ * This is destructor of MeshStore class, it writes out the modified tiles.
+ * If the file of the mesh has already been closed, the tiles cannot be
+ * written any more and are dropped with a warning.
+ */
+MeshStore::~MeshStore()
+{
+	if (m_dir && m_file && (!gROOT->GetListOfFiles()->FindObject(m_file) || !m_file->IsOpen())) {
+		WARN("File of mesh '"+m_name+"' is closed before the mesh, modified tiles are lost");
+		m_dir = 0;
+	}
+	close();
+}
+
+/***************************************************************************/
+/**
+ * This method creates a new mesh in the sub-directory \a name of \a dir
+ * and writes the mesh information (title, bin boundaries and tile size).
+ * An existing mesh with the same name is replaced.
+ */
+bool MeshStore::create(TDirectory* dir, TString name, TString title, const std::vector<double>& xedge, const std::vector<double>& yedge, const std::vector<double>& zedge,
+                       int tx, int ty, int tz)
+{
+	close();
+	if (!dir || xedge.size() < 2 || yedge.size() < 2 || zedge.size() < 2 || tx < 1 || ty < 1 || tz < 1) {
+		ERROR("Cannot create mesh '"+name+"', invalid binning or tile size");
+		return false;
+	}
+	m_dir = dir->mkdir(name, title, true);
+	if (!m_dir) {
+		ERROR("Cannot create directory '"+name+"'");
+		return false;
+	}
+	m_dir->Delete("*;*");
+	m_file  = m_dir->GetFile();
+	m_name  = name;
+	m_title = title;
+	m_edge[0] = xedge; m_edge[1] = yedge; m_edge[2] = zedge;
+	m_tile[0] = tx;    m_tile[1] = ty;    m_tile[2] = tz;
+	setup();
+
+	TArrayD x((int)xedge.size(), &xedge[0]), y((int)yedge.size(), &yedge[0]), z((int)zedge.size(), &zedge[0]);
+	TArrayI tile(3, m_tile);
+	TNamed info(name, title);
+	m_dir->WriteObjectAny(&x, "TArrayD", "xedge", "WriteDelete");
+	m_dir->WriteObjectAny(&y, "TArrayD", "yedge", "WriteDelete");
+	m_dir->WriteObjectAny(&z, "TArrayD", "zedge", "WriteDelete");
+	m_dir->WriteObjectAny(&tile, "TArrayI", "tile", "WriteDelete");
+	m_dir->WriteTObject(&info, "info", "WriteDelete");
+	DEBUG( TString::Format( "Created mesh '%s' of %d x %d x %d bins, %d x %d x %d tiles", name.Data(), m_nbin[0], m_nbin[1], m_nbin[2], m_ntile[0], m_ntile[1], m_ntile[2] ) );
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method opens the mesh \a name stored in \a dir by \ref create().
+ */
+bool MeshStore::open(TDirectory* dir, TString name)
+{
+	close();
+	m_dir = (dir ? dir->GetDirectory(name) : 0);
+	TArrayD* x    = (m_dir ? (TArrayD*)m_dir->GetObjectChecked("xedge", "TArrayD") : 0);
+	TArrayD* y    = (m_dir ? (TArrayD*)m_dir->GetObjectChecked("yedge", "TArrayD") : 0);
+	TArrayD* z    = (m_dir ? (TArrayD*)m_dir->GetObjectChecked("zedge", "TArrayD") : 0);
+	TArrayI* tile = (m_dir ? (TArrayI*)m_dir->GetObjectChecked("tile" , "TArrayI") : 0);
+	if (!x || !y || !z || !tile) {
+		ERROR("Cannot find mesh '"+name+"'");
+		delete x; delete y; delete z; delete tile;
+		m_dir = 0;
+		return false;
+	}
+	m_file = m_dir->GetFile();
+	m_name = name;
+	TNamed* info = (TNamed*)m_dir->Get("info");
+	m_title = (info ? info->GetTitle() : "");
+	m_edge[0].assign(x->GetArray(), x->GetArray()+x->GetSize());
+	m_edge[1].assign(y->GetArray(), y->GetArray()+y->GetSize());
+	m_edge[2].assign(z->GetArray(), z->GetArray()+z->GetSize());
+	for (int i = 0; i < 3; ++i)
+		m_tile[i] = tile->At(i);
+	delete x; delete y; delete z; delete tile; delete info;
+	setup();
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method writes out all modified tiles and releases the cache.
+ */
+void MeshStore::close()
+{
+	if (!m_dir)
+		return;
+	for (std::map<int, Tile>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+		if (it->second.dirty)
+			saveTile(it->first, it->second);
+	m_cache.clear();
+	m_lru.clear();
+	m_last = 0;
+	m_lastIndex = -1;
+	m_dir  = 0;
+	m_file = 0;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the maximum number of tiles kept in memory (at least 1).
+ */
+void MeshStore::setCacheSize(int ntiles)
+{
+	m_cacheSize = std::max(ntiles, 1);
+	evict();
+}
+
+/***************************************************************************/
+/**
+ * This method computes the number of bins and tiles on each axis.
+ */
+void MeshStore::setup()
+{
+	for (int i = 0; i < 3; ++i) {
+		m_nbin[i]  = (int)m_edge[i].size()-1;
+		m_tile[i]  = std::min(m_tile[i], m_nbin[i]);
+		m_ntile[i] = (m_nbin[i] + m_tile[i] - 1) / m_tile[i];
+	}
+	m_cache.clear();
+	m_lru.clear();
+	m_last = 0;
+	m_lastIndex = -1;
+}
+
+/***************************************************************************/
+/**
+ * This method writes out the least recently used tiles (front of the
+ * usage list) until there is room for one more tile in the cache.
+ */
+void MeshStore::evict()
+{
+	while ((int)m_cache.size() >= m_cacheSize) {
+		std::map<int, Tile>::iterator oldest = m_cache.find(m_lru.front());
+		m_lru.pop_front();
+		if (oldest->second.dirty)
+			saveTile(oldest->first, oldest->second);
+		if (oldest->first == m_lastIndex) {
+			m_last = 0;
+			m_lastIndex = -1;
+		}
+		m_cache.erase(oldest);
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method returns the tile \a index; the tile is read from file (or
+ * created with zeros if it has never been written) when it is not in the
+ * cache.
+ */
+MeshStore::Tile& MeshStore::getTile(int index)
+{
+	if (index == m_lastIndex)
+		return *m_last;
+	std::map<int, Tile>::iterator it = m_cache.find(index);
+	if (it == m_cache.end()) {
+		evict();
+		Tile& tile = m_cache[index];
+		int size = m_tile[0]*m_tile[1]*m_tile[2];
+		TArrayF* value = (TArrayF*)m_dir->GetObjectChecked( TString::Format("v%d",index), "TArrayF" );
+		TArrayF* error = (TArrayF*)m_dir->GetObjectChecked( TString::Format("e%d",index), "TArrayF" );
+		if (value && value->GetSize() == size)
+			tile.value.assign(value->GetArray(), value->GetArray()+size);
+		else
+			tile.value.assign(size, 0.f);
+		if (error && error->GetSize() == size)
+			tile.error.assign(error->GetArray(), error->GetArray()+size);
+		else
+			tile.error.assign(size, 0.f);
+		delete value;
+		delete error;
+		tile.dirty = false;
+		tile.used = m_lru.insert(m_lru.end(), index);
+		it = m_cache.find(index);
+	} else
+		m_lru.splice(m_lru.end(), m_lru, it->second.used);
+	m_lastIndex = index;
+	m_last = &it->second;
+	return it->second;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the tile containing bin (\a ix, \a iy, \a iz) and
+ * the position \a pos of the bin in the tile.
+ */
+MeshStore::Tile& MeshStore::locate(int ix, int iy, int iz, int& pos)
+{
+	--ix; --iy; --iz;
+	int index = ix/m_tile[0] + m_ntile[0]*( iy/m_tile[1] + m_ntile[1]*(iz/m_tile[2]) );
+	pos = ix%m_tile[0] + m_tile[0]*( iy%m_tile[1] + m_tile[1]*(iz%m_tile[2]) );
+	return getTile(index);
+}
+
+/***************************************************************************/
+/**
+ * This method writes the values and squared errors of a tile to file.
+ */
+void MeshStore::saveTile(int index, Tile& tile)
+{
+	TArrayF value((int)tile.value.size(), &tile.value[0]);
+	TArrayF error((int)tile.error.size(), &tile.error[0]);
+	m_dir->WriteObjectAny(&value, "TArrayF", TString::Format("v%d",index), "WriteDelete");
+	m_dir->WriteObjectAny(&error, "TArrayF", TString::Format("e%d",index), "WriteDelete");
+	tile.dirty = false;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the value of bin (\a ix, \a iy, \a iz).
+ */
+double MeshStore::getBinContent(int ix, int iy, int iz)
+{
+	int pos;
+	return locate(ix, iy, iz, pos).value[pos];
+}
+
+/***************************************************************************/
+/**
+ * This method returns the error of bin (\a ix, \a iy, \a iz).
+ */
+double MeshStore::getBinError(int ix, int iy, int iz)
+{
+	int pos;
+	return std::sqrt( locate(ix, iy, iz, pos).error[pos] );
+}
+
+/***************************************************************************/
+/**
+ * This method sets the value of bin (\a ix, \a iy, \a iz).
+ */
+void MeshStore::setBinContent(int ix, int iy, int iz, double value)
+{
+	int pos;
+	Tile& tile = locate(ix, iy, iz, pos);
+	tile.value[pos] = (float)value;
+	tile.dirty = true;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the error of bin (\a ix, \a iy, \a iz).
+ */
+void MeshStore::setBinError(int ix, int iy, int iz, double error)
+{
+	int pos;
+	Tile& tile = locate(ix, iy, iz, pos);
+	tile.error[pos] = (float)(error*error);
+	tile.dirty = true;
+}
+
+/***************************************************************************/
+/**
+ * This method copies the bin values and errors of \a hist to the mesh,
+ * tile by tile. The histogram must have the binning of the mesh.
+ */
+void MeshStore::fill(TH3* hist)
+{
+	if (hist->GetNbinsX() != m_nbin[0] || hist->GetNbinsY() != m_nbin[1] || hist->GetNbinsZ() != m_nbin[2]) {
+		ERROR( TString::Format( "Binning of histogram '%s' is different from mesh '%s'", hist->GetName(), m_name.Data() ) );
+		return;
+	}
+	for (int iz = 1; iz <= m_nbin[2]; ++iz)
+		for (int iy = 1; iy <= m_nbin[1]; ++iy)
+			for (int ix = 1; ix <= m_nbin[0]; ++ix) {
+				int pos;
+				Tile& tile = locate(ix, iy, iz, pos);
+				double error = hist->GetBinError(ix, iy, iz);
+				tile.value[pos] = (float)hist->GetBinContent(ix, iy, iz);
+				tile.error[pos] = (float)(error*error);
+				tile.dirty = true;
+			}
+}
+
+/***************************************************************************/
+/**
+ * This method creates a TH3F histogram with the whole mesh; it is only
+ * meant for meshes which fit in memory.
+ */
+TH3F* MeshStore::toHisto(TString name)
+{
+	if (name == "")
+		name = m_name;
+	TH3F* hist = new TH3F(name, m_title, m_nbin[0], &m_edge[0][0], m_nbin[1], &m_edge[1][0], m_nbin[2], &m_edge[2][0]);
+	hist->Sumw2();
+	float* value = hist->GetArray();
+	double* error = hist->GetSumw2()->GetArray();
+	int nx = m_nbin[0]+2, nxy = (m_nbin[0]+2)*(m_nbin[1]+2);
+	for (int iz = 1; iz <= m_nbin[2]; ++iz)
+		for (int iy = 1; iy <= m_nbin[1]; ++iy)
+			for (int ix = 1; ix <= m_nbin[0]; ++ix) {
+				int pos;
+				Tile& tile = locate(ix, iy, iz, pos);
+				int bin = ix + nx*iy + nxy*iz;
+				value[bin] = tile.value[pos];
+				error[bin] = tile.error[pos];
+			}
+	hist->SetEntries( (double)m_nbin[0]*m_nbin[1]*m_nbin[2] );
+	return hist;
+}
+
+/***************************************************************************/
+/**
+ * This method sets default values (first and last bin) of a bin range and
+ * limits it to the mesh.
+ */
+void MeshStore::checkRange(std::vector<int>& range, int axis)
+{
+	if (range.size() < 1) range.push_back(1);
+	if (range.size() < 2) range.push_back(m_nbin[axis]);
+	range[0] = std::max(range[0], 1);
+	range[1] = std::min(range[1], m_nbin[axis]);
+}
+
+/***************************************************************************/
+/**
+ * This method creates a 1- or 2-dimension projection of the mesh in the
+ * given bin ranges. Each tile overlapping the ranges is loaded only once,
+ * so only the projection and the tile cache are kept in memory. As in
+ * \a TH3::Project3D(), option "x" gives a TH1D along x-axis and option
+ * "yx" gives a TH2D of y (vertical) versus x. Errors are summed in
+ * quadrature.
+ */
+TH1* MeshStore::makeProjection(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight)
+{
+	std::vector<int> range[3] = { rangeX, rangeY, rangeZ };
+	for (int i = 0; i < 3; ++i)
+		checkRange(range[i], i);
+
+	// axes of projection histogram (first one is the horizontal axis)
+	option.ToLower();
+	std::vector<int> axes;
+	for (int i = option.Length()-1; i >= 0; --i) {
+		int a = option[i]-'x';
+		if (a >= 0 && a < 3 && std::find(axes.begin(), axes.end(), a) == axes.end())
+			axes.push_back(a);
+	}
+	if (axes.size() < 1 || axes.size() > 2) {
+		ERROR("Undefined projection axis or plane!");
+		return 0;
+	}
+	const char* label[3] = { "x", "y", "z" };
+	TString name = m_name+"_p";
+	for (int i = (int)axes.size()-1; i >= 0; --i)
+		name += label[axes[i]];
+
+	// accumulate projection, tile by tile
+	int n0 = m_nbin[axes[0]], n1 = (axes.size() > 1 ? m_nbin[axes[1]] : 1);
+	std::vector<double> sum(n0*n1, 0.), err2(n0*n1, 0.);
+	int first[3], last[3];
+	for (int tz = (range[2][0]-1)/m_tile[2]; tz <= (range[2][1]-1)/m_tile[2]; ++tz)
+	for (int ty = (range[1][0]-1)/m_tile[1]; ty <= (range[1][1]-1)/m_tile[1]; ++ty)
+	for (int tx = (range[0][0]-1)/m_tile[0]; tx <= (range[0][1]-1)/m_tile[0]; ++tx) {
+		int t[3] = { tx, ty, tz };
+		for (int i = 0; i < 3; ++i) {
+			first[i] = std::max(range[i][0]-1, t[i]*m_tile[i]);
+			last[i]  = std::min(range[i][1]-1, (t[i]+1)*m_tile[i]-1);
+		}
+		Tile& tile = getTile( tx + m_ntile[0]*(ty + m_ntile[1]*tz) );
+		int b[3];
+		for (b[2] = first[2]; b[2] <= last[2]; ++b[2])
+			for (b[1] = first[1]; b[1] <= last[1]; ++b[1])
+				for (b[0] = first[0]; b[0] <= last[0]; ++b[0]) {
+					int pos = b[0]-tx*m_tile[0] + m_tile[0]*( b[1]-ty*m_tile[1] + m_tile[1]*(b[2]-tz*m_tile[2]) );
+					int k = b[axes[0]] + n0*( axes.size() > 1 ? b[axes[1]] : 0 );
+					sum[k]  += tile.value[pos];
+					err2[k] += tile.error[pos];
+				}
+	}
+
+	// create projection histogram
+	TH1* proj = 0;
+	if (axes.size() == 1)
+		proj = new TH1D(name, m_title, n0, &m_edge[axes[0]][0]);
+	else
+		proj = new TH2D(name, m_title, n0, &m_edge[axes[0]][0], n1, &m_edge[axes[1]][0]);
+	proj->Sumw2();
+	double total = 0.;
+	for (int j = 0; j < n1; ++j)
+		for (int i = 0; i < n0; ++i) {
+			int bin = (axes.size() > 1 ? proj->GetBin(i+1, j+1) : i+1);
+			proj->SetBinContent(bin, sum[i+n0*j]);
+			proj->SetBinError(bin, std::sqrt(err2[i+n0*j]));
+			total += sum[i+n0*j];
+		}
+	if (weight < 0 && total != 0.)
+		proj->Scale(1./total);
+	else if (weight >= 0 && weight != 1.)
+		proj->Scale(weight);
+	return proj;
+}
+
+/***************************************************************************/
+/**
+ * This method copies the bins in the given ranges to a new mesh \a out
+ * with the same tile size, one output tile at a time.
+ */
+bool MeshStore::makeRange(MeshStore& out, TDirectory* dir, TString name, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ)
+{
+	std::vector<int> range[3] = { rangeX, rangeY, rangeZ };
+	std::vector<double> edge[3];
+	for (int i = 0; i < 3; ++i) {
+		checkRange(range[i], i);
+		if (range[i][1] < range[i][0]) {
+			ERROR("Empty bin range for mesh '"+name+"'");
+			return false;
+		}
+		edge[i].assign(m_edge[i].begin()+range[i][0]-1, m_edge[i].begin()+range[i][1]+1);
+	}
+	if (!out.create(dir, name, m_title, edge[0], edge[1], edge[2], m_tile[0], m_tile[1], m_tile[2]))
+		return false;
+
+	int* ot = out.m_tile;
+	for (int tz = 0; tz < out.m_ntile[2]; ++tz)
+	for (int ty = 0; ty < out.m_ntile[1]; ++ty)
+	for (int tx = 0; tx < out.m_ntile[0]; ++tx) {
+		Tile& tile = out.getTile( tx + out.m_ntile[0]*(ty + out.m_ntile[1]*tz) );
+		for (int lz = 0; lz < ot[2] && tz*ot[2]+lz < out.m_nbin[2]; ++lz)
+			for (int ly = 0; ly < ot[1] && ty*ot[1]+ly < out.m_nbin[1]; ++ly)
+				for (int lx = 0; lx < ot[0] && tx*ot[0]+lx < out.m_nbin[0]; ++lx) {
+					int pos, opos = lx + ot[0]*(ly + ot[1]*lz);
+					Tile& src = locate(range[0][0]+tx*ot[0]+lx, range[1][0]+ty*ot[1]+ly, range[2][0]+tz*ot[2]+lz, pos);
+					tile.value[opos] = src.value[pos];
+					tile.error[opos] = src.error[pos];
+				}
+		tile.dirty = true;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method divides the mesh by \a den bin by bin and writes the result
+ * to a new mesh \a out, one tile at a time. Bins with zero denominator
+ * are set to zero. Errors are propagated as for uncorrelated meshes
+ * (as \a TH1::Divide()).
+ */
+bool MeshStore::makeRatio(MeshStore& den, MeshStore& out, TDirectory* dir, TString name)
+{
+	for (int i = 0; i < 3; ++i)
+		if (m_edge[i] != den.m_edge[i]) {
+			ERROR("Binning of mesh '"+den.m_name+"' is different from mesh '"+m_name+"'");
+			return false;
+		}
+	if (!out.create(dir, name, m_title, m_edge[0], m_edge[1], m_edge[2], m_tile[0], m_tile[1], m_tile[2]))
+		return false;
+
+	for (int tz = 0; tz < m_ntile[2]; ++tz)
+	for (int ty = 0; ty < m_ntile[1]; ++ty)
+	for (int tx = 0; tx < m_ntile[0]; ++tx) {
+		int index = tx + m_ntile[0]*(ty + m_ntile[1]*tz);
+		Tile& num = getTile(index);
+		Tile& res = out.getTile(index);
+		for (int lz = 0; lz < m_tile[2] && tz*m_tile[2]+lz < m_nbin[2]; ++lz)
+			for (int ly = 0; ly < m_tile[1] && ty*m_tile[1]+ly < m_nbin[1]; ++ly)
+				for (int lx = 0; lx < m_tile[0] && tx*m_tile[0]+lx < m_nbin[0]; ++lx) {
+					int pos = lx + m_tile[0]*(ly + m_tile[1]*lz);
+					int dpos;
+					Tile& d = den.locate(tx*m_tile[0]+lx+1, ty*m_tile[1]+ly+1, tz*m_tile[2]+lz+1, dpos);
+					double a = num.value[pos], b = d.value[dpos];
+					if (b == 0.) {
+						res.value[pos] = 0.f;
+						res.error[pos] = 0.f;
+						continue;
+					}
+					double b2 = b*b;
+					res.value[pos] = (float)(a/b);
+					res.error[pos] = (float)( (num.error[pos]*b2 + d.error[dpos]*a*a) / (b2*b2) );
+				}
+		res.dirty = true;
+	}
+	return true;
+}
@@ -37,14 +37,42 @@ void Plotter::setStyle(Config* config)
 	m_ratio       = config->get("Show Ratio"   , false);
 	m_ratioStyle  = config->get("Ratio Style"  , "ep");
 	m_nContour    = config->get("Number of Contours" , 10);
+	m_pyramidRes  = config->get("Pyramid Resolution", 200);
+	m_nthreads    = config->get("Number of Threads", 0);
 	m_plotDir     = config->get("Plot Folder"  , "plots");
 	m_plotFormat  = config->get("Plot Format"  , "pdf");
+	m_summedArea  = config->get("Summed Area Table", false);
+	m_contourLines= config->get("Contour Lines", false);
 	
 	TString color = config->get("Plot Color"   , "Blue");
 	m_plotColor   = colormap_[color];
 	setPlotStyle();
 }
 
+/***************************************************************************/
+/**
+ * The destructor deletes the summed-area tables and the contour extractor
+ * built by \ref makeProj2DPlot().
+ */
+Plotter::~Plotter()
+{
+	clearTables();
+	delete m_contour;
+}
+
+/***************************************************************************/
+/**
+ * This method deletes the summed-area tables built by \ref makeProj2DPlot().
+ * A table takes about 16 bytes per bin of its mesh, so it should only be
+ * kept while bin ranges of the same mesh are projected.
+ */
+void Plotter::clearTables()
+{
+	for (std::map<TH3*, SummedAreaTable*>::iterator it = m_tables.begin(); it != m_tables.end(); ++it)
+		delete it->second;
+	m_tables.clear();
+}
+
 /***************************************************************************/
 /**
  * This method loops on all elements in histogram vector and creates single plots
@@ -211,6 +239,155 @@ void Plotter::makeHistPlots(std::vector<TH1*> hist)
 }
 
 
+/***************************************************************************/
+/**
+ * This method creates a 2D projection plot of a mesh on \a plane, summing
+ * bins \a firstBin to \a lastBin of the third axis. The projection is made
+ * from the coarsest level in \a levels which still has at least \a Pyramid
+ * \a Resolution bins (default 200) on both plotted axes, or one bin per
+ * pixel of the plot frame if the option is 0 (see \ref MeshPyramid::select());
+ * e.g. a 500^3 mesh is plotted from its 250^3 level. A projection of a 
+ * coarser level is scaled by the ratio of numbers of summed bins, so it
+ * approximates the projection of the full mesh. This assumes levels built
+ * with "mean" pooling; sums of maxima of "max" pooling do not approximate
+ * it, so such levels must not be given (see \ref MeshPyramid::read()).
+ * With option \a Summed \a Area \a Table the projection is made from a
+ * \ref SummedAreaTable of the level, built at the first projection and
+ * reused for all further bin ranges until \ref clearTables() is called.
+ * With option \a Contour \a Lines, \a Number \a of \a Contours 
+ * contour lines are extracted from the projection (see \ref ContourExtractor,
+ * one extractor with \a Number \a of \a Threads threads for all plots),
+ * drawn on top of it and written to a text file next to the plot.
+ */
+void Plotter::makeProj2DPlot(std::vector<TH3*> levels, TString plane, int firstBin, int lastBin, double weight)
+{
+	plane.ToUpper();
+	int a1 = (plane.Length() == 2 ? plane[0]-'X' : -1);
+	int a2 = (plane.Length() == 2 ? plane[1]-'X' : -1);
+	if(levels.size() == 0 || a1 < 0 || a1 > 2 || a2 < 0 || a2 > 2 || a1 == a2) {
+		ERROR("Undefined projection plane '"+plane+"'!");
+		return;
+	}
+	int a3 = 3-a1-a2;
+	const char* label[3] = { "x", "y", "z" };
+
+	TCanvas* canvas = new TCanvas("", "", 0, 0, 700, 500);
+	int npx = (int)( canvas->GetWw() * (1. - canvas->GetLeftMargin() - canvas->GetRightMargin()) );
+	int npy = (int)( canvas->GetWh() * (1. - canvas->GetTopMargin() - canvas->GetBottomMargin()) );
+	if(m_pyramidRes > 0)
+		npx = npy = m_pyramidRes;
+	int level = MeshPyramid::select(levels, a1, npx, a2, npy);
+	TH3* hist = levels[level];
+	DEBUG( TString::Format( "Projection of '%s' from level %d", levels[0]->GetName(), level ) );
+
+	// bin range of third axis in the selected level
+	TAxis* axis0 = (a3 == 0 ? levels[0]->GetXaxis() : (a3 == 1 ? levels[0]->GetYaxis() : levels[0]->GetZaxis()));
+	TAxis* axis  = (a3 == 0 ? hist->GetXaxis() : (a3 == 1 ? hist->GetYaxis() : hist->GetZaxis()));
+	int first = axis->FindFixBin( axis0->GetBinCenter(firstBin) );
+	int last  = axis->FindFixBin( axis0->GetBinCenter(lastBin) );
+	TH1* proj = 0;
+	std::vector<int> range[3];
+	range[a3].push_back(first);
+	range[a3].push_back(last);
+	if(m_summedArea) {
+		if(m_tables.find(hist) == m_tables.end())
+			m_tables[hist] = new SummedAreaTable(hist);
+		proj = m_tables[hist]->project( TString(label[a2])+label[a1], range[0], range[1], range[2], TString(hist->GetName())+"_proj" );
+	} else {
+		HistoView view(hist, range[0], range[1], range[2]);
+		proj = view.project( TString(label[a2])+label[a1], TString(hist->GetName())+"_proj" );
+	}
+	if(!proj) {
+		delete canvas;
+		return;
+	}
+	if(level > 0)
+		proj->Scale( (double)(lastBin-firstBin+1)/(last-first+1) );
+	if(weight != 1.)
+		proj->Scale(weight);
+	proj->SetName( TString::Format( "%s_%s_%d_%d", levels[0]->GetName(), plane.Data(), firstBin, lastBin ) );
+
+	makePlot(canvas, proj, m_plotColor, true);
+	std::vector<TGraph*> graphs;
+	if(m_contourLines && dynamic_cast<TH2*>(proj)) {
+		if(!m_contour)
+			m_contour = new ContourExtractor(m_nthreads);
+		ContourExtractor& extractor = *m_contour;
+		std::vector<ContourLine> lines = extractor.contours( (TH2*)proj, ContourExtractor::makeLevels(proj, m_nContour, m_logscale) );
+		for(size_t i = 0; i < lines.size(); ++i) {
+			std::vector<double> x = lines[i].x, y = lines[i].y;
+			if(lines[i].closed) {
+				x.push_back(x[0]);
+				y.push_back(y[0]);
+			}
+			TGraph* graph = new TGraph((int)x.size(), &x[0], &y[0]);
+			graph->SetLineWidth(m_lineWidth);
+			graph->Draw("L same");
+			graphs.push_back(graph);
+		}
+		extractor.writeContours(lines, m_plotDir+"/"+proj->GetName()+"_contours.txt");
+	}
+	TString filename = m_plotDir+"/"+proj->GetName()+"."+m_plotFormat;
+	MESSAGE("Creating "+filename);
+	canvas->SaveAs(filename);
+	delete canvas;
+	for(size_t i = 0; i < graphs.size(); ++i)
+		delete graphs[i];
+	delete proj;
+}
+
+/***************************************************************************/
+/**
+ * This method draws several graphs on the same canvas with a legend, 
+ * using the same colors and axis options as #makeComparisonPlot()
+ */
+void Plotter::makeGraphPlot(std::vector<TGraph*> graph, std::vector<TString> title, TString name)
+{
+	Color color[] = {Blue, Red, Pink, Cyan, Green, Purple, Yellow, DarkGreen, Grey, LightGreen,
+					DarkRed, Brown, Black};
+	if(graph.size() == 0) {
+		WARN("No graph to plot!");
+		return;
+	}
+
+	TCanvas* canvas = new TCanvas("", "", 0, 0, 700, 500);
+	canvas->cd();
+	TMultiGraph* mgraph = new TMultiGraph();
+	TLegend* legend = new TLegend(0.70, 0.90-0.04*graph.size(), 0.93, 0.90);
+	legend->SetBorderSize(0);
+	legend->SetTextSize(0.035);
+	legend->SetFillColor(0);
+
+	int icol = 0;
+	for(size_t i = 0; i < graph.size(); ++i) {
+		graph[i]->SetLineColor(color[icol]);
+		graph[i]->SetMarkerColor(color[icol]);
+		graph[i]->SetLineWidth(m_lineWidth);
+		graph[i]->SetMarkerStyle(m_markerStyle);
+		mgraph->Add(graph[i]);
+		if(title.size() == graph.size())
+			legend->AddEntry( graph[i], title[i], "lp" );
+		else
+			legend->AddEntry( graph[i], graph[i]->GetTitle(), "lp" );
+		if(color[icol] == Black)
+			icol = 0;
+		else
+			++icol;
+	}
+	mgraph->Draw("ALP");
+	mgraph->GetXaxis()->SetTitle(m_titleX);
+	mgraph->GetYaxis()->SetTitle(m_titleY);
+	legend->Draw();
+	if(m_grid)		canvas->SetGrid();
+	if(m_logscale)	gPad->SetLogy();
+	gPad->RedrawAxis();
+
+	TString filename = m_plotDir+"/"+name+"."+m_plotFormat;
+	MESSAGE("Creating "+filename);
+	canvas->SaveAs(filename);
+	delete canvas;
+}
+
 /***************************************************************************/
 /**
  * This method creates all histogram plots from a file 
@@ -256,7 +433,7 @@ void Plotter::exportHist2Text(TH1* hist, TString prefix)
 		for(int k = 0; k < hist->GetNbinsZ(); ++k)
 			for(int j = 0; j < hist->GetNbinsY(); ++j)
 				for(int i = 0; i < hist->GetNbinsX(); ++i)
-					outfile << hist->GetBinContent(i+1,j+1,k+1) << std::endl;
+					outfile << hist->GetBinContent(i+1,j+1,k+1) << '\n';
 		outfile.close();
 	} else
 		ERROR("Unable to open file '"+filename+"'!"); 
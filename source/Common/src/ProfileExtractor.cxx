@@ -0,0 +1,291 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ProfileExtractor.cxx
+ *
+ */
+
+#include "ProfileExtractor.h"
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * The constructor keeps the bin boundaries of the axes of the mesh.
+ */
+ProfileExtractor::ProfileExtractor(TH3* hist, int nthreads) : m_hist(hist), m_nthreads(nthreads), m_pool(nthreads), message("ProfileExtractor")
+{
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a) {
+		for (int i = 1; i <= axis[a]->GetNbins(); ++i)
+			m_edge[a].push_back( axis[a]->GetBinLowEdge(i) );
+		m_edge[a].push_back( axis[a]->GetBinUpEdge(axis[a]->GetNbins()) );
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method checks that \a point has 3 coordinates.
+ */
+bool ProfileExtractor::checkPoint(const std::vector<double>& point, TString what)
+{
+	if (point.size() != 3) {
+		ERROR( TString::Format( "%s needs 3 coordinates (has %d)", what.Data(), (int)point.size() ) );
+		return false;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method finds the voxel containing \a point from the bin boundaries.
+ */
+int ProfileExtractor::findBin(const double* point) const
+{
+	int idx[3];
+	for (int a = 0; a < 3; ++a) {
+		const std::vector<double>& e = m_edge[a];
+		if (point[a] < e.front() || point[a] > e.back())
+			return -1;
+		idx[a] = std::min( (int)( std::upper_bound(e.begin(), e.end(), point[a]) - e.begin() ), (int)e.size()-1 );
+	}
+	return m_hist->GetBin(idx[0], idx[1], idx[2]);
+}
+
+/***************************************************************************/
+/**
+ * This method traces the segment from \a start to \a end through the mesh
+ * (Siddon's method): the segment is clipped to the mesh box, the crossings
+ * with the voxel boundaries of all axes are merged in order of the line
+ * parameter, and the voxel between two crossings is found at their
+ * midpoint.
+ */
+void ProfileExtractor::trace(const double* start, const double* end, Segment& segment) const
+{
+	segment.edge.clear();
+	segment.bin.clear();
+	double d[3] = { end[0]-start[0], end[1]-start[1], end[2]-start[2] };
+	double length = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+	if (length <= 0.)
+		return;
+
+	// clip to mesh box
+	double amin = 0., amax = 1.;
+	for (int a = 0; a < 3; ++a) {
+		const std::vector<double>& e = m_edge[a];
+		if (d[a] != 0.) {
+			double a1 = (e.front() - start[a]) / d[a], a2 = (e.back() - start[a]) / d[a];
+			amin = std::max(amin, std::min(a1, a2));
+			amax = std::min(amax, std::max(a1, a2));
+		} else if (start[a] < e.front() || start[a] > e.back())
+			return;
+	}
+	if (amin >= amax)
+		return;
+
+	// crossings with voxel boundaries
+	std::vector<double> alpha;
+	alpha.push_back(amin);
+	alpha.push_back(amax);
+	for (int a = 0; a < 3; ++a) {
+		if (d[a] == 0.) continue;
+		const std::vector<double>& e = m_edge[a];
+		for (size_t i = 1; i+1 < e.size(); ++i) {
+			double t = (e[i] - start[a]) / d[a];
+			if (t > amin && t < amax)
+				alpha.push_back(t);
+		}
+	}
+	std::sort(alpha.begin(), alpha.end());
+
+	double eps = 1.e-12;
+	segment.edge.push_back(amin*length);
+	for (size_t i = 0; i+1 < alpha.size(); ++i) {
+		if (alpha[i+1] - alpha[i] <= eps) continue;
+		double mid = 0.5*(alpha[i] + alpha[i+1]);
+		double p[3] = { start[0] + mid*d[0], start[1] + mid*d[1], start[2] + mid*d[2] };
+		segment.bin.push_back( findBin(p) );
+		segment.edge.push_back( alpha[i+1]*length );
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method fills the profile of the traced voxels, either with one bin
+ * per voxel or as length-weighted means on \a nbins uniform bins between
+ * the start and end points (parts of the line outside of the mesh count
+ * as zero).
+ */
+TH1D* ProfileExtractor::makeExact(const Segment& segment, double length, TString name, int nbins)
+{
+	TH1D* profile = 0;
+	int nseg = (int)segment.bin.size();
+	if (nbins <= 0) {
+		if (nseg == 0) {
+			WARN("Line of profile '"+name+"' does not cross mesh '"+TString(m_hist->GetName())+"'");
+			profile = new TH1D(name, m_hist->GetTitle(), 1, 0., length);
+		} else {
+			profile = new TH1D(name, m_hist->GetTitle(), nseg, &segment.edge[0]);
+			for (int i = 0; i < nseg; ++i) {
+				profile->SetBinContent(i+1, m_hist->GetBinContent(segment.bin[i]));
+				profile->SetBinError  (i+1, m_hist->GetBinError  (segment.bin[i]));
+			}
+		}
+	} else {
+		profile = new TH1D(name, m_hist->GetTitle(), nbins, 0., length);
+		std::vector<double> sum(nbins, 0.), sum2(nbins, 0.);
+		double width = length/nbins;
+		for (int i = 0; i < nseg; ++i) {
+			double s0 = segment.edge[i], s1 = segment.edge[i+1];
+			double value = m_hist->GetBinContent(segment.bin[i]), error = m_hist->GetBinError(segment.bin[i]);
+			int b1 = std::min( (int)(s1/width), nbins-1 );
+			for (int b = std::min( (int)(s0/width), nbins-1 ); b <= b1; ++b) {
+				double w = (std::min(s1, (b+1)*width) - std::max(s0, b*width)) / width;
+				if (w <= 0.) continue;
+				sum[b]  += w*value;
+				sum2[b] += w*w*error*error;
+			}
+		}
+		for (int b = 0; b < nbins; ++b) {
+			profile->SetBinContent(b+1, sum[b]);
+			profile->SetBinError  (b+1, std::sqrt(sum2[b]));
+		}
+	}
+	profile->GetXaxis()->SetTitle("Distance");
+	return profile;
+}
+
+/***************************************************************************/
+/**
+ * This method makes the profile along one line.
+ */
+TH1D* ProfileExtractor::line(std::vector<double> start, std::vector<double> end, TString name, int nbins, bool interpolate)
+{
+	return lines( std::vector< std::vector<double> >(1, start), std::vector< std::vector<double> >(1, end),
+			std::vector<TString>(1, name), nbins, interpolate )[0];
+}
+
+/***************************************************************************/
+/**
+ * This method makes the profiles along many lines: exact profiles are
+ * traced in parallel (histograms are created afterwards by the calling
+ * thread), interpolated profiles (100 bins if \a nbins is 0) are sampled
+ * as one batch of points of all lines.
+ */
+std::vector<TH1D*> ProfileExtractor::lines(std::vector< std::vector<double> > start, std::vector< std::vector<double> > end, std::vector<TString> name,
+		int nbins, bool interpolate)
+{
+	int nlines = (int)start.size();
+	std::vector<TH1D*> profile(nlines, (TH1D*)0);
+	if (end.size() != start.size() || name.size() != start.size()) {
+		ERROR("Different numbers of start points, end points and names of profiles!");
+		return profile;
+	}
+	std::vector<bool> valid(nlines);
+	std::vector<double> length(nlines, 0.);
+	for (int i = 0; i < nlines; ++i) {
+		valid[i] = checkPoint(start[i], "Start point of '"+name[i]+"'") && checkPoint(end[i], "End point of '"+name[i]+"'");
+		if (!valid[i]) continue;
+		for (int a = 0; a < 3; ++a)
+			length[i] += (end[i][a]-start[i][a])*(end[i][a]-start[i][a]);
+		length[i] = std::sqrt(length[i]);
+		if (length[i] <= 0.) {
+			ERROR("Start and end points of '"+name[i]+"' are the same!");
+			valid[i] = false;
+		}
+	}
+
+	if (!interpolate) {
+		std::vector<Segment> segment(nlines);
+		m_pool.parallelFor(0, nlines, [&](int first, int last) {
+			for (int i = first; i < last; ++i)
+				if (valid[i])
+					trace(&start[i][0], &end[i][0], segment[i]);
+		}, 1);
+		for (int i = 0; i < nlines; ++i)
+			if (valid[i])
+				profile[i] = makeExact(segment[i], length[i], name[i], nbins);
+		return profile;
+	}
+
+	if (nbins <= 0)
+		nbins = 100;
+	std::vector<double> x, y, z, value, error;
+	for (int i = 0; i < nlines; ++i) {
+		if (!valid[i]) continue;
+		for (int b = 0; b < nbins; ++b) {
+			double t = (b+0.5)/nbins;
+			x.push_back( start[i][0] + t*(end[i][0]-start[i][0]) );
+			y.push_back( start[i][1] + t*(end[i][1]-start[i][1]) );
+			z.push_back( start[i][2] + t*(end[i][2]-start[i][2]) );
+		}
+	}
+	MeshSampler sampler(m_hist, m_nthreads);
+	sampler.sample(x, y, z, value, error);
+	int p = 0;
+	for (int i = 0; i < nlines; ++i) {
+		if (!valid[i]) continue;
+		profile[i] = new TH1D(name[i], m_hist->GetTitle(), nbins, 0., length[i]);
+		for (int b = 0; b < nbins; ++b, ++p) {
+			profile[i]->SetBinContent(b+1, value[p]);
+			profile[i]->SetBinError  (b+1, error[p]);
+		}
+		profile[i]->GetXaxis()->SetTitle("Distance");
+	}
+	return profile;
+}
+
+/***************************************************************************/
+/**
+ * This method samples the plane at the centers of a \a nu x \a nv grid
+ * between the origin and the vectors \a u and \a v. The axes of the
+ * histogram are the distances along \a u and \a v.
+ */
+TH2D* ProfileExtractor::plane(std::vector<double> origin, std::vector<double> u, std::vector<double> v, int nu, int nv, TString name, bool interpolate)
+{
+	if (!checkPoint(origin, "Origin of plane") || !checkPoint(u, "Vector u of plane") || !checkPoint(v, "Vector v of plane"))
+		return 0;
+	double lu = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+	double lv = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+	if (lu <= 0. || lv <= 0. || nu <= 0 || nv <= 0) {
+		ERROR("Plane '"+name+"' needs non-zero vectors and numbers of bins!");
+		return 0;
+	}
+
+	std::vector<double> x(nu*nv), y(nu*nv), z(nu*nv), value, error;
+	for (int j = 0; j < nv; ++j)
+		for (int i = 0; i < nu; ++i) {
+			double s = (i+0.5)/nu, t = (j+0.5)/nv;
+			int p = i + j*nu;
+			x[p] = origin[0] + s*u[0] + t*v[0];
+			y[p] = origin[1] + s*u[1] + t*v[1];
+			z[p] = origin[2] + s*u[2] + t*v[2];
+		}
+	if (interpolate) {
+		MeshSampler sampler(m_hist, m_nthreads);
+		sampler.sample(x, y, z, value, error);
+	} else {
+		value.assign(nu*nv, 0.);
+		error.assign(nu*nv, 0.);
+		for (int p = 0; p < nu*nv; ++p) {
+			double point[3] = { x[p], y[p], z[p] };
+			int bin = findBin(point);
+			if (bin < 0) continue;
+			value[p] = m_hist->GetBinContent(bin);
+			error[p] = m_hist->GetBinError(bin);
+		}
+	}
+
+	TH2D* cut = new TH2D(name, m_hist->GetTitle(), nu, 0., lu, nv, 0., lv);
+	for (int j = 0; j < nv; ++j)
+		for (int i = 0; i < nu; ++i) {
+			int bin = cut->GetBin(i+1, j+1);
+			cut->SetBinContent(bin, value[i + j*nu]);
+			cut->SetBinError  (bin, error[i + j*nu]);
+		}
+	cut->GetXaxis()->SetTitle("Distance along u");
+	cut->GetYaxis()->SetTitle("Distance along v");
+	return cut;
+}
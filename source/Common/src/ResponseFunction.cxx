@@ -0,0 +1,109 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ResponseFunction.cxx
+ *
+ */
+
+#include "ResponseFunction.h"
+#include "StringParser.h"
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This method reads the first two numbers of each line of the file as
+ * energy and factor; other lines are skipped.
+ */
+bool ResponseFunction::read(TString filename)
+{
+	std::ifstream file(filename.Data());
+	if (!file.is_open()) {
+		ERROR("Unable to open file '"+filename+"'!");
+		return false;
+	}
+	StringParser parser;
+	std::vector<double> energy, factor;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.find('#') != std::string::npos)
+			line = line.substr(0, line.find('#'));
+		std::vector<double> values = parser.getDouble(line);
+		if (values.size() < 2) continue;
+		energy.push_back(values[0]);
+		factor.push_back(values[1]);
+	}
+	file.close();
+	if (!set(energy, factor)) {
+		ERROR("No valid response curve in file '"+filename+"'!");
+		return false;
+	}
+	INFO( TString::Format( "Read %d response factors from '%s'", getSize(), filename.Data() ) );
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method checks and keeps the response curve.
+ */
+bool ResponseFunction::set(std::vector<double> energy, std::vector<double> factor)
+{
+	if (energy.size() == 0 || energy.size() != factor.size()) {
+		ERROR("Response curve needs the same (non-zero) numbers of energies and factors!");
+		return false;
+	}
+	for (size_t i = 1; i < energy.size(); ++i)
+		if (energy[i] <= energy[i-1]) {
+			ERROR( TString::Format( "Energies of response curve are not increasing at point %d", (int)i+1 ) );
+			return false;
+		}
+	m_energy = energy;
+	m_factor = factor;
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method interpolates the response curve log-log between the
+ * tabulated points around \a energy, or linearly if one of the energies
+ * or factors is not positive.
+ */
+double ResponseFunction::eval(double energy) const
+{
+	if (m_energy.size() == 0)
+		return 0.;
+	if (energy <= m_energy.front())
+		return m_factor.front();
+	if (energy >= m_energy.back())
+		return m_factor.back();
+	int i = (int)( std::upper_bound(m_energy.begin(), m_energy.end(), energy) - m_energy.begin() ) - 1;
+	double e1 = m_energy[i], e2 = m_energy[i+1];
+	double f1 = m_factor[i], f2 = m_factor[i+1];
+	if (e1 > 0. && f1 > 0. && f2 > 0.)
+		return f1 * std::exp( std::log(f2/f1) * std::log(energy/e1) / std::log(e2/e1) );
+	return f1 + (f2 - f1) * (energy - e1) / (e2 - e1);
+}
+
+/***************************************************************************/
+/**
+ * This method evaluates the response at the center of each energy bin,
+ * the geometric center \f$ \sqrt{E_{low} E_{up}} \f$ if the lower edge
+ * is positive. Bins outside of the tabulated energies are reported.
+ */
+std::vector<double> ResponseFunction::getFactors(const std::vector<double>& edge)
+{
+	std::vector<double> factor;
+	int noutside = 0;
+	for (size_t i = 0; i+1 < edge.size(); ++i) {
+		double center = (edge[i] > 0. ? std::sqrt(edge[i]*edge[i+1]) : 0.5*(edge[i]+edge[i+1]));
+		if (m_energy.size() > 0 && (center < m_energy.front() || center > m_energy.back()))
+			++noutside;
+		factor.push_back( eval(center) );
+	}
+	if (noutside > 0)
+		WARN( TString::Format( "%d energy bins outside of response curve, use factors of its end points", noutside ) );
+	return factor;
+}
@@ -0,0 +1,602 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     SparseMesh.cxx
+ *
+ */
+
+#include "SparseMesh.h"
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This is constructor of SparseMesh class, it initializes an empty mesh.
+ */
+SparseMesh::SparseMesh(int nthreads) : m_block(8), m_nthreads(nthreads), m_pool(0), message("SparseMesh")
+{
+	for (int i = 0; i < 3; ++i) {
+		m_nbin[i] = 0; m_nblock[i] = 0;
+	}
+}
+
+/***************************************************************************/
+/**
+ * The destructor stops the threads of the mesh operations.
+ */
+SparseMesh::~SparseMesh()
+{
+	delete m_pool;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the number of threads; the threads of the previous
+ * number are stopped.
+ */
+void SparseMesh::setThreads(int nthreads)
+{
+	if (m_pool && nthreads != m_nthreads) {
+		delete m_pool;
+		m_pool = 0;
+	}
+	m_nthreads = nthreads;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the thread pool of the mesh operations. It is
+ * started at the first operation, so meshes which are only filled (e.g.
+ * by \ref MeshTallyReader) do not keep idle threads, and it is reused by
+ * all further operations.
+ */
+ThreadPool& SparseMesh::getPool()
+{
+	if (!m_pool)
+		m_pool = new ThreadPool(m_nthreads);
+	return *m_pool;
+}
+
+/***************************************************************************/
+/**
+ * This method creates a new mesh with all blocks empty (none allocated).
+ */
+bool SparseMesh::create(TString name, TString title, const std::vector<double>& xedge, const std::vector<double>& yedge, const std::vector<double>& zedge,
+                        int block)
+{
+	if (xedge.size() < 2 || yedge.size() < 2 || zedge.size() < 2 || block < 1) {
+		ERROR("Cannot create mesh '"+name+"', invalid binning or block size");
+		return false;
+	}
+	m_name  = name;
+	m_title = title;
+	m_edge[0] = xedge; m_edge[1] = yedge; m_edge[2] = zedge;
+	m_block = block;
+	setup();
+	DEBUG( TString::Format( "Created sparse mesh '%s' of %d x %d x %d bins, %d x %d x %d blocks", name.Data(), m_nbin[0], m_nbin[1], m_nbin[2], m_nblock[0], m_nblock[1], m_nblock[2] ) );
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method creates a new mesh with the binning of \a hist and copies
+ * the blocks of \a hist which have a non-zero value or error. The blocks
+ * are scanned in parallel.
+ */
+bool SparseMesh::create(TH3* hist, TString name, int block)
+{
+	if (!hist)
+		return false;
+	std::vector<double> edge[3];
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a) {
+		for (int i = 1; i <= axis[a]->GetNbins(); ++i)
+			edge[a].push_back( axis[a]->GetBinLowEdge(i) );
+		edge[a].push_back( axis[a]->GetBinUpEdge(axis[a]->GetNbins()) );
+	}
+	if (name == "")
+		name = hist->GetName();
+	if (!create(name, hist->GetTitle(), edge[0], edge[1], edge[2], block))
+		return false;
+
+	if (TArrayF* array = dynamic_cast<TArrayF*>(hist))
+		fillKernel<float>(hist, array->GetArray());
+	else if (TArrayD* array = dynamic_cast<TArrayD*>(hist))
+		fillKernel<double>(hist, array->GetArray());
+	else {
+		ERROR( TString::Format( "Histogram '%s' has no float or double bins", hist->GetName() ) );
+		return false;
+	}
+	DEBUG( TString::Format( "Mesh '%s' uses %d of %d blocks", m_name.Data(), getNfilled(), getNblocks() ) );
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This is the copy kernel of \ref create(TH3*, TString, int): each block
+ * is allocated at its first non-zero bin. Without error array, the squared
+ * errors are the absolute bin values (as in ROOT).
+ */
+template<class T> void SparseMesh::fillKernel(TH3* hist, const T* array)
+{
+	const double* error2 = (hist->GetSumw2N() ? hist->GetSumw2()->GetArray() : 0);
+	int nx = m_nbin[0]+2, nxy = (m_nbin[0]+2)*(m_nbin[1]+2);
+	ThreadPool& pool = getPool();
+	pool.parallelFor(0, (int)m_blocks.size(), [&](int first, int last) {
+		int lo[3], hi[3];
+		for (int k = first; k < last; ++k) {
+			getRange(k, lo, hi);
+			Block& block = m_blocks[k];
+			for (int iz = lo[2]; iz < hi[2]; ++iz)
+				for (int iy = lo[1]; iy < hi[1]; ++iy)
+					for (int ix = lo[0]; ix < hi[0]; ++ix) {
+						int bin = (ix+1) + nx*(iy+1) + nxy*(iz+1);
+						double value = array[bin];
+						double e2 = (error2 ? error2[bin] : std::fabs(value));
+						if (value == 0. && e2 == 0.)
+							continue;
+						allocate(block);
+						int pos = (ix-lo[0]) + m_block*( (iy-lo[1]) + m_block*(iz-lo[2]) );
+						block.value[pos] = (float)value;
+						block.error[pos] = (float)e2;
+					}
+		}
+	});
+}
+
+/***************************************************************************/
+/**
+ * This method reads the mesh \a name stored in \a dir by \ref write().
+ */
+bool SparseMesh::open(TDirectory* dir, TString name)
+{
+	TDirectory* sub = (dir ? dir->GetDirectory(name) : 0);
+	TArrayD* x     = (sub ? (TArrayD*)sub->GetObjectChecked("xedge", "TArrayD") : 0);
+	TArrayD* y     = (sub ? (TArrayD*)sub->GetObjectChecked("yedge", "TArrayD") : 0);
+	TArrayD* z     = (sub ? (TArrayD*)sub->GetObjectChecked("zedge", "TArrayD") : 0);
+	TArrayI* block = (sub ? (TArrayI*)sub->GetObjectChecked("block", "TArrayI") : 0);
+	TArrayI* index = (sub ? (TArrayI*)sub->GetObjectChecked("index", "TArrayI") : 0);
+	TArrayF* value = (sub ? (TArrayF*)sub->GetObjectChecked("value", "TArrayF") : 0);
+	TArrayF* error = (sub ? (TArrayF*)sub->GetObjectChecked("error", "TArrayF") : 0);
+	bool found = (x && y && z && block && index && value && error);
+	if (found) {
+		TNamed* info = (TNamed*)sub->Get("info");
+		found = create(name, (info ? info->GetTitle() : ""), std::vector<double>(x->GetArray(), x->GetArray()+x->GetSize()),
+		               std::vector<double>(y->GetArray(), y->GetArray()+y->GetSize()),
+		               std::vector<double>(z->GetArray(), z->GetArray()+z->GetSize()), block->At(0));
+		delete info;
+	}
+	int size = m_block*m_block*m_block;
+	if (found && (value->GetSize() != index->GetSize()*size || error->GetSize() != value->GetSize())) {
+		ERROR("Blocks of mesh '"+name+"' are incomplete");
+		found = false;
+	}
+	if (found) {
+		for (int i = 0; i < index->GetSize(); ++i) {
+			int k = index->At(i);
+			if (k < 0 || k >= (int)m_blocks.size()) continue;
+			m_blocks[k].value.assign(value->GetArray() + i*size, value->GetArray() + (i+1)*size);
+			m_blocks[k].error.assign(error->GetArray() + i*size, error->GetArray() + (i+1)*size);
+		}
+	} else if (!x || !y || !z || !block || !index || !value || !error)
+		ERROR("Cannot find mesh '"+name+"'");
+	delete x; delete y; delete z; delete block; delete index; delete value; delete error;
+	return found;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the mesh to the sub-directory with its name in
+ * \a dir: title, bin boundaries, block size, the indices of the allocated
+ * blocks and their values and squared errors (one array each, block after
+ * block). An existing mesh with the same name is replaced.
+ */
+bool SparseMesh::write(TDirectory* dir)
+{
+	TDirectory* sub = (dir ? dir->mkdir(m_name, m_title, true) : 0);
+	if (!sub) {
+		ERROR("Cannot create directory '"+m_name+"'");
+		return false;
+	}
+	sub->Delete("*;*");
+	int nfilled = getNfilled(), size = m_block*m_block*m_block;
+	TArrayI index(nfilled);
+	TArrayF value(nfilled*size), error(nfilled*size);
+	for (int k = 0, i = 0; k < (int)m_blocks.size(); ++k) {
+		if (m_blocks[k].value.empty()) continue;
+		index.GetArray()[i] = k;
+		std::copy(m_blocks[k].value.begin(), m_blocks[k].value.end(), value.GetArray() + i*size);
+		std::copy(m_blocks[k].error.begin(), m_blocks[k].error.end(), error.GetArray() + i*size);
+		++i;
+	}
+	TArrayD x((int)m_edge[0].size(), &m_edge[0][0]), y((int)m_edge[1].size(), &m_edge[1][0]), z((int)m_edge[2].size(), &m_edge[2][0]);
+	TArrayI block(1, &m_block);
+	TNamed info(m_name, m_title);
+	sub->WriteObjectAny(&x, "TArrayD", "xedge", "WriteDelete");
+	sub->WriteObjectAny(&y, "TArrayD", "yedge", "WriteDelete");
+	sub->WriteObjectAny(&z, "TArrayD", "zedge", "WriteDelete");
+	sub->WriteObjectAny(&block, "TArrayI", "block", "WriteDelete");
+	sub->WriteObjectAny(&index, "TArrayI", "index", "WriteDelete");
+	sub->WriteObjectAny(&value, "TArrayF", "value", "WriteDelete");
+	sub->WriteObjectAny(&error, "TArrayF", "error", "WriteDelete");
+	sub->WriteTObject(&info, "info", "WriteDelete");
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method computes the number of bins and blocks on each axis and
+ * resets all blocks to empty.
+ */
+void SparseMesh::setup()
+{
+	for (int i = 0; i < 3; ++i) {
+		m_nbin[i]   = (int)m_edge[i].size()-1;
+		m_nblock[i] = (m_nbin[i] + m_block - 1) / m_block;
+	}
+	m_blocks.clear();
+	m_blocks.resize( (size_t)m_nblock[0]*m_nblock[1]*m_nblock[2] );
+}
+
+/***************************************************************************/
+/**
+ * This method gives the range of bins (from 0, \a hi excluded) on each
+ * axis which are covered by block \a index.
+ */
+void SparseMesh::getRange(int index, int* lo, int* hi) const
+{
+	int b[3] = { index % m_nblock[0], (index / m_nblock[0]) % m_nblock[1], index / (m_nblock[0]*m_nblock[1]) };
+	for (int i = 0; i < 3; ++i) {
+		lo[i] = b[i]*m_block;
+		hi[i] = std::min(lo[i] + m_block, m_nbin[i]);
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method returns the index of the block of bin (\a ix, \a iy, \a iz)
+ * and the position \a pos of the bin in the block.
+ */
+int SparseMesh::locate(int ix, int iy, int iz, int& pos) const
+{
+	if (ix < 1 || ix > m_nbin[0] || iy < 1 || iy > m_nbin[1] || iz < 1 || iz > m_nbin[2])
+		return -1;
+	--ix; --iy; --iz;
+	pos = ix % m_block + m_block*( iy % m_block + m_block*(iz % m_block) );
+	return ix / m_block + m_nblock[0]*( iy / m_block + m_nblock[1]*(iz / m_block) );
+}
+
+/***************************************************************************/
+/**
+ * This method allocates the bins of an empty block, filled with zeros.
+ */
+void SparseMesh::allocate(Block& block)
+{
+	if (!block.value.empty())
+		return;
+	int size = m_block*m_block*m_block;
+	block.value.assign(size, 0.f);
+	block.error.assign(size, 0.f);
+}
+
+/***************************************************************************/
+/**
+ * This method returns the number of allocated blocks.
+ */
+int SparseMesh::getNfilled() const
+{
+	int n = 0;
+	for (size_t k = 0; k < m_blocks.size(); ++k)
+		if (!m_blocks[k].value.empty())
+			++n;
+	return n;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the value of bin (\a ix, \a iy, \a iz), zero in an
+ * empty block.
+ */
+double SparseMesh::getBinContent(int ix, int iy, int iz) const
+{
+	int pos, k = locate(ix, iy, iz, pos);
+	if (k < 0 || m_blocks[k].value.empty())
+		return 0.;
+	return m_blocks[k].value[pos];
+}
+
+/***************************************************************************/
+/**
+ * This method returns the error of bin (\a ix, \a iy, \a iz), zero in an
+ * empty block.
+ */
+double SparseMesh::getBinError(int ix, int iy, int iz) const
+{
+	int pos, k = locate(ix, iy, iz, pos);
+	if (k < 0 || m_blocks[k].error.empty())
+		return 0.;
+	return std::sqrt( m_blocks[k].error[pos] );
+}
+
+/***************************************************************************/
+/**
+ * This method sets the value of bin (\a ix, \a iy, \a iz), its block is
+ * allocated by the first non-zero value.
+ */
+void SparseMesh::setBinContent(int ix, int iy, int iz, double value)
+{
+	int pos, k = locate(ix, iy, iz, pos);
+	if (k < 0 || (value == 0. && m_blocks[k].value.empty()))
+		return;
+	allocate(m_blocks[k]);
+	m_blocks[k].value[pos] = (float)value;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the error of bin (\a ix, \a iy, \a iz), its block is
+ * allocated by the first non-zero error.
+ */
+void SparseMesh::setBinError(int ix, int iy, int iz, double error)
+{
+	int pos, k = locate(ix, iy, iz, pos);
+	if (k < 0 || (error == 0. && m_blocks[k].error.empty()))
+		return;
+	allocate(m_blocks[k]);
+	m_blocks[k].error[pos] = (float)(error*error);
+}
+
+/***************************************************************************/
+/**
+ * This method checks that mesh \a other has the same bins and blocks.
+ */
+bool SparseMesh::checkBinning(const SparseMesh& other, TString what)
+{
+	for (int i = 0; i < 3; ++i)
+		if (other.m_nbin[i] != m_nbin[i] || other.m_block != m_block) {
+			ERROR( TString::Format( "Binning of mesh '%s' is different from mesh '%s', cannot %s", other.m_name.Data(), m_name.Data(), what.Data() ) );
+			return false;
+		}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method adds \a weight times the mesh \a other to this mesh. Only
+ * the allocated blocks of \a other are visited; a block of this mesh is
+ * allocated when it gets a block of \a other.
+ */
+bool SparseMesh::add(const SparseMesh& other, double weight)
+{
+	if (!checkBinning(other, "add it"))
+		return false;
+	double w2 = weight*weight;
+	ThreadPool& pool = getPool();
+	pool.parallelFor(0, (int)m_blocks.size(), [&](int first, int last) {
+		for (int k = first; k < last; ++k) {
+			const Block& in = other.m_blocks[k];
+			if (in.value.empty()) continue;
+			Block& out = m_blocks[k];
+			allocate(out);
+			for (size_t j = 0; j < in.value.size(); ++j) {
+				out.value[j] += (float)(weight*in.value[j]);
+				out.error[j] += (float)(w2*in.error[j]);
+			}
+		}
+	});
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method creates mesh \a out with the ratio of this mesh to mesh
+ * \a den and its error from the errors of both meshes. As in
+ * \ref MeshKernels::ratio(), bins with zero denominator are zero, so only
+ * the blocks allocated in both meshes are computed; blocks whose ratios
+ * are all zero are not kept.
+ */
+bool SparseMesh::makeRatio(const SparseMesh& den, SparseMesh& out, TString name)
+{
+	if (!checkBinning(den, "divide by it"))
+		return false;
+	if (!out.create(name, m_title+" / "+den.m_title, m_edge[0], m_edge[1], m_edge[2], m_block))
+		return false;
+	ThreadPool& pool = getPool();
+	pool.parallelFor(0, (int)m_blocks.size(), [&](int first, int last) {
+		for (int k = first; k < last; ++k) {
+			const Block& a = m_blocks[k];
+			const Block& b = den.m_blocks[k];
+			if (a.value.empty() || b.value.empty()) continue;
+			Block& r = out.m_blocks[k];
+			out.allocate(r);
+			bool filled = false;
+			for (size_t j = 0; j < a.value.size(); ++j) {
+				if (b.value[j] == 0.f) continue;
+				double inv = 1./b.value[j], inv2 = inv*inv;
+				r.value[j] = (float)( a.value[j]*inv );
+				r.error[j] = (float)( ( a.error[j]*b.value[j]*b.value[j] + b.error[j]*a.value[j]*a.value[j] ) * inv2*inv2 );
+				filled = filled || r.value[j] != 0.f || r.error[j] != 0.f;
+			}
+			if (!filled)
+				r = Block();
+		}
+	});
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method releases the allocated blocks which hold only zeros (e.g.
+ * after setting zero values in them).
+ */
+int SparseMesh::compact()
+{
+	int n = 0;
+	for (size_t k = 0; k < m_blocks.size(); ++k) {
+		Block& block = m_blocks[k];
+		if (block.value.empty()) continue;
+		bool filled = false;
+		for (size_t j = 0; j < block.value.size() && !filled; ++j)
+			filled = (block.value[j] != 0.f || block.error[j] != 0.f);
+		if (!filled) {
+			block = Block();
+			++n;
+		}
+	}
+	return n;
+}
+
+/***************************************************************************/
+/**
+ * This method creates a TH3F histogram with the whole mesh, the allocated
+ * blocks are copied in parallel.
+ */
+TH3F* SparseMesh::toHisto(TString name)
+{
+	if (name == "")
+		name = m_name;
+	TH3F* hist = new TH3F(name, m_title, m_nbin[0], &m_edge[0][0], m_nbin[1], &m_edge[1][0], m_nbin[2], &m_edge[2][0]);
+	hist->Sumw2();
+	float* value = hist->GetArray();
+	double* error = hist->GetSumw2()->GetArray();
+	int nx = m_nbin[0]+2, nxy = (m_nbin[0]+2)*(m_nbin[1]+2);
+	ThreadPool& pool = getPool();
+	pool.parallelFor(0, (int)m_blocks.size(), [&](int first, int last) {
+		int lo[3], hi[3];
+		for (int k = first; k < last; ++k) {
+			const Block& block = m_blocks[k];
+			if (block.value.empty()) continue;
+			getRange(k, lo, hi);
+			for (int iz = lo[2]; iz < hi[2]; ++iz)
+				for (int iy = lo[1]; iy < hi[1]; ++iy)
+					for (int ix = lo[0]; ix < hi[0]; ++ix) {
+						int pos = (ix-lo[0]) + m_block*( (iy-lo[1]) + m_block*(iz-lo[2]) );
+						int bin = (ix+1) + nx*(iy+1) + nxy*(iz+1);
+						value[bin] = block.value[pos];
+						error[bin] = block.error[pos];
+					}
+		}
+	});
+	hist->SetEntries( (double)m_nbin[0]*m_nbin[1]*m_nbin[2] );
+	return hist;
+}
+
+/***************************************************************************/
+/**
+ * This method sets default values (first and last bin) of a bin range and
+ * limits it to the mesh.
+ */
+void SparseMesh::checkRange(std::vector<int>& range, int axis)
+{
+	if (range.size() < 1) range.push_back(1);
+	if (range.size() < 2) range.push_back(m_nbin[axis]);
+	range[0] = std::max(range[0], 1);
+	range[1] = std::min(range[1], m_nbin[axis]);
+}
+
+/***************************************************************************/
+/**
+ * This method creates a 1- or 2-dimension projection of the mesh in the
+ * given bin ranges, with the same options as \ref MeshStore::makeProjection().
+ * Only the allocated blocks overlapping the ranges are visited; they are
+ * split in one chunk per thread, each summed into its own partial
+ * projection, and the partial projections are added in chunk order so
+ * the result does not depend on the scheduling.
+ */
+TH1* SparseMesh::makeProjection(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, double weight)
+{
+	std::vector<int> range[3] = { rangeX, rangeY, rangeZ };
+	for (int i = 0; i < 3; ++i)
+		checkRange(range[i], i);
+
+	// axes of projection histogram (first one is the horizontal axis)
+	option.ToLower();
+	std::vector<int> axes;
+	for (int i = option.Length()-1; i >= 0; --i) {
+		int a = option[i]-'x';
+		if (a >= 0 && a < 3 && std::find(axes.begin(), axes.end(), a) == axes.end())
+			axes.push_back(a);
+	}
+	if (axes.size() < 1 || axes.size() > 2) {
+		ERROR("Undefined projection axis or plane!");
+		return 0;
+	}
+	const char* label[3] = { "x", "y", "z" };
+	TString name = m_name+"_p";
+	for (int i = (int)axes.size()-1; i >= 0; --i)
+		name += label[axes[i]];
+
+	// allocated blocks overlapping the ranges
+	std::vector<int> list;
+	for (int k = 0; k < (int)m_blocks.size(); ++k) {
+		if (m_blocks[k].value.empty()) continue;
+		int lo[3], hi[3];
+		getRange(k, lo, hi);
+		bool overlap = true;
+		for (int i = 0; i < 3; ++i)
+			overlap = overlap && lo[i] <= range[i][1]-1 && hi[i] > range[i][0]-1;
+		if (overlap)
+			list.push_back(k);
+	}
+
+	// accumulate partial projections, one per chunk of blocks
+	int n0 = m_nbin[axes[0]], n1 = (axes.size() > 1 ? m_nbin[axes[1]] : 1);
+	ThreadPool& pool = getPool();
+	int nlist = (int)list.size();
+	int chunk = std::max( (nlist + pool.size() - 1) / pool.size(), 1 );
+	int npart = (nlist + chunk - 1) / chunk;
+	std::vector< std::vector<double> > psum(npart), perr2(npart);
+	pool.parallelFor(0, nlist, [&](int first, int last) {
+		std::vector<double>& sum = psum[first/chunk];
+		std::vector<double>& err2 = perr2[first/chunk];
+		sum.assign(n0*n1, 0.);
+		err2.assign(n0*n1, 0.);
+		int lo[3], hi[3], b[3];
+		for (int i = first; i < last; ++i) {
+			const Block& block = m_blocks[list[i]];
+			getRange(list[i], lo, hi);
+			int start[3] = { lo[0], lo[1], lo[2] };
+			for (int a = 0; a < 3; ++a) {
+				lo[a] = std::max(lo[a], range[a][0]-1);
+				hi[a] = std::min(hi[a], range[a][1]);
+			}
+			for (b[2] = lo[2]; b[2] < hi[2]; ++b[2])
+				for (b[1] = lo[1]; b[1] < hi[1]; ++b[1])
+					for (b[0] = lo[0]; b[0] < hi[0]; ++b[0]) {
+						int pos = (b[0]-start[0]) + m_block*( (b[1]-start[1]) + m_block*(b[2]-start[2]) );
+						int k = b[axes[0]] + n0*( axes.size() > 1 ? b[axes[1]] : 0 );
+						sum[k]  += block.value[pos];
+						err2[k] += block.error[pos];
+					}
+		}
+	}, chunk);
+	std::vector<double> sum(n0*n1, 0.), err2(n0*n1, 0.);
+	for (int p = 0; p < npart; ++p)
+		for (int k = 0; k < n0*n1; ++k) {
+			sum[k]  += psum[p][k];
+			err2[k] += perr2[p][k];
+		}
+
+	// create projection histogram
+	TH1* proj = 0;
+	if (axes.size() == 1)
+		proj = new TH1D(name, m_title, n0, &m_edge[axes[0]][0]);
+	else
+		proj = new TH2D(name, m_title, n0, &m_edge[axes[0]][0], n1, &m_edge[axes[1]][0]);
+	proj->Sumw2();
+	double total = 0.;
+	for (int j = 0; j < n1; ++j)
+		for (int i = 0; i < n0; ++i) {
+			int bin = (axes.size() > 1 ? proj->GetBin(i+1, j+1) : i+1);
+			proj->SetBinContent(bin, sum[i+n0*j]);
+			proj->SetBinError(bin, std::sqrt(err2[i+n0*j]));
+			total += sum[i+n0*j];
+		}
+	if (weight < 0 && total != 0.)
+		proj->Scale(1./total);
+	else if (weight >= 0 && weight != 1.)
+		proj->Scale(weight);
+	return proj;
+}
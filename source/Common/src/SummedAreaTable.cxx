@@ -0,0 +1,137 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     SummedAreaTable.cxx
+ *
+ */
+
+#include "SummedAreaTable.h"
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * The constructor copies values and squared errors of \a hist in the
+ * tables (with a zero plane at index 0 of each axis) and accumulates them
+ * with one pass along each axis. Without error array the squared errors
+ * are the bin values, as in \a TH1::Sumw2().
+ */
+SummedAreaTable::SummedAreaTable(TH3* hist) : m_name(hist->GetName()), m_title(hist->GetTitle()), m_entries(hist->GetEntries()), message("SummedAreaTable")
+{
+	const TAxis* axis[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for (int a = 0; a < 3; ++a) {
+		m_n[a] = axis[a]->GetNbins();
+		for (int i = 1; i <= m_n[a]; ++i)
+			m_edge[a].push_back( axis[a]->GetBinLowEdge(i) );
+		m_edge[a].push_back( axis[a]->GetBinUpEdge(m_n[a]) );
+		m_axisTitle[a] = axis[a]->GetTitle();
+	}
+	int size = (m_n[0]+1)*(m_n[1]+1)*(m_n[2]+1);
+	m_value.assign(size, 0.);
+	m_error.assign(size, 0.);
+
+	bool hasErrors = (hist->GetSumw2N() > 0);
+	const double* error = (hasErrors ? hist->GetSumw2()->GetArray() : 0);
+	for (int k = 1; k <= m_n[2]; ++k)
+	for (int j = 1; j <= m_n[1]; ++j)
+	for (int i = 1; i <= m_n[0]; ++i) {
+		int bin = hist->GetBin(i, j, k);
+		double v = hist->GetBinContent(bin);
+		m_value[index(i,j,k)] = v;
+		m_error[index(i,j,k)] = (hasErrors ? error[bin] : std::max(v, 0.));
+	}
+
+	// prefix sums along x, y and z
+	int stride[3] = { 1, m_n[0]+1, (m_n[0]+1)*(m_n[1]+1) };
+	for (int a = 0; a < 3; ++a)
+		for (int k = 1; k <= m_n[2]; ++k)
+		for (int j = 1; j <= m_n[1]; ++j)
+		for (int i = 1; i <= m_n[0]; ++i) {
+			int idx = index(i,j,k);
+			int bin[3] = { i, j, k };
+			if (bin[a] == 1)
+				continue;
+			m_value[idx] += m_value[idx-stride[a]];
+			m_error[idx] += m_error[idx-stride[a]];
+		}
+	DEBUG( TString::Format( "Built summed-area table of '%s' (%d x %d x %d bins)", m_name.Data(), m_n[0], m_n[1], m_n[2] ) );
+}
+
+/***************************************************************************/
+/**
+ * This method returns the sum of \a table over bins [x1,x2] x [y1,y2] x
+ * [z1,z2] by inclusion-exclusion of the 8 corner prefix sums; the ranges
+ * are clipped to the mesh.
+ */
+double SummedAreaTable::boxSum(const std::vector<double>& table, int x1, int x2, int y1, int y2, int z1, int z2) const
+{
+	x1 = std::max(x1, 1); x2 = std::min(x2, m_n[0]);
+	y1 = std::max(y1, 1); y2 = std::min(y2, m_n[1]);
+	z1 = std::max(z1, 1); z2 = std::min(z2, m_n[2]);
+	if (x1 > x2 || y1 > y2 || z1 > z2)
+		return 0.;
+	--x1; --y1; --z1;
+	return  table[index(x2,y2,z2)] - table[index(x1,y2,z2)] - table[index(x2,y1,z2)] - table[index(x2,y2,z1)]
+	      + table[index(x1,y1,z2)] + table[index(x1,y2,z1)] + table[index(x2,y1,z1)] - table[index(x1,y1,z1)];
+}
+
+/***************************************************************************/
+/**
+ * This method creates the projection of the mesh with bin ranges
+ * \a rangeX, \a rangeY and \a rangeZ, with the same option and axis
+ * convention as \a TH3::Project3D() (e.g. "yx" has x on the horizontal
+ * and y on the vertical axis). Each bin of the projection is one box sum.
+ */
+TH1* SummedAreaTable::project(TString option, std::vector<int> rangeX, std::vector<int> rangeY, std::vector<int> rangeZ, TString name)
+{
+	option.ToLower();
+	int naxes = option.Length();
+	int axes[2] = { -1, -1 };   // horizontal, vertical axis of projection
+	if (naxes == 1)
+		axes[0] = option[0]-'x';
+	else if (naxes == 2) {
+		axes[0] = option[1]-'x';
+		axes[1] = option[0]-'x';
+	}
+	if (naxes < 1 || naxes > 2 || axes[0] < 0 || axes[0] > 2 || (naxes == 2 && (axes[1] < 0 || axes[1] > 2 || axes[0] == axes[1]))) {
+		ERROR("Undefined projection axis or plane '"+option+"'!");
+		return 0;
+	}
+
+	std::vector<int>* range[3] = { &rangeX, &rangeY, &rangeZ };
+	int lo[3], hi[3];
+	for (int a = 0; a < 3; ++a) {
+		lo[a] = (range[a]->size() > 0 ? std::max((*range[a])[0], 1) : 1);
+		hi[a] = (range[a]->size() > 1 ? std::min((*range[a])[1], m_n[a]) : m_n[a]);
+	}
+
+	TH1* proj = 0;
+	int h = axes[0], v = axes[1];
+	if (naxes == 1)
+		proj = new TH1D(name, m_title, m_n[h], &m_edge[h][0]);
+	else
+		proj = new TH2D(name, m_title, m_n[h], &m_edge[h][0], m_n[v], &m_edge[v][0]);
+	proj->SetDirectory(0);
+	proj->Sumw2();
+	proj->GetXaxis()->SetTitle(m_axisTitle[h]);
+	if (naxes == 2)
+		proj->GetYaxis()->SetTitle(m_axisTitle[v]);
+
+	int ny = (naxes == 2 ? m_n[v] : 1);
+	for (int j = 1; j <= ny; ++j) {
+		if (naxes == 2 && (j < lo[v] || j > hi[v]))
+			continue;
+		for (int i = lo[h]; i <= hi[h]; ++i) {
+			int b1[3] = { lo[0], lo[1], lo[2] }, b2[3] = { hi[0], hi[1], hi[2] };
+			b1[h] = b2[h] = i;
+			if (naxes == 2)
+				b1[v] = b2[v] = j;
+			int bin = (naxes == 2 ? proj->GetBin(i, j) : proj->GetBin(i));
+			proj->SetBinContent(bin, integral(b1[0], b2[0], b1[1], b2[1], b1[2], b2[2]));
+			proj->GetSumw2()->GetArray()[bin] = integralError2(b1[0], b2[0], b1[1], b2[1], b1[2], b2[2]);
+		}
+	}
+	proj->SetEntries(m_entries);
+	return proj;
+}
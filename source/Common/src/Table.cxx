@@ -148,52 +148,40 @@ void Table::print(int width)
 
 /***************************************************************************/
 /**
- * This method prints table to file
+ * This method prints table to file. The first row is considered as header.
+ * Supported formats are "text" (tab separated), "csv" and "latex".
  */
 void Table::print(std::ofstream& file, TString format)
 {
-/*  TString title, Xtitle, Ytitle, Ztitle;
-  double x, y, z;
-  int N = 1;
-  if(type == "latex") {
-    file << "\\begin{tabular} {c|c|c";
-    for (int i = 0; i < N; i++) 
-      file << "|c";
-    file << "}" << std::endl << "\\hline \\hline" << std::endl;
-  }
-  if(type == "latex")
-    file << hist->GetXaxis()->GetTitle() << " & " << hist->GetYaxis()->GetTitle() << " & " << hist->GetZaxis()->GetTitle();
-  else
-    file << hist->GetXaxis()->GetTitle() << " \t" << hist->GetYaxis()->GetTitle() << " \t" << hist->GetZaxis()->GetTitle();
-  for (int i = 0; i < N; i++) {
-    //infile >> title;
-    //if(type == "latex") 
-    //  file << " & " << title;
-    //else
-    //  file << " \t" << title;
-  }
-  if(type == "latex") 
-    file << " \\\\" << std::endl << "\\hline";
-  //while(infile >> x >> y >> z) {
-    if(type == "latex") 
-      file << std::endl << std::ios::fixed << x << " & " << y << " & " << z;
-    else
-      file << std::endl << std::ios::fixed << x << " \t" << y << " \t" << z;
-    for (int i = 0; i < N; i++) {
-      //binx = hist[i]->GetXaxis()->FindBin(x);
-      //biny = hist[i]->GetYaxis()->FindBin(y);
-      //binz = hist[i]->GetZaxis()->FindBin(z);
-      //if(type == "latex")
-	//file << " & " << std::scientific << hist[i]->GetBinContent(binx,biny,binz);
-      //else
-	//file << " \t" << std::scientific << hist[i]->GetBinContent(binx,biny,binz);
-    }
-    if(type == "latex") 
-      file << " \\\\";
-    //}
-  if(type == "latex") 
-    file << std::endl << "\\hline \\hline" << std::endl << "\\end{tabular}";
-*/
+	if(m_table.size() == 0) {
+		ERROR("Empty table, nothing to print.");
+		return;
+	}
+	int ncols = (int)m_table.size();
+	int nrows = (int)m_table[0].size();
+	std::string sep = " \t";
+	if(format == "csv")   sep = ",";
+	if(format == "latex") sep = " & ";
+
+	if(format == "latex") {
+		file << "\\begin{tabular} {c";
+		for(int j = 1; j < ncols; ++j)
+			file << "|c";
+		file << "}" << std::endl << "\\hline \\hline" << std::endl;
+	}
+	for(int i = 0; i < nrows; ++i) {
+		for(int j = 0; j < ncols; ++j) {
+			if(j > 0) file << sep;
+			file << std::string(m_table[j][i]);
+		}
+		if(format == "latex") {
+			file << " \\\\";
+			if(i == 0) file << std::endl << "\\hline";
+		}
+		file << std::endl;
+	}
+	if(format == "latex") 
+		file << "\\hline \\hline" << std::endl << "\\end{tabular}" << std::endl;
 }
 
 /***************************************************************************/
@@ -0,0 +1,115 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     ThreadPool.cxx
+ *
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This is constructor of ThreadPool class, it starts \a nthreads worker
+ * threads which wait for jobs in the queue.
+ */
+ThreadPool::ThreadPool(int nthreads) : m_stop(false), message("ThreadPool")
+{
+	nthreads = defaultSize(nthreads);
+	DEBUG( TString::Format( "Starting %d worker threads", nthreads ) );
+	for (int i = 0; i < nthreads; ++i)
+		m_workers.push_back( std::thread(&ThreadPool::work, this) );
+}
+
+/***************************************************************************/
+/**
+ * This is destructor of ThreadPool class, it lets worker threads finish
+ * all queued jobs and then joins them.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i].join();
+}
+
+/***************************************************************************/
+/**
+ * This method puts a job to the queue and wakes up one worker thread.
+ * Exceptions thrown by the job are rethrown by \a std::future::get().
+ */
+std::future<void> ThreadPool::submit(std::function<void()> job)
+{
+	std::packaged_task<void()> task(job);
+	std::future<void> result = task.get_future();
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_jobs.push( std::move(task) );
+	}
+	m_condition.notify_one();
+	return result;
+}
+
+/***************************************************************************/
+/**
+ * This method splits the range [\a begin, \a end) into chunks, submits
+ * one job per chunk and waits until all of them are done. The first
+ * exception thrown by a job is rethrown after all jobs finished.
+ */
+void ThreadPool::parallelFor(int begin, int end, std::function<void(int,int)> job, int chunk)
+{
+	if (end <= begin)
+		return;
+	if (chunk <= 0)
+		chunk = std::max( (end - begin) / (4 * std::max(size(), 1)), 1 );
+	std::vector< std::future<void> > jobs;
+	for (int first = begin; first < end; first += chunk) {
+		int last = std::min(first + chunk, end);
+		jobs.push_back( submit( [job,first,last]() { job(first, last); } ) );
+	}
+	for (size_t i = 0; i < jobs.size(); ++i)
+		jobs[i].wait();
+	for (size_t i = 0; i < jobs.size(); ++i)
+		jobs[i].get();
+}
+
+/***************************************************************************/
+/**
+ * This method returns \a nthreads if it is positive, otherwise the number
+ * of CPU cores (at least 1).
+ */
+int ThreadPool::defaultSize(int nthreads)
+{
+	if (nthreads > 0)
+		return nthreads;
+	int ncores = (int)std::thread::hardware_concurrency();
+	return (ncores > 0 ? ncores : 1);
+}
+
+/***************************************************************************/
+/**
+ * This method is the loop of each worker thread; it waits for jobs and
+ * executes them until the pool is stopped and the queue is empty.
+ */
+void ThreadPool::work()
+{
+	while (true) {
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_stop && m_jobs.empty())
+				m_condition.wait(lock);
+			if (m_stop && m_jobs.empty())
+				return;
+			task = std::move( m_jobs.front() );
+			m_jobs.pop();
+		}
+		task();
+	}
+}
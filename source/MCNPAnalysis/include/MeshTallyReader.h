@@ -9,12 +9,37 @@
  * histograms format, and then we can read these histograms and 
  * analysis results. 
  *
+ * Both the matrix (ij, ik, jk) and the column (col) meshtal output
+ * formats of rectangular meshes are supported. A meshtal file can hold
+ * several tallies, each of them with several energy bins; every energy
+ * bin of every tally is read in one pass into its own TH3F histogram
+ * with (X,Y,Z) axes. The mesh values are written directly into the bin
+ * arrays of the histograms while the file is parsed, so no intermediate
+ * copy of the mesh is made. The relative errors are kept as histogram
+ * bin errors.
+ *
+ * The histogram of the first tally (total over energy) is named after
+ * the meshtal file, the other ones get the suffixes "_t<tally number>"
+ * and "_e<energy bin>".
+ *
+ * With \ref setPyramid(), downsampled levels of each histogram (see
+ * \ref MeshPyramid) are built by \ref makeHisto() and written together
+ * with the histograms, so that plots can be made from coarser levels.
+ *
+ * For meshes which do not fit in memory, \ref setStore() makes the reader
+ * write the values tile by tile to \ref MeshStore objects (with the same
+ * names) in a ROOT file instead of creating histograms.
+ *
+ * For mostly empty meshes (e.g. shielding problems), \ref setSparse() makes
+ * the reader write the values to \ref SparseMesh objects, where only the
+ * blocks of bins with non-zero values are allocated.
+ *
  * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
  * \version  0.1
  * \date     30-03-2015
  *
  * \file     MeshTallyReader.h
- * 
+ *
  */
 
 #include <iostream>
@@ -29,31 +54,91 @@
 #include "ErrHandler.h"
 #include "StringParser.h"
 #include "HistoUtilities.h"
+#include "MeshStore.h"
+#include "SparseMesh.h"
+#include "MeshPyramid.h"
 
 #ifndef __MeshTallyReader__
 #define __MeshTallyReader__
 
+/// \brief Data of one MCNP mesh tally
+struct MeshTallyData {
+	int number;                 ///< tally number
+	TString particle;           ///< particle type
+	std::vector<double> xedge;  ///< X bin boundaries
+	std::vector<double> yedge;  ///< Y bin boundaries
+	std::vector<double> zedge;  ///< Z bin boundaries
+	std::vector<double> eedge;  ///< energy bin boundaries
+	std::vector<TH3F*> hist;    ///< mesh histograms, one per energy bin (plus total if more than one energy bin)
+	std::vector<MeshStore*> store; ///< out-of-core meshes, used instead of \a hist (see \ref MeshTallyReader::setStore())
+	std::vector<SparseMesh*> sparse; ///< block-sparse meshes, used instead of \a hist (see \ref MeshTallyReader::setSparse())
+};
+
 class MeshTallyReader {
 
 public:
 
 	/// \brief Class constructor
 	MeshTallyReader();
-	
+
 	/// \brief Class destructor
-	~MeshTallyReader() {};
-	
+	~MeshTallyReader();
+
 	/// \brief Read MCNP mesh file
 	/// \param filename name of MCNP mesh file
 	void read(TString filename);
-	
+
 	/// \brief Extract mesh histograms to output file
 	/// \param filename name of output file
 	/// \param isUpdate add histograms to existing file
 	void extractHisto(TString filename, bool isUpdate = false);
-	
-	enum Tag{INFO, BOUND, VALUE, ERROR}; ///< Types of information
-	enum Plane{NONE, XY, YZ, XZ};        ///< Types of mesh plane
+
+	/// \brief Write meshes to out-of-core storage instead of histograms
+	/// \param dir pointer of directory (e.g. \a TFile object) to store meshes
+	/// \param tile number of bins per tile on each axis (one along the slice
+	/// axis of matrix format)
+	/// \param cache maximum number of tiles in memory per mesh (at least one
+	/// layer of tiles for matrix format)
+	void setStore(TDirectory* dir, int tile = 32, int cache = 64);
+
+	/// \brief Write meshes to block-sparse meshes instead of histograms
+	/// \param block number of bins per block on each axis (0 for histograms)
+	void setSparse(int block = 8);
+
+	/// \brief Build downsampled levels of mesh histograms
+	/// \param nlevels maximum number of levels (0 means no pyramid)
+	/// \param pooling pooling method ("mean" or "max")
+	void setPyramid(int nlevels, TString pooling = "mean");
+
+	/// \brief Check mesh histograms filled by \ref read() and build their pyramids
+	void makeHisto();
+
+	/// \brief Write mesh histograms to an opened file
+	/// \param file pointer of \a TFile object
+	void writeHisto(TFile* file);
+
+	/// \brief Get all mesh histograms
+	/// \return vector of histograms (all tallies and energy bins)
+	std::vector<TH3F*> getHistos();
+
+	/// \brief Get all out-of-core meshes
+	/// \return vector of meshes (all tallies and energy bins)
+	std::vector<MeshStore*> getStores();
+
+	/// \brief Get all block-sparse meshes
+	/// \return vector of meshes (all tallies and energy bins)
+	std::vector<SparseMesh*> getSparses();
+
+	/// \brief Get mesh tallies
+	/// \return vector of mesh tally data
+	const std::vector<MeshTallyData>& getTallies() { return m_tally; };
+
+	/// \brief Get number of histories
+	/// \return number of histories used for normalizing tallies
+	double getNps() { return nps; };
+
+	enum Tag{INFO, BOUND, VALUE, ERROR, COLUMN}; ///< Types of information
+	enum Plane{NONE, XY, YZ, XZ};                ///< Types of mesh plane
 
 private:
 
@@ -61,39 +146,91 @@ private:
 	/// \param tag type of information to process
 	/// \param line information string line 
 	void process(Tag tag, std::string line);
-	
+
 	/// \brief Read information
-	/// \param line information string line
+	/// \param line information string line 
 	void readInfo(std::string line);
-	
+
 	/// \brief Read axis binning values
-	/// \param line information string line
+	/// \param line information string line 
 	void readBound(std::string line);
-	
+
 	/// \brief Read mesh value
-	/// \param line information string line
+	/// \param line information string line 
 	void readValue(std::string line);
-	
+
 	/// \brief Read mesh value error
-	/// \param line information string line
+	/// \param line information string line 
 	void readError(std::string line);
-	
-	std::vector< std::vector< std::vector<double> > > m_meshVal; ///< Mesh value vector
-	std::vector< std::vector< std::vector<double> > > m_meshErr; ///< Mesh value error vector
-	std::vector< std::vector<double> > m_val;                    ///< Temporary value vector
-	std::vector< std::vector<double> > m_err;                    ///< Temporary value error vector
+
+	/// \brief Read header of column format
+	/// \param line information string line 
+	void readColumnHeader(std::string line);
+
+	/// \brief Read one line of column format
+	/// \param line information string line 
+	void readColumn(std::string line);
+
+	/// \brief Get (and create if needed) histogram of an energy bin
+	/// \param ebin energy bin index
+	/// \return mesh histogram
+	TH3F* getHisto(int ebin);
+
+	/// \brief Get (and create if needed) out-of-core mesh of an energy bin
+	/// \param ebin energy bin index
+	/// \return out-of-core mesh
+	MeshStore* getStore(int ebin);
+
+	/// \brief Get (and create if needed) block-sparse mesh of an energy bin
+	/// \param ebin energy bin index
+	/// \return block-sparse mesh
+	SparseMesh* getSparse(int ebin);
+
+	/// \brief Check energy bin index and get name of its mesh
+	/// \param ebin energy bin index
+	/// \param name name of mesh
+	/// \param title title of mesh
+	/// \return false if the current tally has no such energy bin
+	bool makeName(int ebin, TString& name, TString& title);
+
+	/// \brief Set a value or relative error of an out-of-core or block-sparse mesh bin
+	/// \param bin bin index (in TH3 bin order)
+	/// \param value bin value or relative error
+	/// \param isError set relative error
+	void setStoreBin(int bin, double value, bool isError);
+
+	/// \brief Parse one matrix row directly into a mesh array
+	/// \param line information string line 
+	/// \param array destination array in TH3 bin order (0 for out-of-core or block-sparse mesh)
+	/// \param isError row of relative errors
+	template<class T> void readRow(const std::string& line, T* array, bool isError);
+
+	/// \brief Convert relative errors to histogram bin errors
+	void finalize();
+
+	std::vector<MeshTallyData> m_tally;                          ///< Mesh tallies
+	MeshTallyData* m_current;                                    ///< Mesh tally being read
 	TString m_histoname;                                         ///< Name of writeout histograms
-	int nps;                                                     ///< Number of histories
-	int tally;                                                   ///< Tally number
+	double nps;                                                  ///< Number of histories
 	Plane plane;                                                 ///< Mesh plane type
-	
-	/** Axis boundary values */
+	int m_slice;                                                 ///< Index of current mesh slice
+	int m_row;                                                   ///< Index of current row in slice
+	int m_ebin;                                                  ///< Index of current energy bin
+	TDirectory* m_storeDir;                                      ///< Directory of out-of-core meshes (0 for histograms)
+	int m_tileSize;                                              ///< Tile size of out-of-core meshes
+	int m_cacheSize;                                             ///< Number of cached tiles of out-of-core meshes
+	int m_sparseBlock;                                           ///< Block size of block-sparse meshes (0 for histograms)
+	int m_pyramidLevels;                                         ///< Number of pyramid levels
+	TString m_pooling;                                           ///< Pooling method of pyramid
+	std::vector< std::vector<TH3F*> > m_pyramid;                 ///< Pyramid levels of histograms (same order as \ref getHistos())
+
+	/** Column indices of column format */
 	//@{
-	double xlow, xhigh, ylow, yhigh, zlow, zhigh;   
+	int m_colE, m_colX, m_colY, m_colZ, m_colVal, m_colErr, m_ncol;
 	//@}
-	/** Axis bins */
+	/** Last found bins of column format */
 	//@{
-	int xbin, ybin, zbin; 
+	int m_ix, m_iy, m_iz;
 	//@}
 	ErrHandler message;                                          ///< Label of class to print out with message
 };
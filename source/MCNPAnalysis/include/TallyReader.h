@@ -33,13 +33,23 @@
 #ifndef __TallyReader__
 #define __TallyReader__
 
+/// \brief One line of MCNP tally fluctuation chart
+struct TFCEntry {
+	double nps;    ///< number of histories
+	double mean;   ///< tally mean
+	double error;  ///< relative error
+	double vov;    ///< variance of the variance
+	double slope;  ///< slope of the history score pdf
+	double fom;    ///< figure of merit
+};
+
 class TallyReader {
 
 public:
 
 	/// \brief Class constructor,
 	/// initialize label of class to print out with messages
-	TallyReader() : message("TallyReader") {};
+	TallyReader() : raw_nps(0), ctm(0.), message("TallyReader") {};
 	
 	/// \brief Class destructor
 	~TallyReader() {};
@@ -52,8 +62,21 @@ public:
 	/// \param filename name of root file
 	/// \param isUpdate add histograms to existing file
 	void extractHisto(TString filename, bool isUpdate = false);
+
+	/// \brief Get tally fluctuation chart of a tally
+	/// \param n tally number
+	/// \return tally fluctuation chart lines (empty if not found)
+	std::vector<TFCEntry> getTFC(int n);
+
+	/// \brief Get tally numbers found in tally fluctuation charts
+	/// \return vector of tally numbers
+	std::vector<int> getTFCTallies() { return tfc_tally; };
+
+	/// \brief Get computer time of the run
+	/// \return computer time (minutes)
+	double getComputerTime() { return ctm; };
 	
-	enum Tag{INFO, TALLYINFO, VALUE}; ///< Types of information
+	enum Tag{INFO, TALLYINFO, VALUE, TFC}; ///< Types of information
 	
 private:
 
@@ -73,6 +96,10 @@ private:
 	/// \brief Read MCNP results
 	/// \param line information string line
 	void readValue(std::string line);
+
+	/// \brief Read tally fluctuation chart line
+	/// \param line information string line
+	void readTFC(std::string line);
 	
 	std::vector<int> tally;                      ///< Tally number vector
 	std::vector<int> nps;                        ///< Number of histories vector
@@ -82,7 +109,11 @@ private:
 	std::vector<double> energy;                  ///< Temporary energy vector
 	std::vector<double> value;                   ///< Temporary MCNP result vector
 	std::vector<double> error;                   ///< Temporary MCNP result error vector
+	std::vector<int> tfc_tally;                  ///< Tally number vector of fluctuation charts
+	std::vector< std::vector<TFCEntry> > tfc;    ///< Tally fluctuation chart vector
+	std::vector<int> tfc_block;                  ///< Tally indices of current fluctuation chart block
 	int raw_nps;                                 ///< Original number of histories
+	double ctm;                                  ///< Computer time (minutes)
 	ErrHandler message;	                         ///< Label of class to print out with message
 };
 
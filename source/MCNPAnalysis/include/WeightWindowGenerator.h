@@ -0,0 +1,126 @@
+/**
+ * \class    WeightWindowGenerator
+ * \ingroup  MCNPAnalysis
+ *
+ * \brief    Make MCNP weight windows (WWINP file) from mesh tally results
+ *
+ * This class makes mesh-based weight windows from the flux of a mesh
+ * tally read by \ref MeshTallyReader, with the forward-flux method: the
+ * lower weight bound of a voxel is proportional to its flux,
+ * \f[ w(r) = w_{ref} \, \frac{\phi(r)}{\phi(r_{ref})} \f]
+ * normalized to \f$ w_{ref} \f$ at a reference point (usually the
+ * source). Each energy bin of the tally gives one energy group of windows.
+ *
+ * The windows are computed on the logarithm of the flux:
+ * * voxels without flux or with relative error above the limit are
+ *   switched off (lower bound 0, no weight window game),
+ * * the remaining voxels are smoothed with passes of a [1 2 1] filter
+ *   along each axis (only between voxels which are on),
+ * * the ratio of the bounds of neighbouring voxels is limited: lower
+ *   bounds are raised by a forward and a backward sweep along each axis,
+ *   and the sweeps of the three axes are repeated until no bound changes
+ *   (voxels which are off stop a sweep, so one round is not always
+ *   enough). This gives the smallest windows satisfying the limit.
+ *
+ * All steps work on whole lines of voxels, which are processed by the
+ * threads of a \ref ThreadPool, and the text of the windows is also
+ * formatted in parallel, so meshes of tens of millions of voxels take a
+ * few seconds.
+ *
+ * The file has the rectangular mesh format (nr = 10) of WWINP files. A
+ * uniform axis is written as one coarse mesh, other axes with one coarse
+ * mesh per bin.
+ *
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     WeightWindowGenerator.h
+ *
+ */
+
+#include <vector>
+#include <functional>
+#include <TString.h>
+#include "ErrHandler.h"
+#include "ThreadPool.h"
+#include "MeshTallyReader.h"
+
+#ifndef __WeightWindowGenerator__
+#define __WeightWindowGenerator__
+
+class WeightWindowGenerator {
+
+public:
+	/// \brief Class constructor
+	/// \param nthreads number of threads (0 means number of CPU cores)
+	WeightWindowGenerator(int nthreads = 0);
+
+	/// \brief Class destructor
+	~WeightWindowGenerator() {};
+
+	/// \brief Set reference point and its lower weight bound
+	/// \param x,y,z coordinates of reference point
+	/// \param weight lower weight bound at reference point
+	void setReference(double x, double y, double z, double weight = 0.5);
+
+	/// \brief Set limit of relative error of used voxels
+	/// \param error largest relative error (voxels above are switched off)
+	void setMaxError(double error) { m_maxError = error; };
+
+	/// \brief Set number of smoothing passes
+	/// \param npass number of passes (0 for no smoothing)
+	void setSmoothing(int npass) { m_smoothing = npass; };
+
+	/// \brief Set limit of ratio of lower bounds of neighbouring voxels
+	/// \param ratio largest ratio (0 for no limit)
+	void setMaxRatio(double ratio) { m_maxRatio = ratio; };
+
+	/// \brief Make weight windows of a mesh tally
+	/// \param tally mesh tally data (with histograms)
+	/// \return false if the windows can not be made
+	bool generate(const MeshTallyData& tally);
+
+	/// \brief Write weight windows to WWINP file
+	/// \param filename name of file
+	/// \return false if the file can not be written
+	bool write(TString filename);
+
+private:
+	/// \brief Make logarithm of lower bounds of one energy group
+	/// \param hist flux mesh of energy group
+	/// \param window logarithm of bounds (output, -inf for voxels off)
+	/// \return false if the reference voxel has no valid flux
+	bool makeGroup(TH3F* hist, std::vector<float>& window);
+
+	/// \brief Run a job on all lines of voxels along an axis
+	/// \param window voxel array (x fastest)
+	/// \param axis axis (0, 1, 2 for x, y, z)
+	/// \param job job called with first voxel, stride and number of voxels of a line
+	void forLines(std::vector<float>& window, int axis, std::function<void(float*,int,int)> job);
+
+	/// \brief Write values with 6 per line (format 6g13.5)
+	/// \param out output file
+	/// \param value values
+	void writeValues(std::ostream& out, const std::vector<float>& value);
+
+	/// \brief Write coarse mesh of an axis
+	/// \param out output file
+	/// \param edge bin boundaries of axis
+	void writeAxis(std::ostream& out, const std::vector<double>& edge);
+
+	double m_ref[3];                          ///< reference point
+	double m_refWeight;                       ///< lower weight bound at reference point
+	double m_maxError;                        ///< largest relative error of used voxels
+	int m_smoothing;                          ///< number of smoothing passes
+	double m_maxRatio;                        ///< largest ratio of neighbouring bounds
+	int m_n[3];                               ///< number of voxels on axes
+	std::vector<double> m_edge[3];            ///< bin boundaries of axes
+	std::vector<double> m_energy;             ///< upper energies of groups
+	bool m_photon;                            ///< windows for photons (else neutrons)
+	std::vector< std::vector<float> > m_window; ///< lower bounds of energy groups
+	ThreadPool m_pool;                        ///< threads processing lines of voxels
+	ErrHandler message;                       ///< label of class to print out with message
+};
+
+#endif
@@ -26,24 +26,42 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <functional>
 #include <TROOT.h>
 #include <TSystem.h>
+#include <TParameter.h>
 #include "ErrHandler.h"
 #include "Config.h"
 #include "Plotter.h"
 #include "TallyReader.h"
 #include "MeshTallyReader.h"
+#include "WeightWindowGenerator.h"
 #include "PtracParser.h"
 #include "PtracSelector.h"
 #include "HistoUtilities.h"
+#include "ThreadPool.h"
+#include "MeshKernels.h"
+#include "MeshSampler.h"
+#include "ResponseFunction.h"
+#include "ContourExtractor.h"
+#include "MeshExporter.h"
+#include "Table.h"
 
 void info();
 void processTally(Config *config);
 void processMesh (Config *config);
+void processMeshStore(Config *config);
+void processMeshSparse(Config *config);
 void processPtrac(Config *config);
 void processHisto(Config *config);
+void processMerge(Config *config);
+void processWeightWindow(Config *config);
 void processTallyComparison(Config *config);
+void processFOMComparison(Config *config);
 
 ErrHandler message("MCNPAnalysis");
 int debug_level;
@@ -80,6 +98,10 @@ int main(int argc, char **argv)
 		MESSAGE("Analysis mode TALLY COMPARISON");
 		processTallyComparison(config);
 	}
+	else if (type == "FOM COMPARISON") {
+		MESSAGE("Analysis mode FOM COMPARISON");
+		processFOMComparison(config);
+	}
 	else if (type == "MESHTALLY") {
 		MESSAGE("Analysis mode MESHTALLY");
 		processMesh(config);
@@ -92,6 +114,14 @@ int main(int argc, char **argv)
 		MESSAGE("Analysis mode HISTO");
 		processHisto(config);
 	}
+	else if (type == "MERGE") {
+		MESSAGE("Analysis mode MERGE");
+		processMerge(config);
+	}
+	else if (type == "WEIGHT WINDOW") {
+		MESSAGE("Analysis mode WEIGHT WINDOW");
+		processWeightWindow(config);
+	}
 	else {
 		ERROR("Undefined analysis mode!");
 		WARN("May due to the inconsistency between Windows and Linux/Cygwin text file formats.");
@@ -155,15 +185,19 @@ void processTally(Config* config)
  * output files and compare them with each other. Configuration options:
  * * \a File \a Name : name of MCNP output files (separate by ',')
  * * \a Tally \a Number: output tally numbers for reading (separate by ',')
+ * * \a Number \a of \a Threads : number of files parsed at the same time 
+ *   (0 means number of CPU cores)
  *
  * After reading outputs, histogram root files will be created with the same 
- * names with the output files.
+ * names with the output files. The output files are parsed concurrently,
+ * while the root files are written one by one from the main thread.
  */
 void processTallyComparison(Config* config)
 {
 	std::vector<TString> filelist  = config->getString("File Name"    , ',');
 	std::vector<TString> tallylist = config->getString("Tally Number" , ',');
 	std::vector<TString> legendlist = config->getString("Legend Title" , ',');
+	int nthreads                   = config->get("Number of Threads"  , 0);
 
 	DEBUG( TString::Format( "Number of files = %d", (int)filelist.size() ) );
 	DEBUG( TString::Format( "Number of tallies = %d", (int)tallylist.size() ) );
@@ -179,10 +213,16 @@ void processTallyComparison(Config* config)
 		WARN("No legend title was set.");
 
 	MESSAGE("Read tally files...");
-	for (int i = 0; i < (int)size; ++i) {
-		TallyReader tally;
-		tally.read(filelist[i]);
-		tally.extractHisto(filelist[i]+".root");
+	std::vector<TallyReader> tallies(size);
+	std::vector< std::future<void> > jobs;
+	{
+		ThreadPool pool(nthreads);
+		for (int i = 0; i < (int)size; ++i)
+			jobs.push_back( pool.submit( [&tallies,&filelist,i]() { tallies[i].read(filelist[i]); } ) );
+		for (int i = 0; i < (int)size; ++i) {
+			jobs[i].get();
+			tallies[i].extractHisto(filelist[i]+".root");
+		}
 	}
 
 	std::vector<TH1*> histlist;
@@ -203,50 +243,360 @@ void processTallyComparison(Config* config)
 	plotter.makeComparisonPlot(histlist);	
 }
 
+/***************************************************************************/
+/**
+ * This is the function for comparing the simulation efficiency of different 
+ * MCNP runs (e.g. different variance reduction setups) from their tally 
+ * fluctuation charts. Configuration options:
+ * * \a File \a Name : name of MCNP output files (separate by ',')
+ * * \a Tally \a Number : tally used for comparison, one number for all files 
+ *   or one number per file (separate by ',')
+ * * \a Legend \a Title : names of the runs (separate by ',')
+ * * \a Outputfile \a Name : name of summary files (default "fom_comparison")
+ * * \a Make \a Plot : plot relative error and FOM versus nps (true or false)
+ * * \a Number \a of \a Threads : number of files parsed at the same time 
+ *
+ * For each run, the figure of merit FOM = 1/(R^2 T) is taken from the last
+ * line of the fluctuation chart, since MCNP computes it from the relative 
+ * error R at full precision (R is printed with only 4 decimals). It is only
+ * computed from the printed R and the computer time T (minutes) if the 
+ * chart has no FOM. The FOM spread 
+ * over the second half of the chart and the slope of log(R) versus log(nps)
+ * (ideally -0.5) show whether the run is converged. The runs are ranked by 
+ * FOM and the summary table is written to \a Outputfile \a Name.txt, the 
+ * convergence graphs to \a Outputfile \a Name.root.
+ */
+void processFOMComparison(Config* config)
+{
+	std::vector<TString> filelist   = config->getString("File Name"       , ',');
+	std::vector<int> tallylist      = config->getInt   ("Tally Number"    , ',');
+	std::vector<TString> legendlist = config->getString("Legend Title"    , ',');
+	TString outfilename             = config->get      ("Outputfile Name" , "fom_comparison");
+	bool makeplot                   = config->get      ("Make Plot"       , false);
+	int nthreads                    = config->get      ("Number of Threads", 0);
+
+	int size = (int)filelist.size();
+	if(size < 1 || tallylist.size() < 1) {
+		ERROR("No file or tally number specified!");
+		return;
+	}
+	if(tallylist.size() != 1 && (int)tallylist.size() != size)
+		WARN("Numbers of files and tallies are different, using the first tally number for missing ones!");
+
+	MESSAGE("Read tally fluctuation charts...");
+	std::vector<TallyReader> tallies(size);
+	{
+		ThreadPool pool(nthreads);
+		std::vector< std::future<void> > jobs;
+		for (int i = 0; i < size; ++i)
+			jobs.push_back( pool.submit( [&tallies,&filelist,i]() { tallies[i].read(filelist[i]); } ) );
+		for (int i = 0; i < size; ++i)
+			jobs[i].get();
+	}
+
+	// compute FOM and convergence indicators of each run
+	std::vector<TString> label(size);
+	std::vector<TFCEntry> last(size);
+	std::vector<double> ctm(size), fom(size), spread(size), slope(size);
+	std::vector<TGraph*> errGraph, fomGraph;
+	std::vector<TString> graphTitle;
+	std::vector<int> order;
+	for (int i = 0; i < size; ++i) {
+		label[i] = ( i < (int)legendlist.size() ? legendlist[i] : filelist[i] );
+		int n = ( i < (int)tallylist.size() ? tallylist[i] : tallylist[0] );
+		std::vector<TFCEntry> chart = tallies[i].getTFC(n);
+		if(chart.size() == 0) {
+			ERROR( TString::Format( "No fluctuation chart of tally %d in file '%s'", n, filelist[i].Data() ) );
+			continue;
+		}
+		last[i] = chart.back();
+		ctm[i]  = tallies[i].getComputerTime();
+		fom[i]  = last[i].fom;
+		if(fom[i] <= 0. && ctm[i] > 0. && last[i].error > 0.) {
+			WARN("No FOM in fluctuation chart of '"+filelist[i]+"', using FOM from rounded relative error");
+			fom[i] = 1./(last[i].error*last[i].error*ctm[i]);
+		}
+
+		// FOM spread and error slope over second half of the chart
+		double sum = 0., sum2 = 0., sx = 0., sy = 0., sxx = 0., sxy = 0.;
+		int npoint = 0;
+		TGraph* gerr = new TGraph( (int)chart.size() );
+		TGraph* gfom = new TGraph( (int)chart.size() );
+		for (size_t j = 0; j < chart.size(); ++j) {
+			gerr->SetPoint( (int)j, chart[j].nps, chart[j].error );
+			gfom->SetPoint( (int)j, chart[j].nps, chart[j].fom );
+			if(chart[j].nps < 0.5*last[i].nps || chart[j].error <= 0.) continue;
+			double x = std::log(chart[j].nps), y = std::log(chart[j].error);
+			sum += chart[j].fom; sum2 += chart[j].fom*chart[j].fom;
+			sx += x; sy += y; sxx += x*x; sxy += x*y;
+			++npoint;
+		}
+		double mean = ( npoint > 0 ? sum/npoint : 0. );
+		spread[i] = ( mean > 0. ? std::sqrt( std::max(0., sum2/npoint - mean*mean) )/mean : 0. );
+		double denom = npoint*sxx - sx*sx;
+		slope[i] = ( npoint > 1 && denom != 0. ? (npoint*sxy - sx*sy)/denom : 0. );
+
+		gerr->SetName( TString::Format( "error_%d", i ) );  gerr->SetTitle(label[i]);
+		gfom->SetName( TString::Format( "fom_%d", i ) );    gfom->SetTitle(label[i]);
+		errGraph.push_back(gerr);
+		fomGraph.push_back(gfom);
+		graphTitle.push_back(label[i]);
+		order.push_back(i);
+	}
+	if(order.size() == 0) {
+		ERROR("No run to compare!");
+		return;
+	}
+	std::sort( order.begin(), order.end(), [&fom](int a, int b) { return fom[a] > fom[b]; } );
+
+	// summary table, ranked by FOM
+	const char* header[] = {"Rank", "Run", "NPS", "Mean", "Rel. Error", "VOV", "CTM (min)", "FOM", "FOM spread", "Err. slope", "Efficiency"};
+	std::vector< std::vector<GenericData> > columns(11);
+	for (int j = 0; j < 11; ++j)
+		columns[j].push_back( std::string(header[j]) );
+	double best = fom[order[0]];
+	for (size_t r = 0; r < order.size(); ++r) {
+		int i = order[r];
+		columns[0].push_back( (int)r+1 );
+		columns[1].push_back( std::string(label[i].Data()) );
+		columns[2].push_back( std::string( Form("%.0f",   last[i].nps)   ) );
+		columns[3].push_back( std::string( Form("%.4e",   last[i].mean)  ) );
+		columns[4].push_back( std::string( Form("%.4f",   last[i].error) ) );
+		columns[5].push_back( std::string( Form("%.4f",   last[i].vov)   ) );
+		columns[6].push_back( std::string( Form("%.2f",   ctm[i])        ) );
+		columns[7].push_back( std::string( Form("%.4g",   fom[i])        ) );
+		columns[8].push_back( std::string( Form("%.1f%%", 100.*spread[i]) ) );
+		columns[9].push_back( std::string( Form("%.2f",   slope[i])      ) );
+		columns[10].push_back( std::string( Form("%.3f",  fom[i]/best)   ) );
+		if(spread[i] > 0.1 || std::fabs(slope[i]+0.5) > 0.1)
+			WARN("Run '"+label[i]+"' does not look converged (FOM not stable or error not decreasing as 1/sqrt(N))");
+	}
+	Table table(columns);
+	table.print(12);
+
+	std::ofstream outfile( (outfilename+".txt").Data() );
+	if(outfile.is_open()) {
+		MESSAGE("Write summary table to '"+outfilename+".txt'");
+		table.print(outfile, "text");
+		outfile.close();
+	} else
+		ERROR("Unable to open file '"+outfilename+".txt'!");
+
+	TFile* file = TFile::Open(outfilename+".root","RECREATE");
+	for (size_t i = 0; i < errGraph.size(); ++i) {
+		errGraph[i]->Write();
+		fomGraph[i]->Write();
+	}
+	file->Close();
+
+	if(makeplot) {
+		MESSAGE("Make convergence plots...");
+		Plotter plotter;
+		plotter.setStyle(config);
+		plotter.makeGraphPlot(errGraph, graphTitle, outfilename+"_error");
+		plotter.makeGraphPlot(fomGraph, graphTitle, outfilename+"_fom");
+	}
+}
+
 /***************************************************************************/
 /**
  * This is the function for reading different tally mesh results, merging 
  * and plotting them. Configuration options:
  * * \a File \a Name : name of MCNP mesh tally outputs (separate by ',')
  * * \a Outputfile \a Name : name of histogram output file
- * * \a Merging: do merge mesh tallies (true or false)
+ * * \a Merging: do merge mesh tallies (true or false), only the file-total
+ *   meshes are summed into "mergedHisto"
  * * \a Make \a Ratio : create projection ratio plots between meshes
+ * * \a Make \a Relative \a Difference : also write relative differences to the 
+ *   first mesh with the ratios (true or false)
  * * \a Make \a Plot : create plots for tally outputs (true or false)
  * * \a Projection \a Plane : name of plane to make 2D projection plots on (e.g. "XY")
  * * \a Projection \a Axis : name of axis to make 1D projection plots on (e.g. "X")
  * * \a First \a Bin: the first bin to be included in projection
  * * \a Last \a Bin: the last bin to be included in projection
+ * * \a Number \a of \a Threads : number of files parsed at the same time 
+ *   (0 means number of CPU cores)
+ * * \a Out \a of \a Core : keep meshes as tiles on disk instead of histograms
+ *   (true or false), see \ref processMeshStore()
+ * * \a Sparse \a Mesh : keep meshes as blocks of non-zero bins instead of
+ *   histograms (true or false), see \ref processMeshSparse()
+ * * \a Pyramid \a Levels : number of downsampled levels written with each 
+ *   mesh (0 for none), see \ref MeshPyramid
+ * * \a Pyramid \a Pooling : pooling method of pyramid levels ("mean" or "max");
+ *   2D projection plots are only made from coarser levels with "mean" pooling
+ * * \a Pyramid \a Resolution : 2D projection plots use the coarsest level with at
+ *   least this number of bins on both plotted axes (default 200, 0 for one bin
+ *   per pixel of the plot)
+ * * \a Summed \a Area \a Table : make projections from 3D prefix sums of the 
+ *   meshes, built once per mesh (true or false), see \ref SummedAreaTable
+ * * \a Combination : "nps" to combine the files as independent runs of the
+ *   same problem (e.g. with different seeds), weighted by their numbers of
+ *   histories
+ * * \a Make \a Significance : compare meshes to the first one with z-scores
+ *   from their values and errors (true or false)
+ * * \a Significance \a Map : write maps of "z" or "chi2" (z^2) per voxel,
+ *   empty for the summary table only
+ * * \a Significance \a Tolerance : voxels with |z| above it are counted as
+ *   outside of tolerance (default 3)
+ * * \a Sample \a Points : text file of points ("x y z" per line) where the
+ *   meshes are interpolated, see \ref MeshSampler
+ * * \a Response \a Function : text file of energies and response factors
+ *   (e.g. flux-to-dose conversion factors) to fold the energy-binned meshes
+ *   with, see \ref ResponseFunction
+ * * \a Response \a Name : prefix of names of folded meshes (default "dose")
+ * * \a Isosurface \a Levels : levels of isosurfaces written as Wavefront OBJ
+ *   files "iso_<mesh>_<level index>.obj", see \ref ContourExtractor
+ * * \a Contour \a Lines : draw contour lines on 2D projection plots (see
+ *   \ref Plotter::makeProj2DPlot())
+ * * \a Export \a VTK : write the meshes (with errors) to binary VTK files
+ *   "<Outputfile Name>_<mesh>.vti" (or ".vtr"), see \ref MeshExporter
+ *
+ * The meshtally files are parsed and converted to histograms concurrently,
+ * the histograms are written to the output file by the main thread in the
+ * same order as \a File \a Name.
+ *
+ * With \a Combination "nps" the meshes of run \a i (mean per history 
+ * \f$ x_i \f$ with error \f$ \sigma_i \f$ from \f$ N_i \f$ histories) are
+ * added to running sums as soon as they are read, and the combined mesh
+ * \f[ x = \frac{\sum_i N_i x_i}{\sum_i N_i}, \quad
+ *     \sigma^2 = \frac{\sum_i N_i^2 \sigma_i^2}{(\sum_i N_i)^2} \f]
+ * is written as "combined_<first mesh>" with its relative errors in 
+ * "relerr_combined_<first mesh>" and the total number of histories in 
+ * the parameter "nps_combined".
+ *
+ * With a \a Response \a Function, the response is interpolated once on 
+ * the energy bins of each mesh tally, and the meshes of the energy bins are
+ * folded with these factors into "<prefix>_<total mesh>" in one pass over
+ * the bins, with errors of independent energy bins.
  */
 void processMesh(Config* config)
 {
+	if(config->get("Out of Core", false)) {
+		processMeshStore(config);
+		return;
+	}
+	if(config->get("Sparse Mesh", false)) {
+		processMeshSparse(config);
+		return;
+	}
+
 	std::vector<TString> filelist = config->getString("File Name"       , ',');
 	TString outfilename           = config->get      ("Outputfile Name" , "mesh_tally");
 	bool doMerging                = config->get      ("Merging"         , false);
 	bool doRatio                  = config->get      ("Make Ratio"      , false);
+	bool doDiff                   = config->get      ("Make Relative Difference", false);
 	bool makeplot                 = config->get      ("Make Plot"       , false);
 	TString plane                 = config->get      ("Projection Plane", "");
 	TString axis                  = config->get      ("Projection Axis" , "");
 	std::vector<int> firstbinList = config->getInt   ("First Bin"       , ',');
 	std::vector<int> lastbinList  = config->getInt   ("Last Bin"        , ',');
+	int nthreads                  = config->get      ("Number of Threads", 0);
+	int nlevels                   = config->get      ("Pyramid Levels"  , 0);
+	TString pooling               = config->get      ("Pyramid Pooling" , "mean");
+	TString combination           = config->get      ("Combination"     , "");
+	bool doSignificance           = config->get      ("Make Significance", false);
+	TString sigMap                = config->get      ("Significance Map", "");
+	double tolerance              = config->get      ("Significance Tolerance", 3.);
+	TString pointfile             = config->get      ("Sample Points"   , "");
+	TString responsefile          = config->get      ("Response Function", "");
+	TString responsename          = config->get      ("Response Name"   , "dose");
+	std::vector<double> isoLevels;
+	if(config->get("Isosurface Levels", "") != "")
+		isoLevels = config->getDouble("Isosurface Levels", ',');
+	bool doVTK                    = config->get      ("Export VTK"      , false);
+
+	ResponseFunction response;
+	if(responsefile != "" && !response.read(responsefile))
+		return;
 
 	// read meshtally files and write out histograms to output file
 	MESSAGE("Read meshtally files...");
 	int size = (int) filelist.size();
-	for(int i = 0; i < size; ++i) {
-		MeshTallyReader mesh;
-		mesh.read(filelist[i]);
-		if(i==0)
-			mesh.extractHisto(outfilename+".root", false);
-		else
-			mesh.extractHisto(outfilename+".root", true);
+	std::vector<MeshTallyReader*> meshes(size);
+	std::vector< std::future<void> > jobs;
+	ROOT::EnableThreadSafety();
+	TH1::AddDirectory(kFALSE);
+	{
+		ThreadPool pool(nthreads);
+		for(int i = 0; i < size; ++i) {
+			meshes[i] = new MeshTallyReader();
+			meshes[i]->setPyramid(nlevels, pooling);
+			jobs.push_back( pool.submit( [&meshes,&filelist,i]() { meshes[i]->read(filelist[i]); meshes[i]->makeHisto(); } ) );
+		}
+		TFile* outfile = TFile::Open(outfilename+".root","RECREATE");
+		MeshKernels kernels(nthreads);
+		std::vector<TH1*> combined;
+		double totalNps = 0.;
+		for(int i = 0; i < size; ++i) {
+			jobs[i].get();
+			meshes[i]->writeHisto(outfile);
+			if(response.getSize() > 0) {
+				const std::vector<MeshTallyData>& tallies = meshes[i]->getTallies();
+				for(size_t t = 0; t < tallies.size(); ++t) {
+					int nE = (int)tallies[t].eedge.size()-1;
+					if(nE < 2 || (int)tallies[t].hist.size() <= nE || !tallies[t].hist[nE]) continue;
+					std::vector<TH1*> ebins(tallies[t].hist.begin(), tallies[t].hist.begin()+nE);
+					TH1* folded = kernels.weightedSum( ebins, response.getFactors(tallies[t].eedge), responsename+"_"+TString(tallies[t].hist[nE]->GetName()) );
+					if(!folded) continue;
+					folded->SetTitle( TString(tallies[t].hist[nE]->GetTitle())+" folded with "+responsefile );
+					outfile->cd();
+					folded->Write();
+					delete folded;
+				}
+			}
+			if(combination == "nps") {
+				std::vector<TH3F*> hist = meshes[i]->getHistos();
+				double nps = meshes[i]->getNps();
+				// every mesh of a file must match its running sum, otherwise
+				// the file is not combined and its histories are not counted
+				bool compatible = (nps > 0. && (totalNps <= 0. || hist.size() == combined.size()));
+				for(size_t k = 0; k < hist.size() && compatible; ++k) {
+					std::vector<TH1*> pair(1, hist[k]);
+					if(k < combined.size()) pair.insert(pair.begin(), combined[k]);
+					compatible = kernels.check(pair);
+				}
+				if(nps <= 0.)
+					WARN("No number of histories in '"+filelist[i]+"', file is not combined");
+				else if(!compatible)
+					WARN("Meshes of '"+filelist[i]+"' do not match the combined meshes, file is not combined");
+				else {
+					combined.resize( hist.size(), (TH1*)0 );
+					for(size_t k = 0; k < hist.size(); ++k)
+						combined[k] = kernels.accumulate( combined[k], hist[k], nps, "combined_"+TString(hist[k]->GetName()) );
+					totalNps += nps;
+				}
+			}
+			delete meshes[i];
+		}
+		if(totalNps > 0.) {
+			MESSAGE( TString::Format( "Combine meshes of %.0f histories...", totalNps ) );
+			outfile->cd();
+			for(size_t k = 0; k < combined.size(); ++k) {
+				if(!combined[k]) continue;
+				combined[k]->Scale(1./totalNps);
+				combined[k]->Write();
+				TH1* relerr = kernels.relError( combined[k], "relerr_"+TString(combined[k]->GetName()) );
+				relerr->Write();
+				delete relerr;
+				delete combined[k];
+			}
+			TParameter<double> npsParam("nps_combined", totalNps);
+			npsParam.Write();
+		}
+		outfile->Close();
 	}
+	TH1::AddDirectory(kTRUE);
 
 	// merge 3D meshtally histograms
+	if(doMerging && combination == "nps") {
+		WARN("Merging is not done with NPS combination");
+		doMerging = false;
+	}
 	if(doMerging) {
 		MESSAGE("Merge meshtally histograms...");
 		HistoUtilities hutil;
 		TFile *file = new TFile(outfilename+".root","update");
-		hutil.mergeHistos(file);
+		hutil.mergeHistos(file, filelist, nthreads);
 		file->Close();
 	}
 	
@@ -257,16 +607,169 @@ void processMesh(Config* config)
 		TFile *infile = new TFile(outfilename+".root","read");
 		std::vector<TH1*> histlist;
 		hutil.getHistosFromFile(histlist,filelist,infile);
-		for(int i = 1; i < (int)histlist.size(); ++i) {
-			histlist[i]->Divide(histlist[i],histlist[0]);
-			histlist[i]->SetName( TString::Format( "ratio_%s_%s", histlist[i]->GetName(), histlist[0]->GetName() ) );
+		std::vector<TH1*> numlist(histlist.begin()+std::min((size_t)1,histlist.size()), histlist.end());
+		std::vector<TString> rationame, diffname;
+		for(size_t i = 0; i < numlist.size(); ++i) {
+			rationame.push_back( TString::Format( "ratio_%s_%s", numlist[i]->GetName(), histlist[0]->GetName() ) );
+			diffname.push_back ( TString::Format( "reldiff_%s_%s", numlist[i]->GetName(), histlist[0]->GetName() ) );
+		}
+		MeshKernels kernels(nthreads);
+		std::vector<TH1*> ratiolist(histlist.begin(), histlist.begin()+std::min((size_t)1,histlist.size()));
+		if(numlist.size() > 0) {
+			std::vector<TH1*> ratio = kernels.ratio(numlist, histlist[0], rationame);
+			ratiolist.insert(ratiolist.end(), ratio.begin(), ratio.end());
+			if(doDiff) {
+				std::vector<TH1*> difflist = kernels.relDiff(numlist, histlist[0], diffname);
+				ratiolist.insert(ratiolist.end(), difflist.begin(), difflist.end());
+			}
 		}
 		TFile* outfile = new TFile("ratio_"+outfilename+".root","recreate");
-		hutil.writeHistos(histlist,outfile);
+		hutil.writeHistos(ratiolist,outfile);
 		infile->Close();
 		outfile->Close();
 	}
 
+	// make significance summary (and maps) of differences to the first mesh
+	if(doSignificance) {
+		MESSAGE("Make significance of meshtally differences...");
+		HistoUtilities hutil;
+		TFile *infile = new TFile(outfilename+".root","read");
+		std::vector<TH1*> histlist;
+		hutil.getHistosFromFile(histlist,filelist,infile);
+		if(histlist.size() < 2)
+			ERROR("Need at least two meshes for significance!");
+		else {
+			std::vector<TH1*> numlist(histlist.begin()+1, histlist.end());
+			std::vector<TString> signame;
+			if(sigMap != "")
+				for(size_t i = 0; i < numlist.size(); ++i)
+					signame.push_back( TString::Format( "%s_%s_%s", sigMap.Data(), numlist[i]->GetName(), histlist[0]->GetName() ) );
+			MeshKernels kernels(nthreads);
+			std::vector<MeshSignificance> summary;
+			std::vector<TH1*> maps = kernels.significance(numlist, histlist[0], signame, (sigMap != "" ? sigMap : TString("z")), tolerance, summary);
+
+			std::string header[6] = { "Mesh", "Voxels", Form("|z|>%g", tolerance), "Fraction", "chi2/ndf", "max |z|" };
+			std::vector< std::vector<GenericData> > columns(6);
+			for(int j = 0; j < 6; ++j)
+				columns[j].push_back( header[j] );
+			for(size_t i = 0; i < summary.size(); ++i) {
+				const MeshSignificance& s = summary[i];
+				columns[0].push_back( std::string(numlist[i]->GetName()) );
+				columns[1].push_back( s.nbins );
+				columns[2].push_back( s.noutside );
+				columns[3].push_back( std::string( Form("%.2f%%", s.nbins > 0 ? 100.*s.noutside/s.nbins : 0.) ) );
+				columns[4].push_back( std::string( Form("%.3f",   s.nbins > 0 ? s.chi2/s.nbins : 0.) ) );
+				columns[5].push_back( std::string( Form("%.2f",   s.maxZ) ) );
+			}
+			Table table(columns);
+			table.print(6);
+			std::ofstream txtfile( ("significance_"+outfilename+".txt").Data() );
+			if(txtfile.is_open()) {
+				MESSAGE("Write significance table to 'significance_"+outfilename+".txt'");
+				table.print(txtfile, "text");
+				txtfile.close();
+			} else
+				ERROR("Unable to open file 'significance_"+outfilename+".txt'!");
+
+			if(maps.size() > 0) {
+				TFile* outfile = new TFile("significance_"+outfilename+".root","recreate");
+				hutil.writeHistos(maps,outfile);
+				outfile->Close();
+			}
+		}
+		infile->Close();
+	}
+
+	// interpolate meshes at sample points
+	if(pointfile != "") {
+		MESSAGE("Sample meshes at points of '"+pointfile+"'...");
+		std::ifstream input(pointfile.Data());
+		if(!input.is_open())
+			ERROR("Unable to open file '"+pointfile+"'!");
+		else {
+			std::vector<double> x, y, z;
+			std::string line;
+			while(std::getline(input, line)) {
+				std::istringstream ss(line);
+				double px, py, pz;
+				if(line.find('#') == 0 || !(ss >> px >> py >> pz)) continue;
+				x.push_back(px);
+				y.push_back(py);
+				z.push_back(pz);
+			}
+			input.close();
+
+			HistoUtilities hutil;
+			TFile *infile = new TFile(outfilename+".root","read");
+			std::vector<TH1*> histlist;
+			hutil.getHistosFromFile(histlist,filelist,infile);
+			std::vector< std::vector<double> > values, errors;
+			std::vector<TString> names;
+			for(size_t i = 0; i < histlist.size(); ++i) {
+				TH3* hist = dynamic_cast<TH3*>(histlist[i]);
+				if(!hist) continue;
+				MeshSampler sampler(hist, nthreads);
+				values.push_back( std::vector<double>() );
+				errors.push_back( std::vector<double>() );
+				int ninside = sampler.sample(x, y, z, values.back(), errors.back());
+				names.push_back( hist->GetName() );
+				INFO( TString::Format( "%d of %d points inside of mesh '%s'", ninside, (int)x.size(), hist->GetName() ) );
+			}
+			infile->Close();
+
+			std::ofstream txtfile( ("samples_"+outfilename+".txt").Data() );
+			if(txtfile.is_open()) {
+				MESSAGE("Write sampled values to 'samples_"+outfilename+".txt'");
+				txtfile << "# x y z";
+				for(size_t j = 0; j < names.size(); ++j)
+					txtfile << " " << names[j] << " error";
+				txtfile << std::endl;
+				for(size_t i = 0; i < x.size(); ++i) {
+					txtfile << Form("%g %g %g", x[i], y[i], z[i]);
+					for(size_t j = 0; j < names.size(); ++j)
+						txtfile << Form(" %.5e %.5e", values[j][i], errors[j][i]);
+					txtfile << std::endl;
+				}
+				txtfile.close();
+			} else
+				ERROR("Unable to open file 'samples_"+outfilename+".txt'!");
+		}
+	}
+
+	// extract isosurfaces of meshes
+	if(isoLevels.size() > 0) {
+		MESSAGE("Extract isosurfaces of meshes...");
+		HistoUtilities hutil;
+		TFile *infile = new TFile(outfilename+".root","read");
+		std::vector<TH1*> histlist;
+		hutil.getHistosFromFile(histlist,filelist,infile);
+		ContourExtractor extractor(nthreads);
+		for(size_t i = 0; i < histlist.size(); ++i) {
+			TH3* hist = dynamic_cast<TH3*>(histlist[i]);
+			if(!hist) continue;
+			for(size_t l = 0; l < isoLevels.size(); ++l)
+				extractor.writeSurface( extractor.isosurface(hist, isoLevels[l]), TString::Format( "iso_%s_%d.obj", hist->GetName(), (int)l+1 ) );
+		}
+		infile->Close();
+	}
+
+	// export meshes to VTK files
+	if(doVTK) {
+		MESSAGE("Export meshes to VTK files...");
+		HistoUtilities hutil;
+		TFile *infile = new TFile(outfilename+".root","read");
+		std::vector<TH1*> histlist;
+		hutil.getHistosFromFile(histlist,infile);
+		std::vector<TH3*> meshlist;
+		for(size_t i = 0; i < histlist.size(); ++i)
+			if(TH3* hist = dynamic_cast<TH3*>(histlist[i]))
+				meshlist.push_back(hist);
+		MeshExporter exporter(nthreads);
+		int nwritten = exporter.write(meshlist, outfilename+"_");
+		INFO( TString::Format( "Exported %d of %d meshes", nwritten, (int)meshlist.size() ) );
+		infile->Close();
+	}
+
 	// make meshtally plots
 	if(makeplot) {
 		if(lastbinList.size() < firstbinList.size()) {
@@ -293,19 +796,20 @@ void processMesh(Config* config)
 
 		// make 2D projection plots
 		MESSAGE("Make 2D projection plots...");
-		/*
 		if(plane != "") {
-			for(size_t i = 0; i < firstbinList.size(); ++i) {
-				double weight = 1.;
-				if(doRatio) weight = 1./(lastbinList[i]-firstbinList[i]+1);
-				if(doMerging)
-					//plotter.makeProj2DPlot( (TH3F*)histolist[histolist.size()-1], plane, firstbinList[i], lastbinList[i], weight );
-				else
-					for(size_t j = 0; j < histolist.size(); ++j)
-						//plotter.makeProj2DPlot( (TH3F*)histolist[j], plane, firstbinList[i], lastbinList[i], weight );
+			// all bin ranges of a mesh, so only its summed-area table is kept
+			for(size_t j = (doMerging ? histolist.size()-1 : 0); j < histolist.size(); ++j) {
+				TH3* hist = dynamic_cast<TH3*>(histolist[j]);
+				if(!hist) continue;
+				std::vector<TH3*> levels = MeshPyramid::read(hist, file, "mean");
+				for(size_t i = 0; i < firstbinList.size(); ++i) {
+					double weight = 1.;
+					if(doRatio) weight = 1./(lastbinList[i]-firstbinList[i]+1);
+					plotter.makeProj2DPlot( levels, plane, firstbinList[i], lastbinList[i], weight );
+				}
+				plotter.clearTables();
 			}
 		}
-		*/
 		/*
 		// make 1D projection plots
 		if(axis != "") {
@@ -316,6 +820,244 @@ void processMesh(Config* config)
 	}
 }
 
+/***************************************************************************/
+/**
+ * This is the function for writing the ratio meshes of all files to the
+ * first one to "ratio_<Outputfile Name>.root". The ratio of file \a i,
+ * named "ratio_<file i>_<file 0>", is made and written by \a makeRatio, 
+ * so it is shared by out-of-core and block-sparse meshes.
+ */
+void writeRatios(const std::vector<TString>& filelist, TString outfilename, std::function<void(size_t, TString, TFile*)> makeRatio)
+{
+	TFile* ratiofile = TFile::Open("ratio_"+outfilename+".root","RECREATE");
+	if(!ratiofile || ratiofile->IsZombie()) {
+		ERROR("Unable to open file 'ratio_"+outfilename+".root'!");
+		delete ratiofile;
+		return;
+	}
+	for(size_t i = 1; i < filelist.size(); ++i)
+		makeRatio(i, TString::Format( "ratio_%s_%s", filelist[i].Data(), filelist[0].Data() ), ratiofile);
+	ratiofile->Close();
+	delete ratiofile;
+}
+
+/***************************************************************************/
+/**
+ * This is the function for writing the projections of an out-of-core or
+ * block-sparse mesh (\ref MeshStore or \ref SparseMesh) to \a outfile. A 
+ * 2D projection on \a plane is made for each bin range \a firstbinList to
+ * \a lastbinList of the third axis (named with the range), otherwise one 
+ * projection on \a plane or \a axis over the whole mesh. It returns false
+ * if the bin ranges are incomplete.
+ */
+template<class Mesh> bool writeProjections(Mesh& mesh, TString plane, TString axis, const std::vector<int>& firstbinList, const std::vector<int>& lastbinList, TFile* outfile)
+{
+	if(lastbinList.size() < firstbinList.size()) {
+		ERROR("Missing last bin numbers!");
+		return false;
+	}
+	TString option = (plane != "" ? TString(plane(1,1)) + TString(plane(0,1)) : axis);
+	option.ToLower();
+	int third = 0;
+	while(third < 2 && option.First((char)('x'+third)) >= 0)
+		++third;
+	size_t nrange = (plane != "" ? std::max(firstbinList.size(), (size_t)1) : 1);
+	for(size_t k = 0; k < nrange; ++k) {
+		std::vector<int> range[3];
+		if(plane != "" && k < firstbinList.size()) {
+			range[third].push_back(firstbinList[k]);
+			range[third].push_back(lastbinList[k]);
+		}
+		TH1* proj = mesh.makeProjection(option, range[0], range[1], range[2]);
+		if(!proj)
+			break;
+		if(range[third].size() > 0)
+			proj->SetName( TString::Format( "%s_%d_%d", proj->GetName(), range[third][0], range[third][1] ) );
+		outfile->cd();
+		proj->Write();
+		delete proj;
+	}
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This is the function for reading tally mesh results which are too large
+ * for memory. The meshes are written tile by tile to \ref MeshStore objects
+ * in the output file, so only a few tiles of each mesh are in memory at
+ * the same time. Configuration options (as \ref processMesh()):
+ * * \a File \a Name : name of MCNP mesh tally outputs (separate by ',')
+ * * \a Outputfile \a Name : name of mesh output file
+ * * \a Make \a Ratio : create ratio meshes to the first mesh
+ * * \a Projection \a Plane : name of plane to make 2D projections on (e.g. "XY")
+ * * \a Projection \a Axis : name of axis to make 1D projections on (e.g. "X")
+ * * \a First \a Bin: the first bin (of the third axis) included in 2D projections
+ * * \a Last \a Bin: the last bin (of the third axis) included in 2D projections
+ * * \a Tile \a Size : number of bins per tile on each axis (one bin along the
+ *   slice axis of matrix-format meshtal files)
+ * * \a Tile \a Cache : number of tiles of each mesh kept in memory (at least
+ *   one layer of tiles for matrix-format meshtal files)
+ *
+ * Ratios and projections are computed tile by tile; the projections are
+ * written as histograms to the output file.
+ */
+void processMeshStore(Config* config)
+{
+	std::vector<TString> filelist = config->getString("File Name"       , ',');
+	TString outfilename           = config->get      ("Outputfile Name" , "mesh_tally");
+	bool doMerging                = config->get      ("Merging"         , false);
+	bool doRatio                  = config->get      ("Make Ratio"      , false);
+	TString plane                 = config->get      ("Projection Plane", "");
+	TString axis                  = config->get      ("Projection Axis" , "");
+	std::vector<int> firstbinList = config->getInt   ("First Bin"       , ',');
+	std::vector<int> lastbinList  = config->getInt   ("Last Bin"        , ',');
+	int tileSize                  = config->get      ("Tile Size"       , 32);
+	int tileCache                 = config->get      ("Tile Cache"      , 64);
+
+	// read meshtally files tile by tile to output file
+	MESSAGE("Read meshtally files out of core...");
+	TFile* outfile = TFile::Open(outfilename+".root","RECREATE");
+	for(size_t i = 0; i < filelist.size(); ++i) {
+		MeshTallyReader mesh;
+		mesh.setStore(outfile, tileSize, tileCache);
+		mesh.read(filelist[i]);
+		mesh.makeHisto();
+	}
+	if(doMerging)
+		WARN("Merging is not supported for out-of-core meshes");
+
+	// make ratio meshes tile by tile
+	if(doRatio && filelist.size() > 1) {
+		MESSAGE("Make ratio meshes...");
+		MeshStore den;
+		den.setCacheSize(tileCache);
+		if(den.open(outfile, filelist[0]))
+			writeRatios(filelist, outfilename, [&](size_t i, TString name, TFile* ratiofile) {
+				MeshStore num, ratio;
+				num.setCacheSize(tileCache);
+				ratio.setCacheSize(tileCache);
+				if(num.open(outfile, filelist[i]))
+					num.makeRatio(den, ratio, ratiofile, name);
+			});
+	}
+
+	// make projections tile by tile
+	if(plane != "" || axis != "") {
+		MESSAGE("Make projections of meshes...");
+		for(size_t i = 0; i < filelist.size(); ++i) {
+			MeshStore mesh;
+			mesh.setCacheSize(tileCache);
+			if(!mesh.open(outfile, filelist[i]))
+				continue;
+			if(!writeProjections(mesh, plane, axis, firstbinList, lastbinList, outfile))
+				break;
+		}
+	}
+	outfile->Close();
+}
+
+/***************************************************************************/
+/**
+ * This is the function for reading mostly empty tally meshes (e.g. of
+ * shielding problems). The meshes are read directly into \ref SparseMesh
+ * objects, where only the blocks of bins with non-zero values take memory,
+ * and are written block-sparse to the output file. Configuration options
+ * (as \ref processMesh()):
+ * * \a File \a Name : name of MCNP mesh tally outputs (separate by ',')
+ * * \a Outputfile \a Name : name of mesh output file
+ * * \a Merging : sum the meshes of all files into "mergedHisto"
+ * * \a Make \a Ratio : create ratio meshes to the first mesh
+ * * \a Projection \a Plane : name of plane to make 2D projections on (e.g. "XY")
+ * * \a Projection \a Axis : name of axis to make 1D projections on (e.g. "X")
+ * * \a First \a Bin: the first bin (of the third axis) included in 2D projections
+ * * \a Last \a Bin: the last bin (of the third axis) included in 2D projections
+ * * \a Block \a Size : number of bins per block on each axis (default 8)
+ * * \a Number \a of \a Threads : number of files parsed at the same time 
+ *   and of threads of the mesh operations (0 means number of CPU cores)
+ *
+ * Merging, ratios and projections skip the empty blocks; the projections
+ * are written as histograms to the output file. Dense histograms of the
+ * meshes are never made.
+ */
+void processMeshSparse(Config* config)
+{
+	std::vector<TString> filelist = config->getString("File Name"       , ',');
+	TString outfilename           = config->get      ("Outputfile Name" , "mesh_tally");
+	bool doMerging                = config->get      ("Merging"         , false);
+	bool doRatio                  = config->get      ("Make Ratio"      , false);
+	TString plane                 = config->get      ("Projection Plane", "");
+	TString axis                  = config->get      ("Projection Axis" , "");
+	std::vector<int> firstbinList = config->getInt   ("First Bin"       , ',');
+	std::vector<int> lastbinList  = config->getInt   ("Last Bin"        , ',');
+	int blockSize                 = config->get      ("Block Size"      , 8);
+	int nthreads                  = config->get      ("Number of Threads", 0);
+
+	// read meshtally files into sparse meshes
+	MESSAGE("Read meshtally files into sparse meshes...");
+	int size = (int) filelist.size();
+	std::vector<MeshTallyReader*> meshes(size);
+	{
+		ThreadPool pool(nthreads);
+		std::vector< std::future<void> > jobs;
+		for(int i = 0; i < size; ++i) {
+			meshes[i] = new MeshTallyReader();
+			meshes[i]->setSparse(blockSize);
+			jobs.push_back( pool.submit( [&meshes,&filelist,i]() { meshes[i]->read(filelist[i]); meshes[i]->makeHisto(); } ) );
+		}
+		for(int i = 0; i < size; ++i)
+			jobs[i].get();
+	}
+	TFile* outfile = TFile::Open(outfilename+".root","RECREATE");
+	std::vector<SparseMesh*> total(size, (SparseMesh*)0);
+	for(int i = 0; i < size; ++i) {
+		meshes[i]->writeHisto(outfile);
+		std::vector<SparseMesh*> sparse = meshes[i]->getSparses();
+		for(size_t k = 0; k < sparse.size(); ++k) {
+			sparse[k]->setThreads(nthreads);
+			INFO( TString::Format( "Mesh '%s' uses %d of %d blocks", sparse[k]->getName().Data(), sparse[k]->getNfilled(), sparse[k]->getNblocks() ) );
+			if(sparse[k]->getName() == filelist[i])
+				total[i] = sparse[k];
+		}
+	}
+
+	// merge meshes block by block
+	if(doMerging && size > 0 && total[0]) {
+		MESSAGE("Merge sparse meshes...");
+		SparseMesh merged(nthreads);
+		merged.create("mergedHisto", total[0]->getTitle(), total[0]->getEdges(0), total[0]->getEdges(1), total[0]->getEdges(2), blockSize);
+		for(int i = 0; i < size; ++i) {
+			if(!total[i]) continue;
+			if(!merged.add(*total[i]))
+				ERROR("Mesh of file '"+filelist[i]+"' is not merged!");
+		}
+		merged.write(outfile);
+	}
+
+	// make ratio meshes block by block
+	if(doRatio && size > 1 && total[0]) {
+		MESSAGE("Make ratio meshes...");
+		writeRatios(filelist, outfilename, [&](size_t i, TString name, TFile* ratiofile) {
+			if(!total[i]) return;
+			SparseMesh ratio(nthreads);
+			if(total[i]->makeRatio(*total[0], ratio, name))
+				ratio.write(ratiofile);
+		});
+	}
+
+	// make projections of non-empty blocks
+	if(plane != "" || axis != "") {
+		MESSAGE("Make projections of meshes...");
+		for(int i = 0; i < size; ++i) {
+			if(!total[i]) continue;
+			if(!writeProjections(*total[i], plane, axis, firstbinList, lastbinList, outfile))
+				break;
+		}
+	}
+	outfile->Close();
+	for(int i = 0; i < size; ++i)
+		delete meshes[i];
+}
+
 /***************************************************************************/
 /**
  * This is the function for processing PTRAC file.
@@ -363,6 +1105,90 @@ void processHisto(Config* config)
 }
 
 
+
+/***************************************************************************/
+/**
+ * This is the function for merging histograms of many ROOT files (e.g. 
+ * results of separate runs), with configuration options:
+ * * \a File \a Name : names of ROOT files (separate by ',')
+ * * \a Outputfile \a Name : name of output file (without ".root")
+ * * \a Number \a of \a Threads : number of threads (0 means number of CPU cores)
+ * * \a Files \a in \a Memory : number of files read at the same time, 
+ *   limits the memory use (0 means number of threads)
+ *
+ * See \ref HistoUtilities::mergeFiles().
+ */
+void processMerge(Config* config)
+{
+	std::vector<TString> filelist = config->getString("File Name"        , ',');
+	TString outfilename           = config->get      ("Outputfile Name"  , "merged");
+	int nthreads                  = config->get      ("Number of Threads", 0);
+	int batch                     = config->get      ("Files in Memory"  , 0);
+
+	MESSAGE( TString::Format( "Merge histograms of %d files...", (int)filelist.size() ) );
+	HistoUtilities hutil;
+	int nmerged = hutil.mergeFiles(filelist, outfilename+".root", nthreads, batch);
+	INFO( TString::Format( "Merged %d histograms into '%s.root'", nmerged, outfilename.Data() ) );
+}
+
+/***************************************************************************/
+/**
+ * This is the function for making MCNP weight windows (WWINP file) from a
+ * mesh tally, with configuration options:
+ * * \a File \a Name : name of MCNP mesh tally output
+ * * \a Outputfile \a Name : name of WWINP file (default "wwinp")
+ * * \a Tally \a Number : number of mesh tally (0 means the first one)
+ * * \a Reference \a Point : coordinates x, y, z of reference point (e.g. source)
+ * * \a Reference \a Weight : lower weight bound at reference point (default 0.5)
+ * * \a Maximum \a Error : voxels with larger relative error are switched off (default 0.5)
+ * * \a Smoothing \a Passes : number of smoothing passes (default 1)
+ * * \a Maximum \a Ratio : largest ratio of lower bounds of neighbouring voxels (default 10)
+ * * \a Number \a of \a Threads : number of threads (0 means number of CPU cores)
+ *
+ * See \ref WeightWindowGenerator.
+ */
+void processWeightWindow(Config* config)
+{
+	TString filename              = config->get      ("File Name"        , "");
+	TString outfilename           = config->get      ("Outputfile Name"  , "wwinp");
+	int tallyNumber               = config->get      ("Tally Number"     , 0);
+	std::vector<double> refPoint  = config->getDouble("Reference Point"  , ',');
+	double refWeight              = config->get      ("Reference Weight" , 0.5);
+	double maxError               = config->get      ("Maximum Error"    , 0.5);
+	int npass                     = config->get      ("Smoothing Passes" , 1);
+	double maxRatio               = config->get      ("Maximum Ratio"    , 10.);
+	int nthreads                  = config->get      ("Number of Threads", 0);
+
+	if(refPoint.size() != 3) {
+		ERROR("Reference point needs 3 coordinates!");
+		return;
+	}
+	MESSAGE("Read meshtally file...");
+	TH1::AddDirectory(kFALSE);
+	MeshTallyReader reader;
+	reader.read(filename);
+	reader.makeHisto();
+	const std::vector<MeshTallyData>& tallies = reader.getTallies();
+	const MeshTallyData* tally = 0;
+	for(size_t i = 0; i < tallies.size() && !tally; ++i)
+		if(tallyNumber == 0 || tallies[i].number == tallyNumber)
+			tally = &tallies[i];
+	if(!tally) {
+		ERROR( TString::Format( "No mesh tally %d in file '%s'", tallyNumber, filename.Data() ) );
+		return;
+	}
+
+	MESSAGE( TString::Format( "Make weight windows of mesh tally %d...", tally->number ) );
+	WeightWindowGenerator generator(nthreads);
+	generator.setReference(refPoint[0], refPoint[1], refPoint[2], refWeight);
+	generator.setMaxError(maxError);
+	generator.setSmoothing(npass);
+	generator.setMaxRatio(maxRatio);
+	if(generator.generate(*tally))
+		generator.write(outfilename);
+	TH1::AddDirectory(kTRUE);
+}
+
 /***************************************************************************/
 /**
  * This is the function for printing MCNP ANALYSIS module information.
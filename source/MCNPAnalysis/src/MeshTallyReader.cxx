@@ -4,22 +4,100 @@
  * \date     30-03-2015
  *
  * \file     MeshTallyReader.cxx
- * 
+ *
  */
 
 #include "MeshTallyReader.h"
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+/***************************************************************************/
+/**
+ * This function returns the index of the bin (defined by boundaries \a edge)
+ * which contains the value \a c. The bin \a guess and the next one are
+ * checked first since column format lines usually come in bin order.
+ */
+static int findBin(const std::vector<double>& edge, double c, int guess)
+{
+	int n = (int)edge.size()-1;
+	if(guess >= 0 && guess < n && c >= edge[guess] && c <= edge[guess+1])
+		return guess;
+	if(guess+1 >= 0 && guess+1 < n && c >= edge[guess+1] && c <= edge[guess+2])
+		return guess+1;
+	int i = (int)( std::upper_bound(edge.begin(), edge.end(), c) - edge.begin() ) - 1;
+	return ( i < 0 ? 0 : ( i >= n ? n-1 : i ) );
+}
 
 /***************************************************************************/
 /**
- * This is construtor of MeshTallyReader class, it initializes axis boundary 
- * values and \ref m_histoname, \ref message members.
+ * This is construtor of MeshTallyReader class, it initializes reading
+ * state and \ref m_histoname, \ref message members.
  */
-MeshTallyReader::MeshTallyReader() : m_histoname("meshtal"),message("MeshTallyReader") 
+MeshTallyReader::MeshTallyReader() : m_current(0), m_histoname("meshtal"), nps(0.), m_storeDir(0), m_tileSize(32), m_cacheSize(64), m_sparseBlock(0), m_pyramidLevels(0), m_pooling("mean"), message("MeshTallyReader")
 {
-	xbin = 1; xlow = 0.; xhigh = 1.;
-	ybin = 1; ylow = 0.; yhigh = 1.;
-	zbin = 1; zlow = 0.; zhigh = 1.;
 	plane = NONE;
+	m_slice = -1;
+	m_row = 0;
+	m_ebin = 0;
+	m_colE = -1; m_colX = -1; m_colY = -1; m_colZ = -1; m_colVal = -1; m_colErr = -1; m_ncol = 0;
+	m_ix = 0; m_iy = 0; m_iz = 0;
+}
+
+/***************************************************************************/
+/**
+ * This is destructor of MeshTallyReader class, it deletes all mesh
+ * histograms, their pyramid levels, out-of-core and block-sparse meshes.
+ */
+MeshTallyReader::~MeshTallyReader()
+{
+	for(size_t i = 0; i < m_tally.size(); ++i) {
+		for(size_t j = 0; j < m_tally[i].hist.size(); ++j)
+			delete m_tally[i].hist[j];
+		for(size_t j = 0; j < m_tally[i].store.size(); ++j)
+			delete m_tally[i].store[j];
+		for(size_t j = 0; j < m_tally[i].sparse.size(); ++j)
+			delete m_tally[i].sparse[j];
+	}
+	for(size_t i = 0; i < m_pyramid.size(); ++i)
+		for(size_t j = 0; j < m_pyramid[i].size(); ++j)
+			delete m_pyramid[i][j];
+}
+
+/***************************************************************************/
+/**
+ * This method makes \ref read() write the meshes to \ref MeshStore objects
+ * in directory \a dir, tile by tile, so that only \a cache tiles of each
+ * mesh are kept in memory. It must be called before \ref read().
+ */
+void MeshTallyReader::setStore(TDirectory* dir, int tile, int cache)
+{
+	m_storeDir  = dir;
+	m_tileSize  = tile;
+	m_cacheSize = cache;
+}
+
+/***************************************************************************/
+/**
+ * This method makes \ref read() write the meshes to \ref SparseMesh objects
+ * with blocks of \a block bins on each axis; zero values do not allocate
+ * blocks, so empty regions of the meshes take no memory. It must be called
+ * before \ref read().
+ */
+void MeshTallyReader::setSparse(int block)
+{
+	m_sparseBlock = block;
+}
+
+/***************************************************************************/
+/**
+ * This method makes \ref makeHisto() build \a nlevels downsampled levels
+ * of each histogram with \a pooling method.
+ */
+void MeshTallyReader::setPyramid(int nlevels, TString pooling)
+{
+	m_pyramidLevels = nlevels;
+	m_pooling       = pooling;
 }
 
 /***************************************************************************/
@@ -46,10 +124,24 @@ void MeshTallyReader::read(TString filename)
 	std::string line;
 	while( std::getline(infile, line) ) {
 		++n_line;
+		if(line.find(" Mesh Tally Number") != std::string::npos) {
+			m_tally.push_back( MeshTallyData() );
+			m_current = &m_tally.back();
+			m_current->number = 0;
+			plane = NONE;
+			m_slice = -1;
+			m_row = 0;
+			m_ebin = 0;
+			tag = INFO;
+		}
 		if(line.find(" Tally bin boundaries:") != std::string::npos) {
 			tag = BOUND;
 			continue;
 		}
+		if(!m_current) {
+			process(tag, line);
+			continue;
+		}
 		if(line.find("Tally Results:") != std::string::npos) {
 			if(plane == NONE && line.find("X (across) by Y (down)") != std::string::npos)
 				plane = XY;
@@ -57,27 +149,42 @@ void MeshTallyReader::read(TString filename)
 				plane = YZ;
 			if(plane == NONE && line.find("X (across) by Z (down)") != std::string::npos)
 				plane = XZ;
+			if(m_slice < 0) m_slice = 0;
+			m_row = 0;
 			tag = VALUE;
 			std::getline(infile, line);
 			continue;
 		}
 		if(line.find("Relative Errors") != std::string::npos) {
+			m_row = 0;
 			tag = ERROR; 
 			std::getline(infile, line);
 			continue;
 		}
+		if(line.find("Result") != std::string::npos && line.find("Rel Error") != std::string::npos) {
+			readColumnHeader(line);
+			tag = COLUMN;
+			continue;
+		}
+		if(line.find("Energy Bin") != std::string::npos) {
+			if(line.find("Total") != std::string::npos)
+				m_ebin = (int)m_current->eedge.size()-1;
+			else if(m_slice >= 0)
+				++m_ebin;
+			m_slice = -1;
+			tag = INFO;
+			continue;
+		}
 		if(line.find("X bin:") != std::string::npos || line.find("Y bin:") != std::string::npos || line.find("Z bin:") != std::string::npos) {
-			if(tag == ERROR) {
-				m_meshVal.push_back(m_val);  m_val.clear();
-				m_meshErr.push_back(m_err);  m_err.clear();
-				tag = INFO;
-			}
+			++m_slice;
+			m_row = 0;
+			tag = INFO;
 			continue;
 		}
 		process(tag, line);
 	}
-	m_meshVal.push_back(m_val);  m_val.clear();
-	m_meshErr.push_back(m_err);  m_err.clear();
+	finalize();
+	INFO( Form("Read %d mesh tallies",(int)m_tally.size()) );
 }
 
 /***************************************************************************/
@@ -86,7 +193,7 @@ void MeshTallyReader::read(TString filename)
  * type described in \a tag argument.
  */
 void MeshTallyReader::process(Tag tag, std::string line)
-{	
+{
 	switch(tag) {
 		case INFO:
 			readInfo(line);
@@ -100,6 +207,9 @@ void MeshTallyReader::process(Tag tag, std::string line)
 		case ERROR:
 			readError(line);
 			break;
+		case COLUMN:
+			readColumn(line);
+			break;
 		default:
 			break;
 	}
@@ -114,12 +224,19 @@ void MeshTallyReader::readInfo(std::string line)
 	if(line.find(" Number of histories used for normalizing tallies =") != std::string::npos) {
 		line.erase(0,51);
 		std::istringstream(line) >> nps;
-		INFO( Form("Number of histories used for normalizing tallies = %d",nps) );
+		INFO( Form("Number of histories used for normalizing tallies = %.0f",nps) );
 	}
+	if(!m_current)
+		return;
 	if(line.find(" Mesh Tally Number") != std::string::npos) {
 		line.erase(0,19);
-		std::istringstream(line) >> tally;
-		INFO( Form("Mesh Tally Number = %d",tally) );
+		std::istringstream(line) >> m_current->number;
+		INFO( Form("Mesh Tally Number = %d",m_current->number) );
+	}
+	if(line.find("mesh tally.") != std::string::npos) {
+		std::string particle;
+		std::istringstream(line) >> particle;
+		m_current->particle = particle;
 	}
 }
 
@@ -130,81 +247,493 @@ void MeshTallyReader::readInfo(std::string line)
 void MeshTallyReader::readBound(std::string line)
 {
 	StringParser parser;
-	std::vector<double> values;
+	if(!m_current)
+		return;
 	if(line.find("    X direction:") != std::string::npos) {
 		line.erase(0,16);
-		values = parser.getDouble(line);
-		xbin = values.size()-1; xlow = values[0]; xhigh = values[xbin];
-		INFO( Form("Number of X bins = %d , from %lf to %lf",xbin,xlow,xhigh) );
+		m_current->xedge = parser.getDouble(line);
+		INFO( Form("Number of X bins = %d , from %lf to %lf",(int)m_current->xedge.size()-1,m_current->xedge.front(),m_current->xedge.back()) );
 	}
 	if(line.find("    Y direction:") != std::string::npos) {
 		line.erase(0,16);
-		values = parser.getDouble(line);
-		ybin = values.size()-1; ylow = values[0]; yhigh = values[ybin];
-		INFO( Form("Number of Y bins = %d , from %lf to %lf",ybin,ylow,yhigh) );
+		m_current->yedge = parser.getDouble(line);
+		INFO( Form("Number of Y bins = %d , from %lf to %lf",(int)m_current->yedge.size()-1,m_current->yedge.front(),m_current->yedge.back()) );
 	}
 	if(line.find("    Z direction:") != std::string::npos) {
 		line.erase(0,16);
-		values = parser.getDouble(line);
-		zbin = values.size()-1; zlow = values[0]; zhigh = values[zbin];
-		INFO( Form("Number of Z bins = %d , from %lf to %lf",zbin,zlow,zhigh) );
+		m_current->zedge = parser.getDouble(line);
+		INFO( Form("Number of Z bins = %d , from %lf to %lf",(int)m_current->zedge.size()-1,m_current->zedge.front(),m_current->zedge.back()) );
 	}
+	if(line.find("Energy bin boundaries:") != std::string::npos) {
+		line.erase(0,line.find(':')+1);
+		m_current->eedge = parser.getDouble(line);
+		INFO( Form("Number of energy bins = %d",(int)m_current->eedge.size()-1) );
+	}
+	if(line.find("R direction") != std::string::npos || line.find("Theta direction") != std::string::npos)
+		WARN( Form("Cylindrical mesh of tally %d is not supported",m_current->number) );
 }
 
 /***************************************************************************/
 /**
- * This method reads MCNP mesh values.
+ * This method reads MCNP mesh values into the bin array of the histogram
+ * of current energy bin.
  */
 void MeshTallyReader::readValue(std::string line)
 {
-	StringParser parser;
-	std::vector<double> data = parser.getDouble(line);
-	if(data.size() == 0)
+	if(m_storeDir || m_sparseBlock > 0) {
+		readRow(line, (float*)0, false);
 		return;
-	data.erase(data.begin());
-	m_val.push_back(data);
+	}
+	TH3F* hist = getHisto(m_ebin);
+	if(hist)
+		readRow(line, hist->GetArray(), false);
 }
 
 /***************************************************************************/
 /**
- * This method reads MCNP mesh value errors.
+ * This method reads MCNP mesh relative errors into the error array of the
+ * histogram of current energy bin, they are converted to bin errors by
+ * \ref finalize().
  */
 void MeshTallyReader::readError(std::string line)
 {
-	StringParser parser;
-	std::vector<double> data = parser.getDouble(line);
-	if(data.size() == 0)
+	if(m_storeDir || m_sparseBlock > 0) {
+		readRow(line, (double*)0, true);
 		return;
-	data.erase(data.begin());
-	m_err.push_back(data);
+	}
+	TH3F* hist = getHisto(m_ebin);
+	if(hist)
+		readRow(line, hist->GetSumw2()->GetArray(), true);
 }
 
 /***************************************************************************/
 /**
- * This method extracts MCNP mesh values to histograms and write to a root file.
+ * This method finds the positions of energy, coordinates, result and
+ * relative error in the header line of column format, e.g.
+ *
+ *    Energy      X      Y      Z     Result     Rel Error     Volume    Rslt * Vol
  */
-void MeshTallyReader::extractHisto(TString filename, bool isUpdate)
+void MeshTallyReader::readColumnHeader(std::string line)
+{
+	std::istringstream iss(line);
+	std::string word;
+	m_colE = -1; m_colX = -1; m_colY = -1; m_colZ = -1; m_colVal = -1; m_colErr = -1;
+	int col = 0;
+	while(iss >> word) {
+		if(word == "Error" || word == "*" || word == "Vol")
+			continue;
+		if(word == "Energy") m_colE   = col;
+		if(word == "X")      m_colX   = col;
+		if(word == "Y")      m_colY   = col;
+		if(word == "Z")      m_colZ   = col;
+		if(word == "Result") m_colVal = col;
+		if(word == "Rel")    m_colErr = col;
+		++col;
+	}
+	m_ncol = col;
+	if(m_colX < 0 || m_colY < 0 || m_colZ < 0 || m_colVal < 0 || m_colErr < 0) {
+		WARN("Unsupported column format: "+TString(line));
+		m_ncol = 0;
+	}
+	m_ix = 0; m_iy = 0; m_iz = 0;
+}
+
+/***************************************************************************/
+/**
+ * This method reads one line of column format. The voxel and energy bin
+ * are found from the coordinates, so the lines can come in any order.
+ * The energy column holds the upper boundary of energy bin or "Total".
+ */
+void MeshTallyReader::readColumn(std::string line)
+{
+	const int maxcol = 16;
+	if(m_ncol == 0 || m_ncol > maxcol)
+		return;
+	double number[maxcol];
+	int nE = (int)m_current->eedge.size()-1;
+	int ebin = -1;
+	const char* p = line.c_str();
+	char* end = 0;
+	for(int col = 0; col < m_ncol; ++col) {
+		while(*p && isspace(*p)) ++p;
+		if(col == m_colE && isalpha(*p)) {
+			ebin = nE;
+			while(*p && !isspace(*p)) ++p;
+			continue;
+		}
+		number[col] = strtod(p, &end);
+		if(end == p)
+			return;
+		p = end;
+	}
+	if(ebin < 0) {
+		ebin = 0;
+		if(m_colE >= 0 && nE > 1) {
+			const std::vector<double>& e = m_current->eedge;
+			ebin = (int)( std::lower_bound(e.begin(), e.end(), number[m_colE]) - e.begin() ) - 1;
+			if(ebin < 0)    ebin = 0;
+			if(ebin > nE-1) ebin = nE-1;
+		}
+	}
+
+	m_ix = findBin(m_current->xedge, number[m_colX], m_ix);
+	m_iy = findBin(m_current->yedge, number[m_colY], m_iy);
+	m_iz = findBin(m_current->zedge, number[m_colZ], m_iz);
+	if(m_storeDir) {
+		MeshStore* store = getStore(ebin);
+		if(store) {
+			store->setBinContent(m_ix+1, m_iy+1, m_iz+1, number[m_colVal]);
+			store->setBinError(m_ix+1, m_iy+1, m_iz+1, number[m_colErr]*number[m_colVal]);
+		}
+		return;
+	}
+	if(m_sparseBlock > 0) {
+		SparseMesh* sparse = getSparse(ebin);
+		if(sparse) {
+			sparse->setBinContent(m_ix+1, m_iy+1, m_iz+1, number[m_colVal]);
+			sparse->setBinError(m_ix+1, m_iy+1, m_iz+1, number[m_colErr]*number[m_colVal]);
+		}
+		return;
+	}
+	TH3F* hist = getHisto(ebin);
+	if(!hist)
+		return;
+	int nx = (int)m_current->xedge.size()+1, ny = (int)m_current->yedge.size()+1;
+	int bin = (m_ix+1) + nx*( (m_iy+1) + ny*(m_iz+1) );
+	hist->GetArray()[bin] = (float)number[m_colVal];
+	hist->GetSumw2()->GetArray()[bin] = number[m_colErr];
+}
+
+/***************************************************************************/
+/**
+ * This method returns the histogram of energy bin \a ebin of the current
+ * tally. The histogram (with error array) is created the first time it
+ * is needed, when the axis binning is already known.
+ */
+TH3F* MeshTallyReader::getHisto(int ebin)
+{
+	MeshTallyData* t = m_current;
+	TString name, title;
+	if(!makeName(ebin, name, title))
+		return 0;
+	if((int)t->hist.size() <= ebin)
+		t->hist.resize(ebin+1, 0);
+	if(t->hist[ebin])
+		return t->hist[ebin];
+
+	int nx = (int)t->xedge.size()-1, ny = (int)t->yedge.size()-1, nz = (int)t->zedge.size()-1;
+	TH3F* hist = new TH3F(name, title, nx, &t->xedge[0], ny, &t->yedge[0], nz, &t->zedge[0]);
+	hist->Sumw2();
+	t->hist[ebin] = hist;
+	DEBUG( Form("Allocated mesh of %d x %d x %d bins for energy bin %d",nx,ny,nz,ebin) );
+	return hist;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the out-of-core mesh of energy bin \a ebin of the
+ * current tally, it is created in \ref m_storeDir the first time it is
+ * needed.
+ *
+ * The matrix format fills one whole slice at a time (values, then
+ * errors), so its tiles are one bin deep along the slice axis and the
+ * cache holds at least one layer of tiles; each tile is then loaded and
+ * written once per pass instead of cycling through the cache.
+ */
+MeshStore* MeshTallyReader::getStore(int ebin)
 {
-	HistoUtilities hutil;
-	TH3F* hist = 0;
+	MeshTallyData* t = m_current;
+	TString name, title;
+	if(!makeName(ebin, name, title))
+		return 0;
+	if((int)t->store.size() <= ebin)
+		t->store.resize(ebin+1, 0);
+	if(t->store[ebin])
+		return t->store[ebin];
+
+	int tile[3] = { m_tileSize, m_tileSize, m_tileSize };
+	int cache = m_cacheSize;
+	if(plane != NONE) {
+		int slice = (plane == XY ? 2 : (plane == YZ ? 0 : 1));
+		const std::vector<double>* edge[3] = { &t->xedge, &t->yedge, &t->zedge };
+		int layer = 1;
+		tile[slice] = 1;
+		for(int a = 0; a < 3; ++a)
+			if(a != slice)
+				layer *= ( (int)edge[a]->size()-1 + tile[a]-1 ) / tile[a];
+		cache = std::max(cache, layer);
+	}
+	MeshStore* store = new MeshStore();
+	store->setCacheSize(cache);
+	if(!store->create(m_storeDir, name, title, t->xedge, t->yedge, t->zedge, tile[0], tile[1], tile[2])) {
+		delete store;
+		return 0;
+	}
+	t->store[ebin] = store;
+	return store;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the block-sparse mesh of energy bin \a ebin of the
+ * current tally, it is created (with no block allocated) the first time it
+ * is needed.
+ */
+SparseMesh* MeshTallyReader::getSparse(int ebin)
+{
+	MeshTallyData* t = m_current;
+	TString name, title;
+	if(!makeName(ebin, name, title))
+		return 0;
+	if((int)t->sparse.size() <= ebin)
+		t->sparse.resize(ebin+1, 0);
+	if(t->sparse[ebin])
+		return t->sparse[ebin];
+
+	SparseMesh* sparse = new SparseMesh();
+	if(!sparse->create(name, title, t->xedge, t->yedge, t->zedge, m_sparseBlock)) {
+		delete sparse;
+		return 0;
+	}
+	t->sparse[ebin] = sparse;
+	return sparse;
+}
+
+/***************************************************************************/
+/**
+ * This method checks that the current tally has axis binning and energy
+ * bin \a ebin, and gives the name and title of its mesh. The mesh of
+ * the first tally (total over energy) is named after the file.
+ */
+bool MeshTallyReader::makeName(int ebin, TString& name, TString& title)
+{
+	MeshTallyData* t = m_current;
+	if(!t || t->xedge.size() < 2 || t->yedge.size() < 2 || t->zedge.size() < 2)
+		return false;
+	int nE = (t->eedge.size() < 2 ? 1 : (int)t->eedge.size()-1);
+	int nhist = (nE > 1 ? nE+1 : 1);
+	if(ebin < 0 || ebin >= nhist)
+		return false;
+
+	name = m_histoname;
+	if(t != &m_tally[0] || ebin != nhist-1)
+		name += TString::Format("_t%d", t->number);
+	if(ebin != nhist-1)
+		name += TString::Format("_e%d", ebin+1);
+	title = TString::Format("Mesh Tally %d", t->number);
+	if(t->particle != "")
+		title += " ("+t->particle+")";
+	if(ebin != nhist-1)
+		title += TString::Format(", E = %g - %g MeV", t->eedge[ebin], t->eedge[ebin+1]);
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the value (or the error from relative error \a value)
+ * of bin \a bin, given in TH3 bin order, of the out-of-core or
+ * block-sparse mesh of current energy bin.
+ */
+void MeshTallyReader::setStoreBin(int bin, double value, bool isError)
+{
+	int nx = (int)m_current->xedge.size()+1, ny = (int)m_current->yedge.size()+1;
+	int ix = bin % nx, iy = (bin / nx) % ny, iz = bin / (nx*ny);
+	if(m_sparseBlock > 0) {
+		SparseMesh* sparse = getSparse(m_ebin);
+		if(!sparse)
+			return;
+		if(isError)
+			sparse->setBinError(ix, iy, iz, value*sparse->getBinContent(ix, iy, iz));
+		else
+			sparse->setBinContent(ix, iy, iz, value);
+		return;
+	}
+	MeshStore* store = getStore(m_ebin);
+	if(!store)
+		return;
+	if(isError)
+		store->setBinError(ix, iy, iz, value*store->getBinContent(ix, iy, iz));
+	else
+		store->setBinContent(ix, iy, iz, value);
+}
+
+/***************************************************************************/
+/**
+ * This method parses one row of a matrix block and stores the values in 
+ * \a array at their final TH3 bin positions. The first number of the row 
+ * is the row coordinate and is skipped. Depending on the mesh plane, the 
+ * (across, down, slice) indices of matrix correspond to:
+ *  - XY : (X, Y, Z)
+ *  - YZ : (Y, Z, X)
+ *  - XZ : (X, Z, Y)
+ *
+ * For out-of-core or block-sparse meshes (\a array is 0) the values are
+ * given to \ref setStoreBin().
+ */
+template<class T> void MeshTallyReader::readRow(const std::string& line, T* array, bool isError)
+{
+	const char* p = line.c_str();
+	char* end = 0;
+	strtod(p, &end);
+	if(end == p)
+		return;
+	p = end;
+
+	int xbin = (int)m_current->xedge.size()-1;
+	int ybin = (int)m_current->yedge.size()-1;
+	int zbin = (int)m_current->zedge.size()-1;
+	int nx = xbin+2, nxy = (xbin+2)*(ybin+2);
+	int first = 0, stride = 1, ncol = 0;
 	if(plane == XY) {
-		TH3F *htmp = hutil.convert("", "Mesh Tally", m_meshVal, zlow, zhigh, ylow, yhigh, xlow, xhigh);
-		hist = hutil.changeAxis(htmp,"ZYX",m_histoname);
+		if(m_row >= ybin || m_slice >= zbin) return;
+		first = 1 + nx*(m_row+1) + nxy*(m_slice+1);  stride = 1;   ncol = xbin;
+	} else if(plane == YZ) {
+		if(m_row >= zbin || m_slice >= xbin) return;
+		first = (m_slice+1) + nx + nxy*(m_row+1);    stride = nx;  ncol = ybin;
+	} else if(plane == XZ) {
+		if(m_row >= zbin || m_slice >= ybin) return;
+		first = 1 + nx*(m_slice+1) + nxy*(m_row+1);  stride = 1;   ncol = xbin;
 	}
-	if(plane == YZ) {
-		TH3F *htmp = hutil.convert("", "Mesh Tally", m_meshVal, xlow, xhigh, zlow, zhigh, ylow, yhigh);
-		hist = hutil.changeAxis(htmp,"XZY",m_histoname);
+
+	for(int i = 0, bin = first; i < ncol; ++i, bin += stride) {
+		double value = strtod(p, &end);
+		if(end == p) {
+			WARN( Form("Incomplete mesh row %d in slice %d",m_row,m_slice) );
+			break;
+		}
+		if(array)
+			array[bin] = (T)value;
+		else
+			setStoreBin(bin, value, isError);
+		p = end;
 	}
-	if(plane == XZ) {
-		TH3F *htmp = hutil.convert("", "Mesh Tally", m_meshVal, ylow, yhigh, zlow, zhigh, xlow, xhigh);
-		hist = hutil.changeAxis(htmp,"YZX",m_histoname);
-	}	
+	++m_row;
+}
+
+/***************************************************************************/
+/**
+ * This method converts the relative errors kept in the error arrays of all
+ * histograms to squared absolute errors, so that \a GetBinError() returns
+ * the MCNP error (relative error x value). The out-of-core meshes are
+ * closed, i.e. their remaining tiles are written out.
+ */
+void MeshTallyReader::finalize()
+{
+	for(size_t i = 0; i < m_tally.size(); ++i) {
+		for(size_t j = 0; j < m_tally[i].hist.size(); ++j) {
+			TH3F* hist = m_tally[i].hist[j];
+			if(!hist) continue;
+			int ncells = hist->GetSize();
+			const float* val = hist->GetArray();
+			double* err = hist->GetSumw2()->GetArray();
+			for(int k = 0; k < ncells; ++k) {
+				double e = err[k]*val[k];
+				err[k] = e*e;
+			}
+			hist->SetEntries( (double)ncells );
+		}
+		for(size_t j = 0; j < m_tally[i].store.size(); ++j)
+			if(m_tally[i].store[j])
+				m_tally[i].store[j]->close();
+	}
+	m_current = 0;
+}
+
+/***************************************************************************/
+/**
+ * This method extracts MCNP mesh values to histograms and write to a root file.
+ */
+void MeshTallyReader::extractHisto(TString filename, bool isUpdate)
+{
+	makeHisto();
 	INFO("Writing out histograms to '"+filename+"'");
 	TFile* file;
 	if(isUpdate)
 	  file = TFile::Open(filename,"UPDATE");
 	else
 	  file = TFile::Open(filename,"RECREATE");
-	hist->Write();
+	writeHisto(file);
 	file->Close();
 }
+
+/***************************************************************************/
+/**
+ * This method checks the TH3F histograms with (X,Y,Z) axes which were filled
+ * by \ref read() and builds their pyramid levels. It does not touch any file,
+ * so it can be called from several threads at the same time (with
+ * \a TH1::AddDirectory(false)).
+ */
+void MeshTallyReader::makeHisto()
+{
+	if(getHistos().empty() && getStores().empty() && getSparses().empty())
+		ERROR("No rectangular mesh found, cannot create histogram for '"+m_histoname+"'");
+	if(m_pyramidLevels <= 0 || !m_pyramid.empty())
+		return;
+	MeshPyramid pyramid(m_pooling);
+	std::vector<TH3F*> hist = getHistos();
+	for(size_t i = 0; i < hist.size(); ++i)
+		m_pyramid.push_back( pyramid.build(hist[i], m_pyramidLevels) );
+}
+
+/***************************************************************************/
+/**
+ * This method returns the histograms of all tallies and energy bins.
+ */
+std::vector<TH3F*> MeshTallyReader::getHistos()
+{
+	std::vector<TH3F*> hist;
+	for(size_t i = 0; i < m_tally.size(); ++i)
+		for(size_t j = 0; j < m_tally[i].hist.size(); ++j)
+			if(m_tally[i].hist[j])
+				hist.push_back(m_tally[i].hist[j]);
+	return hist;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the out-of-core meshes of all tallies and energy bins.
+ */
+std::vector<MeshStore*> MeshTallyReader::getStores()
+{
+	std::vector<MeshStore*> store;
+	for(size_t i = 0; i < m_tally.size(); ++i)
+		for(size_t j = 0; j < m_tally[i].store.size(); ++j)
+			if(m_tally[i].store[j])
+				store.push_back(m_tally[i].store[j]);
+	return store;
+}
+
+/***************************************************************************/
+/**
+ * This method returns the block-sparse meshes of all tallies and energy bins.
+ */
+std::vector<SparseMesh*> MeshTallyReader::getSparses()
+{
+	std::vector<SparseMesh*> sparse;
+	for(size_t i = 0; i < m_tally.size(); ++i)
+		for(size_t j = 0; j < m_tally[i].sparse.size(); ++j)
+			if(m_tally[i].sparse[j])
+				sparse.push_back(m_tally[i].sparse[j]);
+	return sparse;
+}
+
+/***************************************************************************/
+/**
+ * This method writes the mesh histograms (and their pyramid levels) to an
+ * opened root file. Block-sparse meshes are written with
+ * \ref SparseMesh::write(), each in its own directory.
+ */
+void MeshTallyReader::writeHisto(TFile* file)
+{
+	std::vector<TH3F*> hist = getHistos();
+	MeshPyramid pyramid(m_pooling);
+	file->cd();
+	for(size_t i = 0; i < hist.size(); ++i) {
+		hist[i]->Write();
+		if(i < m_pyramid.size())
+			pyramid.write(hist[i], m_pyramid[i], file);
+	}
+	std::vector<SparseMesh*> sparse = getSparses();
+	for(size_t i = 0; i < sparse.size(); ++i)
+		sparse[i]->write(file);
+}
@@ -31,6 +31,17 @@ void TallyReader::read(TString filename)
 	std::string line;
 	while(std::getline(infile, line)) {
 		++n_line;
+		if(line.find("1tally fluctuation charts") != std::string::npos) {
+			tag = TFC;
+			continue;
+		}
+		if(tag == TFC) {
+			if(line.find("***") == std::string::npos && line.find("dump no.") == std::string::npos) {
+				process(tag, line);
+				continue;
+			}
+			tag = INFO;
+		}
 		if(line.find("1tally ") != std::string::npos && line.find("nps =") != std::string::npos) {
 			tag = TALLYINFO;
 		}
@@ -48,6 +59,7 @@ void TallyReader::read(TString filename)
 		process(tag, line);
 	}
 	INFO( Form( "Found %d tallies in total",(int)tally.size() ) );
+	INFO( Form( "Found %d tally fluctuation charts, computer time = %.2f minutes",(int)tfc_tally.size(),ctm ) );
 }
 
 /***************************************************************************/
@@ -67,6 +79,9 @@ void TallyReader::process(Tag tag, std::string line)
 		case VALUE:
 			readValue(line);
 			break;
+		case TFC:
+			readTFC(line);
+			break;
 		default:
 			break;
 	}
@@ -74,7 +89,7 @@ void TallyReader::process(Tag tag, std::string line)
 
 /***************************************************************************/
 /**
- * This method reads information lines, e.g. \ref raw_nps,...
+ * This method reads information lines, e.g. \ref raw_nps, \ref ctm,...
  */
 void TallyReader::readInfo(std::string line)
 {
@@ -82,6 +97,11 @@ void TallyReader::readInfo(std::string line)
 		line.erase(0,38);
 		std::istringstream(line) >> raw_nps;
 	}
+	size_t pos = line.find(" computer time =");
+	if(pos != std::string::npos) {
+		line.erase(0,pos+16);
+		std::istringstream(line) >> ctm;
+	}
 }
 
 /***************************************************************************/
@@ -118,6 +138,64 @@ void TallyReader::readValue(std::string line)
 	}
 }
 
+/***************************************************************************/
+/**
+ * This method reads tally fluctuation chart lines. A chart is printed in 
+ * blocks of (usually 3) tallies; the block header gives the tally numbers
+ * and each following line has the nps and 5 values (mean, error, vov, 
+ * slope, fom) for each tally of the block.
+ */
+void TallyReader::readTFC(std::string line)
+{
+	StringParser parser;
+	if(line.find("tally") != std::string::npos) {
+		tfc_block.clear();
+		std::vector<std::string> words = parser.getWord(line);
+		for(size_t i = 0; i+1 < words.size(); ++i) {
+			if(words[i] != "tally") continue;
+			int n = atoi(words[i+1].c_str());
+			int index = -1;
+			for(size_t j = 0; j < tfc_tally.size(); ++j)
+				if(tfc_tally[j] == n) index = (int)j;
+			if(index < 0) {
+				tfc_tally.push_back(n);
+				tfc.push_back( std::vector<TFCEntry>() );
+				index = (int)tfc_tally.size()-1;
+			} else
+				tfc[index].clear();
+			tfc_block.push_back(index);
+		}
+		return;
+	}
+	std::vector<double> numbers = parser.getDouble(line);
+	if(numbers.size() < 6 || line.find("nps") != std::string::npos)
+		return;
+	size_t ntally = (numbers.size()-1)/5;
+	for(size_t i = 0; i < ntally && i < tfc_block.size(); ++i) {
+		TFCEntry entry;
+		entry.nps   = numbers[0];
+		entry.mean  = numbers[5*i+1];
+		entry.error = numbers[5*i+2];
+		entry.vov   = numbers[5*i+3];
+		entry.slope = numbers[5*i+4];
+		entry.fom   = numbers[5*i+5];
+		tfc[tfc_block[i]].push_back(entry);
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method returns the tally fluctuation chart of tally number \a n.
+ */
+std::vector<TFCEntry> TallyReader::getTFC(int n)
+{
+	for(size_t i = 0; i < tfc_tally.size(); ++i)
+		if(tfc_tally[i] == n)
+			return tfc[i];
+	WARN( Form( "No tally fluctuation chart found for tally %d", n ) );
+	return std::vector<TFCEntry>();
+}
+
 /***************************************************************************/
 /**
  * This method extracts MCNP output results to histograms and write to a root file.
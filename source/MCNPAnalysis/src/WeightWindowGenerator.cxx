@@ -0,0 +1,365 @@
+/**
+ * \author   Dang Nguyen Phuong (dnphuong1984@gmail.com)
+ * \version  0.1
+ * \date     19-10-2026
+ *
+ * \file     WeightWindowGenerator.cxx
+ *
+ */
+
+#include "WeightWindowGenerator.h"
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <TDatime.h>
+
+static const float kOff = -std::numeric_limits<float>::infinity();
+
+/***************************************************************************/
+/**
+ * This function smooths the logarithms of bounds of a line with a [1 2 1]
+ * filter; voxels which are off are neither changed nor used.
+ */
+static void smoothLine(float* L, int stride, int n)
+{
+	std::vector<float> tmp(n);
+	for (int i = 0; i < n; ++i) {
+		float c = L[i*stride];
+		if (c == kOff) {
+			tmp[i] = c;
+			continue;
+		}
+		float sum = 2.f*c, weight = 2.f;
+		if (i > 0 && L[(i-1)*stride] != kOff) {
+			sum += L[(i-1)*stride];
+			weight += 1.f;
+		}
+		if (i+1 < n && L[(i+1)*stride] != kOff) {
+			sum += L[(i+1)*stride];
+			weight += 1.f;
+		}
+		tmp[i] = sum/weight;
+	}
+	for (int i = 0; i < n; ++i)
+		L[i*stride] = tmp[i];
+}
+
+/***************************************************************************/
+/**
+ * This function raises the logarithms of bounds of a line, so that
+ * neighbouring voxels differ by at most \a logR; it returns true if a
+ * bound is changed.
+ */
+static bool clampLine(float* L, int stride, int n, float logR)
+{
+	bool changed = false;
+	for (int i = 1; i < n; ++i) {
+		float& c = L[i*stride];
+		float prev = L[(i-1)*stride];
+		if (c != kOff && prev != kOff && c < prev - logR) {
+			c = prev - logR;
+			changed = true;
+		}
+	}
+	for (int i = n-2; i >= 0; --i) {
+		float& c = L[i*stride];
+		float next = L[(i+1)*stride];
+		if (c != kOff && next != kOff && c < next - logR) {
+			c = next - logR;
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+/***************************************************************************/
+/**
+ * This function checks if the bins of an axis have the same width.
+ */
+static bool isUniform(const std::vector<double>& edge)
+{
+	double width = (edge.back() - edge.front()) / (edge.size()-1);
+	for (size_t i = 1; i < edge.size(); ++i)
+		if (std::fabs(edge[i] - edge[i-1] - width) > 1.e-6*std::fabs(width))
+			return false;
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * The constructor sets the default parameters: reference point at the
+ * origin with lower bound 0.5, relative errors up to 0.5, one smoothing
+ * pass and ratios of neighbouring bounds up to 10.
+ */
+WeightWindowGenerator::WeightWindowGenerator(int nthreads) : m_refWeight(0.5), m_maxError(0.5), m_smoothing(1), m_maxRatio(10.),
+		m_photon(false), m_pool(nthreads), message("WeightWindowGenerator")
+{
+	m_ref[0] = m_ref[1] = m_ref[2] = 0.;
+	m_n[0] = m_n[1] = m_n[2] = 0;
+}
+
+/***************************************************************************/
+/**
+ * This method sets the reference point and its lower weight bound.
+ */
+void WeightWindowGenerator::setReference(double x, double y, double z, double weight)
+{
+	m_ref[0] = x;
+	m_ref[1] = y;
+	m_ref[2] = z;
+	m_refWeight = weight;
+}
+
+/***************************************************************************/
+/**
+ * This method splits the lines of voxels along \a axis between the threads.
+ */
+void WeightWindowGenerator::forLines(std::vector<float>& window, int axis, std::function<void(float*,int,int)> job)
+{
+	int nx = m_n[0], nxy = m_n[0]*m_n[1];
+	int stride = (axis == 0 ? 1 : (axis == 1 ? nx : nxy));
+	int nlines = nxy*m_n[2] / m_n[axis];
+	m_pool.parallelFor(0, nlines, [&](int first, int last) {
+		for (int l = first; l < last; ++l) {
+			int start;
+			if      (axis == 0) start = l*nx;
+			else if (axis == 1) start = (l % nx) + (l / nx)*nxy;
+			else                start = l;
+			job(&window[start], stride, m_n[axis]);
+		}
+	});
+}
+
+/***************************************************************************/
+/**
+ * This method fills the logarithms of the flux of valid voxels, smooths
+ * and clamps them, and converts them to lower bounds normalized at the
+ * reference point.
+ */
+bool WeightWindowGenerator::makeGroup(TH3F* hist, std::vector<float>& window)
+{
+	int nx = m_n[0], ny = m_n[1], nz = m_n[2];
+	window.assign((size_t)nx*ny*nz, kOff);
+
+	// reference voxel
+	int ref[3];
+	for (int a = 0; a < 3; ++a) {
+		const std::vector<double>& e = m_edge[a];
+		if (m_ref[a] < e.front() || m_ref[a] > e.back()) {
+			ERROR( TString::Format( "Reference point is outside of mesh '%s'", hist->GetName() ) );
+			return false;
+		}
+		ref[a] = std::min( (int)( std::upper_bound(e.begin(), e.end(), m_ref[a]) - e.begin() ) - 1, m_n[a]-1 );
+	}
+	int refIndex = ref[0] + nx*(ref[1] + ny*ref[2]);
+
+	// logarithm of flux of valid voxels
+	const float* value = hist->GetArray();
+	const double* error2 = (hist->GetSumw2N() > 0 ? hist->GetSumw2()->GetArray() : 0);
+	float* first = &window[0];
+	double maxError = m_maxError;
+	int sy = nx+2, sz = (nx+2)*(ny+2);
+	forLines(window, 0, [=](float* L, int, int n) {
+		int line = (int)(L - first) / nx;
+		int src = 1 + sy*(line % ny + 1) + sz*(line / ny + 1);
+		for (int i = 0; i < n; ++i) {
+			double v = value[src+i];
+			bool valid = (v > 0. && (!error2 || std::sqrt(error2[src+i]) <= maxError*v));
+			L[i] = (valid ? (float)std::log(v) : kOff);
+		}
+	});
+	if (window[refIndex] == kOff) {
+		WARN( TString::Format( "Reference voxel (%d,%d,%d) of mesh '%s' has no valid flux", ref[0]+1, ref[1]+1, ref[2]+1, hist->GetName() ) );
+		return false;
+	}
+
+	// smooth and clamp ratios
+	for (int pass = 0; pass < m_smoothing; ++pass)
+		for (int a = 0; a < 3; ++a)
+			forLines(window, a, smoothLine);
+	if (m_maxRatio > 1.) {
+		// voxels which are off block the sweeps, so raising bounds along one
+		// axis can break the limit along another one: repeat until stable
+		float logR = (float)std::log(m_maxRatio);
+		std::atomic<bool> changed(true);
+		int npass = 0;
+		while (changed) {
+			changed = false;
+			for (int a = 0; a < 3; ++a)
+				forLines(window, a, [logR,&changed](float* L, int stride, int n) {
+					if (clampLine(L, stride, n, logR))
+						changed = true;
+				});
+			++npass;
+		}
+		DEBUG( TString::Format( "Ratio limit of mesh '%s' reached after %d passes", hist->GetName(), npass ) );
+	}
+
+	// normalize at reference voxel
+	float shift = (float)std::log(m_refWeight) - window[refIndex];
+	forLines(window, 0, [shift](float* L, int, int n) {
+		for (int i = 0; i < n; ++i)
+			L[i] = (L[i] == kOff ? 0.f : std::exp(L[i] + shift));
+	});
+	return true;
+}
+
+/***************************************************************************/
+/**
+ * This method makes the windows of all energy groups of the tally. For a
+ * tally with energy bins, the meshes of the energy bins are used (without
+ * the total mesh), otherwise the single mesh.
+ */
+bool WeightWindowGenerator::generate(const MeshTallyData& tally)
+{
+	m_window.clear();
+	m_energy.clear();
+	const std::vector<double>* edge[3] = { &tally.xedge, &tally.yedge, &tally.zedge };
+	for (int a = 0; a < 3; ++a) {
+		if (edge[a]->size() < 2) {
+			ERROR( TString::Format( "Mesh tally %d has no rectangular mesh", tally.number ) );
+			return false;
+		}
+		m_edge[a] = *edge[a];
+		m_n[a] = (int)m_edge[a].size()-1;
+	}
+	TString particle = tally.particle;
+	particle.ToLower();
+	m_photon = particle.BeginsWith("photon");
+
+	int nE = (int)tally.eedge.size()-1;
+	int ngroup = (nE > 1 ? nE : 1);
+	if ((int)tally.hist.size() < ngroup) {
+		ERROR( TString::Format( "Mesh tally %d has no histograms", tally.number ) );
+		return false;
+	}
+	int nvalid = 0;
+	for (int g = 0; g < ngroup; ++g) {
+		TH3F* hist = tally.hist[g];
+		m_energy.push_back( nE > 1 ? tally.eedge[g+1] : (nE == 1 ? tally.eedge[1] : 100.) );
+		m_window.push_back( std::vector<float>() );
+		if (!hist || hist->GetXaxis()->GetNbins() != m_n[0] || hist->GetYaxis()->GetNbins() != m_n[1] || hist->GetZaxis()->GetNbins() != m_n[2]) {
+			ERROR( TString::Format( "Wrong histogram of energy group %d of mesh tally %d", g+1, tally.number ) );
+			return false;
+		}
+		if (makeGroup(hist, m_window.back()))
+			++nvalid;
+		else {
+			WARN( TString::Format( "Weight windows of energy group %d are switched off", g+1 ) );
+			m_window.back().assign((size_t)m_n[0]*m_n[1]*m_n[2], 0.f);
+		}
+	}
+	INFO( TString::Format( "Made weight windows of %d voxels in %d of %d energy groups", m_n[0]*m_n[1]*m_n[2], nvalid, ngroup ) );
+	return (nvalid > 0);
+}
+
+/***************************************************************************/
+/**
+ * This method writes the values in blocks of lines, which are formatted
+ * by the threads and written in order.
+ */
+void WeightWindowGenerator::writeValues(std::ostream& out, const std::vector<float>& value)
+{
+	const int kLines = 8192;
+	int nlines = ((int)value.size() + 5) / 6;
+	int nblocks = (nlines + kLines - 1) / kLines;
+	int nround = 4*m_pool.size();
+	std::vector<std::string> text(nround);
+	for (int b0 = 0; b0 < nblocks; b0 += nround) {
+		int nb = std::min(nround, nblocks - b0);
+		m_pool.parallelFor(0, nb, [&](int first, int last) {
+			char buf[16];
+			for (int b = first; b < last; ++b) {
+				std::string& s = text[b];
+				s.clear();
+				size_t begin = (size_t)(b0+b)*kLines*6;
+				size_t end = std::min(value.size(), begin + (size_t)kLines*6);
+				for (size_t i = begin; i < end; ++i) {
+					snprintf(buf, sizeof(buf), " %12.5e", value[i]);
+					s += buf;
+					if ((i+1) % 6 == 0 || i+1 == end)
+						s += '\n';
+				}
+			}
+		}, 1);
+		for (int b = 0; b < nb; ++b)
+			out << text[b];
+	}
+}
+
+/***************************************************************************/
+/**
+ * This method writes the coarse meshes of an axis: the origin and, for
+ * each coarse mesh, fine mesh ratio, upper boundary and number of fine
+ * meshes.
+ */
+void WeightWindowGenerator::writeAxis(std::ostream& out, const std::vector<double>& edge)
+{
+	std::vector<float> value(1, edge.front());
+	int n = (int)edge.size()-1;
+	if (isUniform(edge)) {
+		value.push_back(1.f);
+		value.push_back(edge.back());
+		value.push_back(n);
+	} else
+		for (int i = 1; i <= n; ++i) {
+			value.push_back(1.f);
+			value.push_back(edge[i]);
+			value.push_back(1.f);
+		}
+	writeValues(out, value);
+}
+
+/***************************************************************************/
+/**
+ * This method writes the WWINP file (time-independent, rectangular mesh).
+ * Photon windows are written as the second particle type with no neutron
+ * groups.
+ */
+bool WeightWindowGenerator::write(TString filename)
+{
+	if (m_window.size() == 0) {
+		ERROR("No weight windows to write!");
+		return false;
+	}
+	std::ofstream out(filename.Data());
+	if (!out.is_open()) {
+		ERROR("Unable to open file '"+filename+"'!");
+		return false;
+	}
+	int ni = (m_photon ? 2 : 1);
+	int ng = (int)m_window.size();
+	TDatime date;
+	out << Form("%10d%10d%10d%10d%20s%19s", 1, 1, ni, 10, "", date.AsSQLString()) << std::endl;
+	if (m_photon)
+		out << Form("%10d%10d", 0, ng) << std::endl;
+	else
+		out << Form("%10d", ng) << std::endl;
+
+	int nc[3];
+	for (int a = 0; a < 3; ++a)
+		nc[a] = (isUniform(m_edge[a]) ? 1 : m_n[a]);
+	std::vector<float> mesh;
+	mesh.push_back(m_n[0]);
+	mesh.push_back(m_n[1]);
+	mesh.push_back(m_n[2]);
+	mesh.push_back(m_edge[0].front());
+	mesh.push_back(m_edge[1].front());
+	mesh.push_back(m_edge[2].front());
+	writeValues(out, mesh);
+	std::vector<float> coarse(nc, nc+3);
+	coarse.push_back(1.f);
+	writeValues(out, coarse);
+	for (int a = 0; a < 3; ++a)
+		writeAxis(out, m_edge[a]);
+
+	writeValues(out, std::vector<float>(m_energy.begin(), m_energy.end()));
+	for (int g = 0; g < ng; ++g)
+		writeValues(out, m_window[g]);
+	out.close();
+	MESSAGE( TString::Format( "Write weight windows (%d groups, %d voxels) to '%s'", ng, m_n[0]*m_n[1]*m_n[2], filename.Data() ) );
+	return true;
+}
@@ -27,15 +27,24 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <future>
 #include <TROOT.h>
 #include <TSystem.h>
 #include "ErrHandler.h"
 #include "Config.h"
 #include "Plotter.h"
 #include "HistoUtilities.h"
+#include "ProfileExtractor.h"
+#include "MeshExporter.h"
+#include "DoseVolumeHistogram.h"
+#include "GammaIndex.h"
+#include "DoseMetrics.h"
+#include "ThreadPool.h"
+#include "Table.h"
 
 void info();
 void processHisto(Config *config);
+void processMetrics(Config *config);
 
 ErrHandler message("PTSimAnalysis");
 int debug_level;
@@ -68,6 +77,10 @@ int main(int argc, char **argv)
 		MESSAGE("Analysis mode HISTO");
 		processHisto(config);
 	} 
+	else if (type == "METRICS") {
+		MESSAGE("Analysis mode METRICS");
+		processMetrics(config);
+	} 
 	else {
 		ERROR("Undefined analysis mode!");
 		WARN("May due to the inconsistency between Windows and Linux/Cygwin text file formats.");
@@ -84,7 +97,49 @@ int main(int argc, char **argv)
 
 /***************************************************************************/
 /**
- * This is the function for processing hitograms.
+ * This is the function for processing hitograms. Besides projections on
+ * the axes (\a Projection \a Type), profiles along lines and cuts on planes
+ * of 3D histograms are made with the options (see \ref ProfileExtractor):
+ * * \a Profile \a Start : start points x, y, z of lines (3 values per line)
+ * * \a Profile \a End : end points x, y, z of lines (3 values per line)
+ * * \a Profile \a Bins : number of bins of profiles (0 for one bin per crossed voxel)
+ * * \a Profile \a Interpolation : interpolate profiles and plane cuts (trilinear) instead of
+ *   exact voxel intersections and voxel values
+ * * \a Plane \a Origin : corner x, y, z of plane
+ * * \a Plane \a U, \a Plane \a V : vectors of the sides of plane
+ * * \a Plane \a Bins : numbers of bins along the sides of plane
+ *
+ * With \a Export \a To \a VTK the 3D histograms are written (with errors)
+ * to binary VTK files in the plot folder, see \ref MeshExporter.
+ *
+ * Dose-volume histograms of the 3D histograms are made for the structures
+ * given by the options (see \ref DoseVolumeHistogram):
+ * * \a DVH \a Box : limits xmin, xmax, ymin, ymax, zmin, zmax of boxes (6 values per box)
+ * * \a DVH \a Cylinder : center on the two other axes, radius, lower and upper
+ *   limits along the axis of cylinders (5 values per cylinder)
+ * * \a DVH \a Cylinder \a Axis : axis of each cylinder ("x", "y" or "z", default "z")
+ * * \a DVH \a Label \a File, \a DVH \a Label \a Histogram : ROOT file and name of a
+ *   label volume (default "label") with the binning of the dose histograms
+ * * \a DVH \a Labels : label values of structures in the label volume
+ * * \a DVH \a Structures : names of structures (boxes, cylinders, then labels)
+ * * \a DVH \a Bins : number of dose bins (default 200)
+ * * \a DVH \a Max \a Dose : upper edge of dose bins (default maximum dose)
+ *
+ * The cumulative DVHs of all structures are drawn in one comparison plot
+ * and their dose summaries are written to "dvh_<file>_<histogram>.txt".
+ *
+ * With \a Gamma \a Index the 3D histograms of each file are compared with
+ * those of the first file (see \ref GammaIndex), options:
+ * * \a Gamma \a Criteria : dose difference (percent) and distance-to-agreement
+ *   (units of the axes), default 3, 3
+ * * \a Gamma \a Local : dose difference relative to the local dose (true or false)
+ * * \a Gamma \a Threshold : voxels below this percentage of the maximum
+ *   reference dose are not evaluated (default 10)
+ * * \a Gamma \a Search \a Radius : search radius in units of the distance
+ *   criterion (default 2)
+ *
+ * The gamma maps are written to "gamma_<file>.root" and the pass rates of
+ * all comparisons to "gamma_summary.txt".
  */
 void processHisto(Config* config)
 {
@@ -100,15 +155,76 @@ void processHisto(Config* config)
 	bool doComparision             = config->get      ("Make Comparison" , false);
 	bool doMerge                   = config->get      ("Merging"         , false);
 	bool doHist2Txt                = config->get      ("Export To Text"  , false);
+	bool doHist2VTK                = config->get      ("Export To VTK"   , false);
 	std::vector<TString> title     = config->getString("Title"           , ',');
 	TString titleX                 = config->get      ("Title X"         , "");
 	TString titleY                 = config->get      ("Title Y"         , "");
 	std::vector<double> weight     = config->getDouble("Weights"         , ',');
+	std::vector<double> lineStart  = config->getDouble("Profile Start"   , ',');
+	std::vector<double> lineEnd    = config->getDouble("Profile End"     , ',');
+	int profileBins                = config->get      ("Profile Bins"    , 0);
+	bool doInterpolation           = config->get      ("Profile Interpolation", false);
+	std::vector<double> planeOrigin= config->getDouble("Plane Origin"    , ',');
+	std::vector<double> planeU     = config->getDouble("Plane U"         , ',');
+	std::vector<double> planeV     = config->getDouble("Plane V"         , ',');
+	std::vector<int> planeBins     = config->getInt   ("Plane Bins"      , ',');
+	bool doProfile                 = (config->get     ("Profile Start"   , "") != "");
+	bool doPlane                   = (config->get     ("Plane Origin"    , "") != "");
+	std::vector<TString> dvhNames  = config->getString("DVH Structures"  , ',');
+	std::vector<TString> dvhAxis   = config->getString("DVH Cylinder Axis", ',');
+	TString dvhLabelFile           = config->get      ("DVH Label File"  , "");
+	int dvhBins                    = config->get      ("DVH Bins"        , 200);
+	double dvhMaxDose              = config->get      ("DVH Max Dose"    , 0.);
+	bool doGamma                   = config->get      ("Gamma Index"     , false);
+	bool gammaLocal                = config->get      ("Gamma Local"     , false);
+	double gammaThreshold          = config->get      ("Gamma Threshold" , 10.);
+	double gammaRadius             = config->get      ("Gamma Search Radius", 2.);
 
 	HistoUtilities hutil;
 	Plotter plotter;
 	plotter.setStyle(config);
 	std::vector<TH1*> comp_histo;
+
+	// structures of dose-volume histograms
+	DoseVolumeHistogram dvh;
+	dvh.setBinning(dvhBins, dvhMaxDose);
+	size_t nstruct = 0;
+	if(config->get("DVH Box", "") != "") {
+		std::vector<double> box = config->getDouble("DVH Box", ',');
+		for(size_t k = 0; k+5 < box.size(); k += 6, ++nstruct)
+			dvh.addBox( (nstruct < dvhNames.size() ? dvhNames[nstruct] : TString::Format("box%d", (int)k/6+1)),
+			            std::vector<double>(box.begin()+k, box.begin()+k+6) );
+	}
+	if(config->get("DVH Cylinder", "") != "") {
+		std::vector<double> cylinder = config->getDouble("DVH Cylinder", ',');
+		for(size_t k = 0; k+4 < cylinder.size(); k += 5, ++nstruct)
+			dvh.addCylinder( (nstruct < dvhNames.size() ? dvhNames[nstruct] : TString::Format("cylinder%d", (int)k/5+1)),
+			                 (k/5 < dvhAxis.size() ? dvhAxis[k/5] : TString("z")), std::vector<double>(cylinder.begin()+k, cylinder.begin()+k+5) );
+	}
+	TFile* labelfile = 0;
+	if(dvhLabelFile != "") {
+		labelfile = TFile::Open(dvhLabelFile, "read");
+		TH3* label = (labelfile ? dynamic_cast<TH3*>(labelfile->Get(config->get("DVH Label Histogram", "label"))) : 0);
+		if(!label)
+			ERROR("Couldn't get label histogram from file '"+dvhLabelFile+"'!");
+		else
+			dvh.addLabels(label, config->getInt("DVH Labels", ','),
+			              std::vector<TString>(dvhNames.begin()+std::min(nstruct, dvhNames.size()), dvhNames.end()));
+	}
+
+	// criteria of gamma index, reference histograms are those of the first file
+	GammaIndex gamma;
+	std::vector<double> criteria(2, 3.);
+	if(config->get("Gamma Criteria", "") != "")
+		criteria = config->getDouble("Gamma Criteria", ',');
+	gamma.setCriteria(criteria[0], (criteria.size() > 1 ? criteria[1] : criteria[0]), gammaLocal);
+	gamma.setThreshold(gammaThreshold);
+	gamma.setSearchRadius(gammaRadius);
+	std::vector<TH3*> gammaRef;
+	std::string gammaHeader[7] = { "Histogram", "File", "Voxels", "Passed", "Pass rate", "Mean gamma", "Max gamma" };
+	std::vector< std::vector<GenericData> > gammaColumns(7);
+	for(int k = 0; k < 7; ++k)
+		gammaColumns[k].push_back( gammaHeader[k] );
 	
 	for(size_t i = 0; i < filename.size(); ++i) {
 		INFO("Reading file '"+filename[i]+"'");
@@ -122,6 +238,112 @@ void processHisto(Config* config)
 		TString prefix = filename[i];
 		prefix.ReplaceAll("/","_");
 		prefix.ReplaceAll(".root","");
+		if(doHist2VTK) {
+			std::vector<TH3*> meshlist;
+			for(size_t j = 0; j < histolist.size(); ++j)
+				if(TH3* hist = dynamic_cast<TH3*>(histolist[j]))
+					meshlist.push_back(hist);
+			MeshExporter exporter;
+			exporter.write(meshlist, config->get("Plot Folder", "plots")+"/"+prefix+"_");
+		}
+		if(dvh.getNstructures() > 0) {
+			MESSAGE("Making dose-volume histograms...");
+			for(size_t j = 0; j < histolist.size(); ++j) {
+				TH3* dose = dynamic_cast<TH3*>(histolist[j]);
+				if(!dose) continue;
+				std::vector<TH1D*> differential, cumulative;
+				std::vector<DVHSummary> summary = dvh.compute(dose, differential, cumulative);
+				if(summary.empty()) continue;
+				std::vector<TH1*> plots;
+				std::vector<TString> names;
+				std::string header[10] = { "Structure", "Voxels", "Volume", "Dmin", "Dmean", "Dmax", "D98", "D95", "D50", "D2" };
+				std::vector< std::vector<GenericData> > columns(10);
+				for(int k = 0; k < 10; ++k)
+					columns[k].push_back( header[k] );
+				for(size_t k = 0; k < summary.size(); ++k) {
+					const DVHSummary& d = summary[k];
+					double value[8] = { d.volume, d.minDose, d.meanDose, d.maxDose, d.d98, d.d95, d.d50, d.d2 };
+					names.push_back(d.name);
+					TH1* h = (TH1*)cumulative[k]->Clone(prefix+"_"+TString(cumulative[k]->GetName()));
+					h->SetDirectory(0);
+					plots.push_back(h);
+					columns[0].push_back( std::string(d.name.Data()) );
+					columns[1].push_back( d.nvoxels );
+					for(int c = 0; c < 8; ++c)
+						columns[c+2].push_back( std::string( Form("%.4g", value[c]) ) );
+				}
+				bool ratio = plotter.getRatio();
+				plotter.setRatio(false);
+				plotter.makeComparisonPlot(plots, names);
+				plotter.setRatio(ratio);
+				for(size_t k = 0; k < plots.size(); ++k)
+					delete plots[k];
+				Table table(columns);
+				table.print(10);
+				TString txtname = "dvh_"+prefix+"_"+TString(dose->GetName())+".txt";
+				std::ofstream txtfile(txtname.Data());
+				if(txtfile.is_open()) {
+					MESSAGE("Write DVH summary to '"+txtname+"'");
+					table.print(txtfile, "text");
+					txtfile.close();
+				} else
+					ERROR("Unable to open file '"+txtname+"'!");
+				for(size_t k = 0; k < summary.size(); ++k) {
+					if(doHist2Txt) {
+						plotter.exportHist2Text(differential[k],prefix);
+						plotter.exportHist2Text(cumulative[k],prefix);
+					}
+					delete differential[k];
+					delete cumulative[k];
+				}
+			}
+		}
+		if(doGamma && i == 0) {
+			for(size_t j = 0; j < histolist.size(); ++j)
+				if(TH3* hist = dynamic_cast<TH3*>(histolist[j])) {
+					TH3* ref = (TH3*)hist->Clone();
+					ref->SetDirectory(0);
+					gammaRef.push_back(ref);
+				}
+		} else if(doGamma) {
+			MESSAGE("Making gamma index maps...");
+			TDirectory::TContext context;
+			TFile* gammafile = TFile::Open("gamma_"+prefix+".root","RECREATE");
+			if(!gammafile || gammafile->IsZombie()) {
+				ERROR("Unable to open file 'gamma_"+prefix+".root'!");
+				delete gammafile;
+				gammafile = 0;
+			}
+			for(size_t j = 0; j < histolist.size() && gammafile; ++j) {
+				TH3* hist = dynamic_cast<TH3*>(histolist[j]);
+				if(!hist) continue;
+				TH3* ref = 0;
+				for(size_t k = 0; k < gammaRef.size() && !ref; ++k)
+					if(TString(gammaRef[k]->GetName()) == hist->GetName())
+						ref = gammaRef[k];
+				if(!ref) {
+					WARN("No reference histogram '"+TString(hist->GetName())+"' in file '"+filename[0]+"'");
+					continue;
+				}
+				GammaSummary sum;
+				TH3F* map = gamma.compute(ref, hist, "gamma_"+TString(hist->GetName()), sum);
+				if(!map) continue;
+				gammafile->cd();
+				map->Write();
+				delete map;
+				gammaColumns[0].push_back( std::string(hist->GetName()) );
+				gammaColumns[1].push_back( std::string(filename[i].Data()) );
+				gammaColumns[2].push_back( sum.nvoxels );
+				gammaColumns[3].push_back( sum.npassed );
+				gammaColumns[4].push_back( std::string( Form("%.2f%%", sum.passRate) ) );
+				gammaColumns[5].push_back( std::string( Form("%.3f", sum.meanGamma) ) );
+				gammaColumns[6].push_back( std::string( Form("%.3f", sum.maxGamma) ) );
+			}
+			if(gammafile) {
+				gammafile->Close();
+				delete gammafile;
+			}
+		}
 		if(type != "") {
 			MESSAGE("Making projection plots...");
 			for(size_t j = 0; j < histolist.size(); ++j) {
@@ -133,6 +355,46 @@ void processHisto(Config* config)
 				if(doHist2Txt)
 					plotter.exportHist2Text(h,prefix);
 			}
+		} else if(doProfile || doPlane) {
+			MESSAGE("Making profile plots...");
+			std::vector< std::vector<double> > start, end;
+			std::vector<TString> names;
+			for(size_t k = 0; k+2 < lineStart.size() && k+2 < lineEnd.size(); k += 3) {
+				start.push_back( std::vector<double>(lineStart.begin()+k, lineStart.begin()+k+3) );
+				end.push_back  ( std::vector<double>(lineEnd.begin()+k, lineEnd.begin()+k+3) );
+			}
+			for(size_t j = 0; j < histolist.size(); ++j) {
+				TH3* hist3D = dynamic_cast<TH3*>(histolist[j]);
+				if(!hist3D) continue;
+				ProfileExtractor extractor(hist3D);
+				names.clear();
+				for(size_t k = 0; k < start.size(); ++k)
+					names.push_back( TString::Format( "%s_%s_line%d", prefix.Data(), hist3D->GetName(), (int)k+1 ) );
+				std::vector<TH1D*> profiles = extractor.lines(start, end, names, profileBins, doInterpolation);
+				for(size_t k = 0; k < profiles.size(); ++k) {
+					if(!profiles[k]) continue;
+					profiles[k]->SetDirectory(0);
+					plotter.makeHistPlot(profiles[k],prefix);
+					if(doHist2Txt)
+						plotter.exportHist2Text(profiles[k],prefix);
+					if(doComparision)
+						comp_histo.push_back(profiles[k]);
+					else
+						delete profiles[k];
+				}
+				if(doPlane) {
+					int nu = (planeBins.size() > 0 && planeBins[0] > 0 ? planeBins[0] : 100);
+					int nv = (planeBins.size() > 1 && planeBins[1] > 0 ? planeBins[1] : nu);
+					TH2D* cut = extractor.plane(planeOrigin, planeU, planeV, nu, nv, prefix+"_"+TString(hist3D->GetName())+"_plane", doInterpolation);
+					if(cut) {
+						cut->SetDirectory(0);
+						plotter.makeHistPlot(cut,prefix);
+						if(doHist2Txt)
+							plotter.exportHist2Text(cut,prefix);
+						delete cut;
+					}
+				}
+			}
 		} else {
 			MESSAGE("Making plots...");
 			for(size_t j = 0; j < histolist.size(); ++j) {
@@ -148,6 +410,22 @@ void processHisto(Config* config)
 		}
 		file->Close();
 	}
+	if(labelfile)
+		labelfile->Close();
+
+	if(doGamma && gammaColumns[0].size() > 1) {
+		Table table(gammaColumns);
+		table.print(10);
+		std::ofstream txtfile("gamma_summary.txt");
+		if(txtfile.is_open()) {
+			MESSAGE("Write gamma pass rates to 'gamma_summary.txt'");
+			table.print(txtfile, "text");
+			txtfile.close();
+		} else
+			ERROR("Unable to open file 'gamma_summary.txt'!");
+	}
+	for(size_t k = 0; k < gammaRef.size(); ++k)
+		delete gammaRef[k];
 
 	if(doComparision) {
 		MESSAGE("Making comparison plots...");
@@ -168,6 +446,110 @@ void processHisto(Config* config)
 }
 
 
+/***************************************************************************/
+/**
+ * This is the function for computing dose-profile metrics of many PTSim
+ * outputs without making plots (see \ref DoseMetrics): Bragg peak depth and
+ * dose, distal ranges R90 and R80, entrance dose and lateral 80%-20%
+ * penumbra widths at the peak. Options:
+ * * \a File \a Name : list of ROOT files
+ * * \a Histogram : names of 3D dose (or 1D depth-dose) histograms, glob
+ *   patterns or regular expressions (see \ref HistoUtilities::getHistosFromFile())
+ * * \a Depth \a Axis : beam axis of 3D histograms ("x", "y" or "z", default "z")
+ * * \a Number \a of \a Threads : number of threads (0 for number of CPU cores)
+ * * \a Outputfile \a Name : name of summary table (default "dose_metrics")
+ *
+ * The files are read and analysed in parallel, one file per job, and the
+ * metrics of all files and histograms are written to one table
+ * "<Outputfile Name>.txt" in the order of the files.
+ */
+void processMetrics(Config* config)
+{
+	std::vector<TString> filename  = config->getString("File Name"        , ',');
+	std::vector<TString> histoname = config->getString("Histogram"        , ',');
+	TString depthAxis              = config->get      ("Depth Axis"       , "z");
+	int nthreads                   = config->get      ("Number of Threads", 0);
+	TString outname                = config->get      ("Outputfile Name"  , "dose_metrics");
+	if(filename.size() == 0 || histoname.size() == 0) {
+		ERROR("No file or histogram for dose metrics!");
+		return;
+	}
+
+	// metrics of each file and histogram, one job per file
+	ROOT::EnableThreadSafety();
+	bool addDirectory = TH1::AddDirectoryStatus();
+	TH1::AddDirectory(kFALSE);
+	int nfiles = (int)filename.size();
+	std::vector< std::vector< std::pair<TString,DoseProfileMetrics> > > metrics(nfiles);
+	ThreadPool pool(nthreads);
+	INFO( TString::Format( "Compute dose metrics of %d files with %d threads", nfiles, pool.size() ) );
+	std::vector< std::future<void> > jobs;
+	for(int i = 0; i < nfiles; ++i)
+		jobs.push_back( pool.submit( [&,i]() {
+			TFile* file = TFile::Open(filename[i], "READ");
+			if(!file || file->IsZombie()) {
+				ERROR("Cannot open file '"+filename[i]+"'");
+				delete file;
+				return;
+			}
+			HistoUtilities hutil;
+			std::vector<TH1*> histlist;
+			hutil.getHistosFromFile(histlist, histoname, file);
+			if(histlist.size() == 0)
+				ERROR("Couldn't get any histogram from file '"+filename[i]+"'!");
+			DoseMetrics doseMetrics(depthAxis);
+			for(size_t n = 0; n < histlist.size(); ++n) {
+				DoseProfileMetrics m;
+				if(doseMetrics.compute(histlist[n], m))
+					metrics[i].push_back( std::make_pair(TString(histlist[n]->GetName()), m) );
+				delete histlist[n];
+			}
+			file->Close();
+			delete file;
+		} ) );
+	for(size_t j = 0; j < jobs.size(); ++j)
+		jobs[j].get();
+	TH1::AddDirectory(addDirectory);
+
+	// summary table
+	depthAxis.ToLower();
+	TString lateral[2] = { (depthAxis == "x" ? "y" : "x"), (depthAxis == "y" || depthAxis == "x" ? "z" : "y") };
+	std::string header[10] = { "File", "Histogram", "Peak", "Peak dose", "Entrance dose", "Entrance/Peak",
+	                           "R90", "R80", std::string("Penumbra ")+lateral[0].Data(), std::string("Penumbra ")+lateral[1].Data() };
+	std::vector< std::vector<GenericData> > columns(10);
+	for(int k = 0; k < 10; ++k)
+		columns[k].push_back( header[k] );
+	for(int i = 0; i < nfiles; ++i)
+		for(size_t n = 0; n < metrics[i].size(); ++n) {
+			const DoseProfileMetrics& m = metrics[i][n].second;
+			columns[0].push_back( std::string(filename[i].Data()) );
+			columns[1].push_back( std::string(metrics[i][n].first.Data()) );
+			columns[2].push_back( std::string( Form("%.3f", m.peakDepth) ) );
+			columns[3].push_back( std::string( Form("%.4g", m.peakDose) ) );
+			columns[4].push_back( std::string( Form("%.4g", m.entranceDose) ) );
+			columns[5].push_back( std::string( Form("%.3f", m.peakDose > 0. ? m.entranceDose/m.peakDose : 0.) ) );
+			columns[6].push_back( std::string( Form("%.3f", m.r90) ) );
+			columns[7].push_back( std::string( Form("%.3f", m.r80) ) );
+			columns[8].push_back( std::string( Form("%.3f", m.penumbra[0]) ) );
+			columns[9].push_back( std::string( Form("%.3f", m.penumbra[1]) ) );
+		}
+	if(columns[0].size() <= 1) {
+		ERROR("No dose metrics computed!");
+		return;
+	}
+	Table table(columns);
+	table.print(12);
+	std::ofstream txtfile(outname+".txt");
+	if(txtfile.is_open()) {
+		MESSAGE("Write dose metrics to '"+outname+".txt'");
+		table.print(txtfile, "text");
+		txtfile.close();
+	} else
+		ERROR("Unable to open file '"+outname+".txt'!");
+	return;
+}
+
+
 /***************************************************************************/
 /**
  * This is the function for printing PTSIM ANALYSIS module information.